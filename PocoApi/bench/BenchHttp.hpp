@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Poco/Net/StreamSocket.h"
+#include <string>
+
+// Reads one whole response into reply: up to the end of the
+// Content-Length body, or to the last chunk.
+inline bool readResponse(Poco::Net::StreamSocket& socket, std::string& reply) {
+    static const std::string LENGTH_HEADER = "Content-Length: ";
+    static const std::string LAST_CHUNK = "\r\n0\r\n\r\n";
+    char buffer[16 * 1024];
+    reply.clear();
+    std::size_t headerEnd = std::string::npos;
+    std::size_t total = std::string::npos;
+    for (;;) {
+        const int n = socket.receiveBytes(buffer, sizeof(buffer));
+        if (n <= 0) {
+            return false;
+        }
+        reply.append(buffer, static_cast<std::size_t>(n));
+        if (headerEnd == std::string::npos) {
+            headerEnd = reply.find("\r\n\r\n");
+            if (headerEnd == std::string::npos) {
+                continue;
+            }
+            headerEnd += 4;
+            const std::size_t length = reply.find(LENGTH_HEADER);
+            if (length != std::string::npos && length < headerEnd) {
+                total = headerEnd + std::stoul(reply.substr(length + LENGTH_HEADER.size()));
+            }
+        }
+        if (total != std::string::npos ? reply.size() >= total
+                                       : reply.size() >= LAST_CHUNK.size()
+                                             && reply.compare(reply.size() - LAST_CHUNK.size(), LAST_CHUNK.size(), LAST_CHUNK) == 0) {
+            return true;
+        }
+    }
+}
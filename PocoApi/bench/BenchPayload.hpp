@@ -0,0 +1,22 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+
+// Builds a JSON object of roughly the requested size, shaped like the
+// records clients post to /api/data.
+inline std::string makePayload(std::size_t targetSize) {
+    std::ostringstream oss;
+    oss << "{\"source\":\"bench\",\"records\":[";
+    for (std::size_t i = 0; static_cast<std::size_t>(oss.tellp()) < targetSize; ++i) {
+        if (i > 0) oss << ',';
+        oss << "{\"id\":" << i
+            << ",\"name\":\"user_" << i << "\""
+            << ",\"active\":" << (i % 2 ? "true" : "false")
+            << ",\"score\":" << (i * 0.25)
+            << ",\"tags\":[\"a\",\"b\\\"c\",\"\\u00e9\"]"
+            << ",\"note\":null}";
+    }
+    oss << "]}";
+    return oss.str();
+}
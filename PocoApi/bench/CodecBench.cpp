@@ -0,0 +1,142 @@
+#include "BenchPayload.hpp"
+#include "codec/Cbor.hpp"
+#include "codec/ContentNegotiation.hpp"
+#include "codec/MessagePack.hpp"
+#include "json/SimdJsonParser.hpp"
+#include "Poco/JSON/Parser.h"
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Records handler events once so encoders can be timed on their own.
+class EventRecorder : public Poco::JSON::Handler {
+public:
+    enum Kind { StartObject, EndObject, StartArray, EndArray, Key, Null, Int, String, Double, Bool };
+
+    struct Event {
+        Kind kind;
+        Poco::Int64 i;
+        double d;
+        std::string s;
+    };
+
+    void reset() override { events.clear(); }
+    void startObject() override { add(StartObject); }
+    void endObject() override { add(EndObject); }
+    void startArray() override { add(StartArray); }
+    void endArray() override { add(EndArray); }
+    void key(const std::string& k) override { add(Key).s = k; }
+    void null() override { add(Null); }
+    void value(int v) override { add(Int).i = v; }
+    void value(unsigned v) override { add(Int).i = v; }
+    void value(Poco::Int64 v) override { add(Int).i = v; }
+    void value(Poco::UInt64 v) override { add(Int).i = static_cast<Poco::Int64>(v); }
+    void value(const std::string& v) override { add(String).s = v; }
+    void value(double v) override { add(Double).d = v; }
+    void value(bool b) override { add(Bool).i = b; }
+
+    void replay(Poco::JSON::Handler& h) const {
+        for (const auto& e : events) {
+            switch (e.kind) {
+                case StartObject: h.startObject(); break;
+                case EndObject:   h.endObject(); break;
+                case StartArray:  h.startArray(); break;
+                case EndArray:    h.endArray(); break;
+                case Key:         h.key(e.s); break;
+                case Null:        h.null(); break;
+                case Int:         h.value(e.i); break;
+                case String:      h.value(e.s); break;
+                case Double:      h.value(e.d); break;
+                case Bool:        h.value(e.i != 0); break;
+            }
+        }
+    }
+
+    std::vector<Event> events;
+
+private:
+    Event& add(Kind kind) {
+        events.push_back(Event{ kind, 0, 0.0, std::string() });
+        return events.back();
+    }
+};
+
+// Swallows events so decoders can be timed on their own.
+class NullHandler : public Poco::JSON::Handler {
+public:
+    void reset() override {}
+    void startObject() override {}
+    void endObject() override {}
+    void startArray() override {}
+    void endArray() override {}
+    void key(const std::string&) override {}
+    void null() override {}
+    void value(int) override {}
+    void value(unsigned) override {}
+    void value(Poco::Int64) override {}
+    void value(Poco::UInt64) override {}
+    void value(const std::string&) override {}
+    void value(double) override {}
+    void value(bool) override {}
+};
+
+const EventRecorder& recordedPayload(std::size_t size) {
+    static std::size_t recordedSize = 0;
+    static Poco::SharedPtr<EventRecorder> recorder = new EventRecorder;
+    if (recordedSize != size) {
+        recorder->reset();
+        SimdJsonParser(recorder).parse(makePayload(size));
+        recordedSize = size;
+    }
+    return *recorder;
+}
+
+std::string encodePayload(BodyEncoding encoding, std::size_t size) {
+    std::ostringstream out;
+    Poco::JSON::Handler::Ptr writer = ContentNegotiation::createWriter(encoding, out);
+    recordedPayload(size).replay(*writer);
+    return out.str();
+}
+
+void BM_Encode(benchmark::State& state, BodyEncoding encoding) {
+    const EventRecorder& events = recordedPayload(static_cast<std::size_t>(state.range(0)));
+    std::size_t encodedSize = 0;
+    for (auto _ : state) {
+        std::ostringstream out;
+        Poco::JSON::Handler::Ptr writer = ContentNegotiation::createWriter(encoding, out);
+        events.replay(*writer);
+        encodedSize = static_cast<std::size_t>(out.tellp());
+        benchmark::DoNotOptimize(encodedSize);
+    }
+    state.counters["encoded_bytes"] = static_cast<double>(encodedSize);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * encodedSize));
+}
+
+void BM_Decode(benchmark::State& state, BodyEncoding encoding) {
+    const std::string encoded = encodePayload(encoding, static_cast<std::size_t>(state.range(0)));
+    Poco::JSON::Handler::Ptr sink = new NullHandler;
+    for (auto _ : state) {
+        std::istringstream in(encoded);
+        switch (encoding) {
+            case BodyEncoding::Cbor:        CborReader(sink).parse(in); break;
+            case BodyEncoding::MessagePack: MessagePackReader(sink).parse(in); break;
+            default:                        Poco::JSON::Parser(sink).parse(in); break;
+        }
+    }
+    state.counters["encoded_bytes"] = static_cast<double>(encoded.size());
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * encoded.size()));
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_Encode, json, BodyEncoding::Json)->RangeMultiplier(10)->Range(1 << 10, 10 << 20);
+BENCHMARK_CAPTURE(BM_Encode, cbor, BodyEncoding::Cbor)->RangeMultiplier(10)->Range(1 << 10, 10 << 20);
+BENCHMARK_CAPTURE(BM_Encode, msgpack, BodyEncoding::MessagePack)->RangeMultiplier(10)->Range(1 << 10, 10 << 20);
+BENCHMARK_CAPTURE(BM_Decode, json, BodyEncoding::Json)->RangeMultiplier(10)->Range(1 << 10, 10 << 20);
+BENCHMARK_CAPTURE(BM_Decode, cbor, BodyEncoding::Cbor)->RangeMultiplier(10)->Range(1 << 10, 10 << 20);
+BENCHMARK_CAPTURE(BM_Decode, msgpack, BodyEncoding::MessagePack)->RangeMultiplier(10)->Range(1 << 10, 10 << 20);
+
+BENCHMARK_MAIN();
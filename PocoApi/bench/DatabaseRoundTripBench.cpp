@@ -0,0 +1,91 @@
+#include "DatabaseService.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// Runs against a real SQL Server: set POCOAPI_BENCH_DB to an ODBC
+// connection string, else the service's default database is used. The
+// round_trips counter is what each path costs regardless of latency.
+std::string connectionString() {
+    const char* env = std::getenv("POCOAPI_BENCH_DB");
+    return env ? env : DatabaseService::defaultConnectionString();
+}
+
+bool connectOrSkip(benchmark::State& state, DatabaseService& db) {
+    if (!db.connect()) {
+        state.SkipWithError(("Cannot connect: " + db.errorMessage()).c_str());
+        return false;
+    }
+    return true;
+}
+
+void reportRoundTrips(benchmark::State& state, const DatabaseService& db, std::uint64_t before) {
+    state.counters["round_trips"] = benchmark::Counter(
+        static_cast<double>(db.roundTrips() - before), benchmark::Counter::kAvgIterations);
+}
+
+// GetName as it used to run: SELECT under autoCommit=false, then commit.
+void BM_LookupTransactional(benchmark::State& state) {
+    DatabaseService db(connectionString(), DatabaseService::READ_WRITE);
+    if (!connectOrSkip(state, db)) return;
+    const std::uint64_t before = db.roundTrips();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.getFullName("John"));
+        db.CommitTransaction();
+    }
+    reportRoundTrips(state, db, before);
+}
+
+// GetName now: one autocommitted SELECT.
+void BM_LookupReadOnly(benchmark::State& state) {
+    DatabaseService db(connectionString(), DatabaseService::READ_ONLY);
+    if (!connectOrSkip(state, db)) return;
+    const std::uint64_t before = db.roundTrips();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.getFullName("John"));
+    }
+    reportRoundTrips(state, db, before);
+}
+
+// range(0) inserts, each committed on its own.
+void BM_InsertCommitEach(benchmark::State& state) {
+    DatabaseService db(connectionString(), DatabaseService::READ_WRITE);
+    if (!connectOrSkip(state, db)) return;
+    const std::string record = "{\"source\":\"bench\"}";
+    const std::uint64_t before = db.roundTrips();
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            DatabaseService::UnitOfWork work(db);
+            db.insertRecord(record);
+            work.commit();
+        }
+    }
+    reportRoundTrips(state, db, before);
+}
+
+// The same inserts grouped into one unit of work.
+void BM_InsertUnitOfWork(benchmark::State& state) {
+    DatabaseService db(connectionString(), DatabaseService::READ_WRITE);
+    if (!connectOrSkip(state, db)) return;
+    const std::string record = "{\"source\":\"bench\"}";
+    const std::uint64_t before = db.roundTrips();
+    for (auto _ : state) {
+        DatabaseService::UnitOfWork work(db);
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            db.insertRecord(record);
+        }
+        work.commit();
+    }
+    reportRoundTrips(state, db, before);
+}
+
+} // namespace
+
+BENCHMARK(BM_LookupTransactional)->UseRealTime();
+BENCHMARK(BM_LookupReadOnly)->UseRealTime();
+BENCHMARK(BM_InsertCommitEach)->Arg(1)->Arg(10)->Arg(100)->UseRealTime();
+BENCHMARK(BM_InsertUnitOfWork)->Arg(1)->Arg(10)->Arg(100)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,43 @@
+#include "BenchPayload.hpp"
+#include "json/SimdJsonParser.hpp"
+#include "Poco/JSON/Parser.h"
+#include <benchmark/benchmark.h>
+#include <string>
+
+namespace {
+
+void BM_PocoParser(benchmark::State& state) {
+    const std::string json = makePayload(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        Poco::JSON::Parser parser;
+        benchmark::DoNotOptimize(parser.parse(json));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+}
+
+void BM_SimdParser(benchmark::State& state) {
+    const std::string json = makePayload(static_cast<std::size_t>(state.range(0)));
+    SimdJsonParser parser;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse(json));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+}
+
+// Stage 1 plus a single field lookup: what on-demand access costs.
+void BM_SimdOnDemandField(benchmark::State& state) {
+    const std::string json = makePayload(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        auto doc = SimdJsonParser::index(json);
+        benchmark::DoNotOptimize(doc.get("source"));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_PocoParser)->RangeMultiplier(10)->Range(1 << 10, 10 << 20);
+BENCHMARK(BM_SimdParser)->RangeMultiplier(10)->Range(1 << 10, 10 << 20);
+BENCHMARK(BM_SimdOnDemandField)->RangeMultiplier(10)->Range(1 << 10, 10 << 20);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,50 @@
+#include "DatabaseService.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::size_t PAGE_SIZE = 50;
+
+// Runs against a real SQL Server, like DatabaseRoundTripBench: set
+// POCOAPI_BENCH_DB to an ODBC connection string, else the service's
+// default database is used.
+std::string connectionString() {
+    const char* env = std::getenv("POCOAPI_BENCH_DB");
+    return env ? env : DatabaseService::defaultConnectionString();
+}
+
+// range(0) is the page depth. The key the page starts after is found
+// once, outside the timed loop; each iteration then fetches the page
+// there as a client holding that cursor would. Keyset paging should give
+// the same time at every depth.
+void BM_ListUsersPage(benchmark::State& state) {
+    DatabaseService db(connectionString(), DatabaseService::READ_ONLY);
+    if (!db.connect()) {
+        state.SkipWithError(("Cannot connect: " + db.errorMessage()).c_str());
+        return;
+    }
+
+    const std::size_t depth = static_cast<std::size_t>(state.range(0));
+    NameRow after;
+    if (depth > 0) {
+        const std::vector<NameRow> skipped = db.listUsers(nullptr, depth * PAGE_SIZE);
+        if (skipped.size() < depth * PAGE_SIZE) {
+            state.SkipWithError("Not enough rows in [dbo].[USER] for this depth");
+            return;
+        }
+        after = skipped.back();
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.listUsers(depth > 0 ? &after : nullptr, PAGE_SIZE));
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_ListUsersPage)->Arg(0)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
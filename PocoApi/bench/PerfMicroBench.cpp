@@ -0,0 +1,245 @@
+#include "BenchHttp.hpp"
+#include "BenchPayload.hpp"
+#include "DatabaseService.hpp"
+#include "SoapMessages.hpp"
+#include "handlers/RecordProcessor.hpp"
+#include "Poco/Data/SQLite/Connector.h"
+#include "Poco/Data/Session.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/ServerSocket.h"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// Hot-path functions of both services, each over a range of input sizes.
+// Throughput is reported as bytes or items per second; run through the
+// perf_micro_json target for JSON output and hardware counters.
+
+// --- Inputs ---
+
+// Name-like text of the given length; one character in 16 has to be
+// escaped.
+std::string makeText(std::size_t length) {
+    static const char SPECIAL[] = "&<>\"'";
+    std::string text;
+    text.reserve(length);
+    for (std::size_t i = 0; i < length; ++i) {
+        text += i % 16 == 15 ? SPECIAL[(i / 16) % 5] : static_cast<char>('a' + i % 26);
+    }
+    return text;
+}
+
+// A GetName request of about envelopeSize bytes. The Name element comes
+// after the padding, so finding it means reading the whole envelope.
+std::string makeGetNameRequest(std::size_t envelopeSize) {
+    std::string xml =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<soap:Envelope xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+        "<soap:Header><Trace>";
+    for (std::size_t i = 0; xml.size() < envelopeSize; ++i) {
+        xml += "<Span id=\"" + std::to_string(i) + "\">component</Span>";
+    }
+    xml += "</Trace></soap:Header><soap:Body><GetName><Name>John</Name></GetName></soap:Body></soap:Envelope>";
+    return xml;
+}
+
+// --- SOAP envelopes ---
+
+// range(0) is the input length.
+void BM_EscapeXml(benchmark::State& state) {
+    const std::string text = makeText(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(escapeXml(text));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// range(0) is the envelope size. The DOM parse GetName falls back to.
+void BM_ParseFirstNameFromXML(benchmark::State& state) {
+    const std::string xml = makeGetNameRequest(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parseFirstNameFromXML(xml));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * xml.size()));
+}
+
+// The same envelopes through the scan GetName tries first.
+void BM_FindNameElement(benchmark::State& state) {
+    const std::string xml = makeGetNameRequest(static_cast<std::size_t>(state.range(0)));
+    std::string_view name;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(findNameElement(xml, name));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * xml.size()));
+}
+
+// range(0) is the full name length. The buffer is reused, as GetName's
+// per-thread one is.
+void BM_MakeSoapResponse(benchmark::State& state) {
+    const std::string fullName = makeText(static_cast<std::size_t>(state.range(0)));
+    std::string out;
+    for (auto _ : state) {
+        makeSoapResponse(out, fullName);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+}
+
+// range(0) is the fault string length.
+void BM_MakeSoapFault(benchmark::State& state) {
+    const std::string faultString = makeText(static_cast<std::size_t>(state.range(0)));
+    std::string out;
+    for (auto _ : state) {
+        makeSoapFault(out, "Client.NameNotFoundInDB", faultString);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+}
+
+// sendSoapFault as the server runs it: keep-alive POSTs over loopback to
+// an in-process HTTPServer whose handler answers every one with a fault.
+
+// Set by the benchmark before its timed loop; the server threads only read
+// it while a request is in flight
+std::string& faultString() {
+    static std::string text;
+    return text;
+}
+
+class FaultHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    void handleRequest(Poco::Net::HTTPServerRequest& request,
+                       Poco::Net::HTTPServerResponse& response) override {
+        sendSoapFault(request, response, Poco::Net::HTTPResponse::HTTP_NOT_FOUND, "Client.NameNotFoundInDB",
+                      faultString());
+    }
+};
+
+class FaultHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+    Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest&) override {
+        return new FaultHandler;
+    }
+};
+
+// One server on an ephemeral port for the whole run
+Poco::UInt16 faultServerPort() {
+    static std::unique_ptr<Poco::Net::HTTPServer> pServer;
+    if (!pServer) {
+        Poco::Net::ServerSocket socket(Poco::Net::SocketAddress("127.0.0.1", 0));
+        Poco::Net::HTTPServerParams* params = new Poco::Net::HTTPServerParams;
+        params->setKeepAlive(true);
+        pServer.reset(new Poco::Net::HTTPServer(new FaultHandlerFactory, socket, params));
+        pServer->start();
+    }
+    return pServer->port();
+}
+
+// range(0) is the fault string length.
+void BM_SendSoapFault(benchmark::State& state) {
+    faultString() = makeText(static_cast<std::size_t>(state.range(0)));
+    Poco::Net::StreamSocket socket(Poco::Net::SocketAddress("127.0.0.1", faultServerPort()));
+    socket.setNoDelay(true);
+    const std::string request = "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 0\r\n\r\n";
+    std::string reply;
+
+    for (auto _ : state) {
+        socket.sendBytes(request.data(), static_cast<int>(request.size()));
+        if (!readResponse(socket, reply)) {
+            state.SkipWithError("Server closed the connection");
+            return;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * reply.size()));
+}
+
+// --- DatabaseService::getFullName ---
+
+// In-memory SQLite with the service's USER table (the dbo schema is an
+// attached database) and its first-name index, holding rows names
+// first0..first<rows-1>. Built once per size: filling it is not what is
+// being measured.
+Poco::Data::Session& userTable(int rows) {
+    static std::map<int, std::unique_ptr<Poco::Data::Session>> sessions;
+    std::unique_ptr<Poco::Data::Session>& pSession = sessions[rows];
+    if (!pSession) {
+        using namespace Poco::Data::Keywords;
+        Poco::Data::SQLite::Connector::registerConnector();
+        pSession.reset(new Poco::Data::Session("SQLite", ":memory:"));
+        Poco::Data::Session& session = *pSession;
+        session << "ATTACH DATABASE ':memory:' AS dbo", now;
+        session << "CREATE TABLE [dbo].[USER] (USER_FNAME TEXT NOT NULL, USER_LNAME TEXT NOT NULL)", now;
+        session << "CREATE INDEX [dbo].[IX_USER_FNAME] ON [USER] (USER_FNAME)", now;
+
+        std::vector<std::string> firstNames;
+        std::vector<std::string> lastNames;
+        for (int i = 0; i < rows; ++i) {
+            firstNames.push_back("first" + std::to_string(i));
+            lastNames.push_back("last" + std::to_string(i));
+        }
+        session.begin();
+        session << "INSERT INTO [dbo].[USER] (USER_FNAME, USER_LNAME) VALUES (?, ?)",
+            use(firstNames), use(lastNames), now;
+        session.commit();
+    }
+    return *pSession;
+}
+
+// range(0) is the table size; range(1) is 1 for names that are there, 0
+// for names that are not.
+void BM_GetFullName(benchmark::State& state) {
+    const int rows = static_cast<int>(state.range(0));
+    const bool hit = state.range(1) != 0;
+    DatabaseService db(userTable(rows), DatabaseService::READ_ONLY);
+
+    // Cycle through names spread over the table
+    std::vector<std::string> keys;
+    for (int i = 0; i < 256; ++i) {
+        keys.push_back((hit ? "first" : "missing") + std::to_string(static_cast<long long>(i) * rows / 256));
+    }
+    std::size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.getFullName(keys[next]));
+        next = (next + 1) % keys.size();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// --- PostHandler ---
+
+// What PostHandler does with a posted JSON record: parse it and write the
+// reply that echoes it back. range(0) is the body size; range(1) the
+// parser, 0 for Poco::JSON and 1 for the SIMD one.
+void BM_PostProcess(benchmark::State& state) {
+    const std::string json = makePayload(static_cast<std::size_t>(state.range(0)));
+    RecordProcessor processor(state.range(1) ? JsonEngine::Simd : JsonEngine::Standard);
+    for (auto _ : state) {
+        std::istringstream in(json);
+        std::ostringstream out;
+        processor.process(in, BodyEncoding::Json, out, BodyEncoding::Json);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_EscapeXml)->RangeMultiplier(8)->Range(16, 64 << 10);
+BENCHMARK(BM_ParseFirstNameFromXML)->RangeMultiplier(8)->Range(256, 256 << 10);
+BENCHMARK(BM_FindNameElement)->RangeMultiplier(8)->Range(256, 256 << 10);
+BENCHMARK(BM_MakeSoapResponse)->RangeMultiplier(8)->Range(16, 16 << 10);
+BENCHMARK(BM_MakeSoapFault)->RangeMultiplier(8)->Range(16, 16 << 10);
+BENCHMARK(BM_SendSoapFault)->RangeMultiplier(8)->Range(16, 16 << 10)->UseRealTime();
+BENCHMARK(BM_GetFullName)->ArgsProduct({ { 1000, 100000 }, { 1, 0 } })->ArgNames({ "rows", "hit" });
+BENCHMARK(BM_PostProcess)->ArgsProduct({ { 1 << 10, 64 << 10, 1 << 20 }, { 0, 1 } })->ArgNames({ "bytes", "simd" });
+
+BENCHMARK_MAIN();
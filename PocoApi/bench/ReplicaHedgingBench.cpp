@@ -0,0 +1,53 @@
+#include "ReplicaSet.hpp"
+#include <Poco/Data/SQLite/Connector.h>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int REPLICAS = 3;
+const int BASE_LATENCY_US = 1000;
+const int STALL_LATENCY_US = 50000;
+const int STALL_PERCENT = 2;
+
+// In-memory SQLite stand-ins for the replicas: each query takes 1 ms, and
+// 2% of them stall for 50 ms, as a replica does under a lock or GC pause.
+std::vector<Replica> standIns() {
+    Poco::Data::SQLite::Connector::registerConnector();
+    std::vector<Replica> replicas(REPLICAS);
+    for (auto& replica : replicas) {
+        replica.connector = "SQLite";
+        replica.connectionString = ":memory:";
+        replica.injectedLatency = [] {
+            thread_local std::mt19937 engine{ std::random_device{}() };
+            const bool stall = std::uniform_int_distribution<int>(0, 99)(engine) < STALL_PERCENT;
+            return std::chrono::microseconds(stall ? STALL_LATENCY_US : BASE_LATENCY_US);
+        };
+    }
+    return replicas;
+}
+
+// range(0): hedging off/on. Reports p50 and p99 read latency; with hedging
+// the stalls should mostly vanish from p99.
+void BM_ReplicaRead(benchmark::State& state) {
+    ReplicaSet replicas(standIns(), 8, state.range(0) != 0);
+    std::vector<double> latencies;
+    for (auto _ : state) {
+        const auto start = std::chrono::steady_clock::now();
+        benchmark::DoNotOptimize(replicas.read([](DatabaseService& db) { return db.isConnected(); }));
+        latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    state.counters["p50_ms"] = latencies[latencies.size() / 2];
+    state.counters["p99_ms"] = latencies[latencies.size() * 99 / 100];
+}
+
+} // namespace
+
+BENCHMARK(BM_ReplicaRead)->Arg(0)->Arg(1)->Iterations(2000)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,136 @@
+#include "BenchHttp.hpp"
+#include "ResponseWriter.hpp"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/ServerSocket.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace {
+
+// Keep-alive GETs over loopback to an in-process HTTPServer. Client,
+// network and request parsing cost the same on every path, so the
+// difference between Stream and Direct runs is how the server writes
+// its response: HTTPServerResponse::send()'s stream, or ResponseWriter.
+
+// Chunked bodies are sent in this many parts, each flushed
+const int CHUNKS = 8;
+
+// Set by each benchmark before its timed loop; the server threads only
+// read it while a request is in flight
+std::string& responseBody() {
+    static std::string body;
+    return body;
+}
+
+class BenchHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    BenchHandler(bool direct, bool chunked)
+        : _direct(direct), _chunked(chunked) {
+    }
+
+    void handleRequest(Poco::Net::HTTPServerRequest& request,
+                       Poco::Net::HTTPServerResponse& response) override {
+        const std::string& body = responseBody();
+        response.setContentType("application/json");
+        if (!_chunked) {
+            if (_direct) {
+                ResponseWriter(request, response).send(body);
+            } else {
+                response.setContentLength(body.size());
+                std::ostream& out = response.send();
+                out.write(body.data(), static_cast<std::streamsize>(body.size()));
+                out.flush();
+            }
+            return;
+        }
+
+        const std::size_t step = body.size() / CHUNKS;
+        if (_direct) {
+            ResponseWriter writer(request, response);
+            for (int i = 0; i < CHUNKS; ++i) {
+                writer.sendChunk(std::string_view(body).substr(i * step, step));
+            }
+            writer.finish();
+        } else {
+            response.setChunkedTransferEncoding(true);
+            std::ostream& out = response.send();
+            for (int i = 0; i < CHUNKS; ++i) {
+                out.write(body.data() + i * step, static_cast<std::streamsize>(step));
+                out.flush();
+            }
+        }
+    }
+
+private:
+    const bool _direct;
+    const bool _chunked;
+};
+
+class BenchHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+    Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& request) override {
+        const std::string& uri = request.getURI();
+        return new BenchHandler(uri.compare(0, 7, "/direct") == 0, uri.find("/chunked") != std::string::npos);
+    }
+};
+
+// One server on an ephemeral port for the whole run
+Poco::UInt16 serverPort() {
+    static std::unique_ptr<Poco::Net::HTTPServer> pServer;
+    if (!pServer) {
+        Poco::Net::ServerSocket socket(Poco::Net::SocketAddress("127.0.0.1", 0));
+        Poco::Net::HTTPServerParams* params = new Poco::Net::HTTPServerParams;
+        params->setKeepAlive(true);
+        pServer.reset(new Poco::Net::HTTPServer(new BenchHandlerFactory, socket, params));
+        pServer->start();
+    }
+    return pServer->port();
+}
+
+// range(0) is the body size in bytes.
+void runRoundTrips(benchmark::State& state, const std::string& path) {
+    responseBody().assign(static_cast<std::size_t>(state.range(0)), 'x');
+    Poco::Net::StreamSocket socket(Poco::Net::SocketAddress("127.0.0.1", serverPort()));
+    socket.setNoDelay(true);
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string reply;
+
+    for (auto _ : state) {
+        socket.sendBytes(request.data(), static_cast<int>(request.size()));
+        if (!readResponse(socket, reply)) {
+            state.SkipWithError("Server closed the connection");
+            return;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+void BM_StreamFixed(benchmark::State& state) {
+    runRoundTrips(state, "/stream/fixed");
+}
+
+void BM_DirectFixed(benchmark::State& state) {
+    runRoundTrips(state, "/direct/fixed");
+}
+
+void BM_StreamChunked(benchmark::State& state) {
+    runRoundTrips(state, "/stream/chunked");
+}
+
+void BM_DirectChunked(benchmark::State& state) {
+    runRoundTrips(state, "/direct/chunked");
+}
+
+} // namespace
+
+BENCHMARK(BM_StreamFixed)->Arg(256)->Arg(4 * 1024)->Arg(64 * 1024);
+BENCHMARK(BM_DirectFixed)->Arg(256)->Arg(4 * 1024)->Arg(64 * 1024);
+BENCHMARK(BM_StreamChunked)->Arg(256)->Arg(4 * 1024)->Arg(64 * 1024);
+BENCHMARK(BM_DirectChunked)->Arg(256)->Arg(4 * 1024)->Arg(64 * 1024);
+
+BENCHMARK_MAIN();
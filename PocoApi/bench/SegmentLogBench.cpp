@@ -0,0 +1,49 @@
+#include "BenchPayload.hpp"
+#include "storage/SegmentLog.hpp"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/TemporaryFile.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+
+namespace {
+
+// Concurrent appenders against one log, as request threads would be. The
+// difference between the two modes is how many appends share each sync.
+std::unique_ptr<SegmentLog> g_log;
+std::string g_directory;
+
+void appendLoop(benchmark::State& state, SegmentLog::SyncMode mode) {
+    if (state.thread_index() == 0) {
+        g_directory = Poco::TemporaryFile::tempName();
+        g_log.reset(new SegmentLog(g_directory, 64 * 1024 * 1024, mode));
+    }
+    const std::string record = makePayload(static_cast<std::size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(g_log->append(record));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * record.size()));
+
+    if (state.thread_index() == 0) {
+        g_log.reset();
+        Poco::File(g_directory).remove(true);
+    }
+}
+
+void BM_SyncEachRecord(benchmark::State& state) {
+    appendLoop(state, SegmentLog::SYNC_EACH_RECORD);
+}
+
+void BM_GroupCommit(benchmark::State& state) {
+    appendLoop(state, SegmentLog::GROUP_COMMIT);
+}
+
+} // namespace
+
+BENCHMARK(BM_SyncEachRecord)->Arg(256)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_GroupCommit)->Arg(256)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Poco/Base64Encoder.h"
+#include "Poco/Exception.h"
+#include "Poco/Types.h"
+#include <istream>
+#include <sstream>
+#include <string>
+
+// Helpers shared by the binary readers in this directory.
+namespace codec {
+
+// Same nesting limit as the JSON parsers.
+const int MAX_DEPTH = 128;
+
+inline unsigned char readByte(std::istream& in) {
+    const int c = in.get();
+    if (c == std::char_traits<char>::eof()) {
+        throw Poco::DataFormatException("Unexpected end of input");
+    }
+    return static_cast<unsigned char>(c);
+}
+
+inline Poco::UInt64 readBigEndian(std::istream& in, int bytes) {
+    Poco::UInt64 v = 0;
+    for (int i = 0; i < bytes; ++i) {
+        v = (v << 8) | readByte(in);
+    }
+    return v;
+}
+
+// Reads in small slices so a forged length prefix cannot force a large
+// allocation before the data has actually arrived.
+inline void readBytes(std::istream& in, Poco::UInt64 length, std::string& out) {
+    char chunk[4096];
+    while (length > 0) {
+        const std::size_t n = length < sizeof(chunk) ? static_cast<std::size_t>(length) : sizeof(chunk);
+        in.read(chunk, static_cast<std::streamsize>(n));
+        if (static_cast<std::size_t>(in.gcount()) != n) {
+            throw Poco::DataFormatException("Unexpected end of input");
+        }
+        out.append(chunk, n);
+        length -= n;
+    }
+}
+
+// Byte strings have no JSON equivalent; like RFC 8949 section 6.1 we
+// hand them on as unpadded base64url text.
+inline std::string toBase64Url(const std::string& bytes) {
+    std::ostringstream oss;
+    Poco::Base64Encoder encoder(oss, Poco::BASE64_URL_ENCODING | Poco::BASE64_NO_PADDING);
+    encoder.rdbuf()->setLineLength(0);
+    encoder << bytes;
+    encoder.close();
+    return oss.str();
+}
+
+} // namespace codec
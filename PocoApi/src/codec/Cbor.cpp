@@ -0,0 +1,316 @@
+#include "codec/Cbor.hpp"
+#include "codec/ByteIO.hpp"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const unsigned MAJOR_UNSIGNED = 0;
+const unsigned MAJOR_NEGATIVE = 1;
+const unsigned MAJOR_BYTES = 2;
+const unsigned MAJOR_TEXT = 3;
+const unsigned MAJOR_ARRAY = 4;
+const unsigned MAJOR_MAP = 5;
+const unsigned MAJOR_TAG = 6;
+const unsigned MAJOR_SIMPLE = 7;
+
+const unsigned INFO_INDEFINITE = 31;
+const unsigned char BREAK = 0xFF;
+
+// Reads the argument that follows an initial byte.
+Poco::UInt64 readArgument(std::istream& in, unsigned info) {
+    if (info < 24) return info;
+    switch (info) {
+        case 24: return codec::readBigEndian(in, 1);
+        case 25: return codec::readBigEndian(in, 2);
+        case 26: return codec::readBigEndian(in, 4);
+        case 27: return codec::readBigEndian(in, 8);
+        default:
+            throw Poco::DataFormatException("Invalid CBOR: reserved additional information");
+    }
+}
+
+double halfToDouble(Poco::UInt16 half) {
+    const int exponent = (half >> 10) & 0x1F;
+    const int mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        value = mantissa == 0 ? std::numeric_limits<double>::infinity()
+                              : std::numeric_limits<double>::quiet_NaN();
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+} // namespace
+
+// --- CborWriter implementation ---
+CborWriter::CborWriter(std::ostream& out)
+    : _out(out) {
+}
+
+void CborWriter::reset() {
+}
+
+void CborWriter::startObject() {
+    _out.put(static_cast<char>((MAJOR_MAP << 5) | INFO_INDEFINITE));
+}
+
+void CborWriter::endObject() {
+    _out.put(static_cast<char>(BREAK));
+}
+
+void CborWriter::startArray() {
+    _out.put(static_cast<char>((MAJOR_ARRAY << 5) | INFO_INDEFINITE));
+}
+
+void CborWriter::endArray() {
+    _out.put(static_cast<char>(BREAK));
+}
+
+void CborWriter::key(const std::string& k) {
+    value(k);
+}
+
+void CborWriter::null() {
+    _out.put(static_cast<char>(0xF6));
+}
+
+void CborWriter::value(int v) {
+    writeSigned(v);
+}
+
+void CborWriter::value(unsigned v) {
+    writeUnsigned(v);
+}
+
+#if defined(POCO_HAVE_INT64)
+void CborWriter::value(Poco::Int64 v) {
+    writeSigned(v);
+}
+
+void CborWriter::value(Poco::UInt64 v) {
+    writeUnsigned(v);
+}
+#endif
+
+void CborWriter::value(const std::string& value) {
+    writeHead(MAJOR_TEXT, value.size());
+    _out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+void CborWriter::value(double d) {
+    // Use single precision whenever it round-trips exactly.
+    const float f = static_cast<float>(d);
+    if (static_cast<double>(f) == d) {
+        Poco::UInt32 bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        _out.put(static_cast<char>(0xFA));
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            _out.put(static_cast<char>((bits >> shift) & 0xFF));
+        }
+    } else {
+        Poco::UInt64 bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        _out.put(static_cast<char>(0xFB));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            _out.put(static_cast<char>((bits >> shift) & 0xFF));
+        }
+    }
+}
+
+void CborWriter::value(bool b) {
+    _out.put(static_cast<char>(b ? 0xF5 : 0xF4));
+}
+
+void CborWriter::writeHead(unsigned major, Poco::UInt64 arg) {
+    const unsigned char m = static_cast<unsigned char>(major << 5);
+    if (arg < 24) {
+        _out.put(static_cast<char>(m | arg));
+        return;
+    }
+    int bytes;
+    if (arg <= 0xFF) {
+        _out.put(static_cast<char>(m | 24));
+        bytes = 1;
+    } else if (arg <= 0xFFFF) {
+        _out.put(static_cast<char>(m | 25));
+        bytes = 2;
+    } else if (arg <= 0xFFFFFFFFULL) {
+        _out.put(static_cast<char>(m | 26));
+        bytes = 4;
+    } else {
+        _out.put(static_cast<char>(m | 27));
+        bytes = 8;
+    }
+    for (int i = bytes - 1; i >= 0; --i) {
+        _out.put(static_cast<char>((arg >> (8 * i)) & 0xFF));
+    }
+}
+
+void CborWriter::writeSigned(Poco::Int64 v) {
+    if (v >= 0) {
+        writeHead(MAJOR_UNSIGNED, static_cast<Poco::UInt64>(v));
+    } else {
+        writeHead(MAJOR_NEGATIVE, static_cast<Poco::UInt64>(-(v + 1)));
+    }
+}
+
+void CborWriter::writeUnsigned(Poco::UInt64 v) {
+    writeHead(MAJOR_UNSIGNED, v);
+}
+
+// --- CborReader implementation ---
+CborReader::CborReader(const Poco::JSON::Handler::Ptr& pHandler)
+    : _pHandler(pHandler) {
+}
+
+void CborReader::parse(std::istream& in) {
+    item(in, 0);
+    if (in.peek() != std::char_traits<char>::eof()) {
+        throw Poco::DataFormatException("Invalid CBOR: unexpected data after item");
+    }
+}
+
+void CborReader::item(std::istream& in, int depth) {
+    if (depth > codec::MAX_DEPTH) {
+        throw Poco::DataFormatException("Maximum depth exceeded");
+    }
+
+    const unsigned char initial = codec::readByte(in);
+    const unsigned major = initial >> 5;
+    const unsigned info = initial & 0x1F;
+
+    switch (major) {
+        case MAJOR_UNSIGNED: {
+            const Poco::UInt64 v = readArgument(in, info);
+            if (v <= static_cast<Poco::UInt64>(std::numeric_limits<Poco::Int64>::max())) {
+                _pHandler->value(static_cast<Poco::Int64>(v));
+            } else {
+                _pHandler->value(v);
+            }
+            break;
+        }
+        case MAJOR_NEGATIVE: {
+            const Poco::UInt64 v = readArgument(in, info);
+            if (v > static_cast<Poco::UInt64>(std::numeric_limits<Poco::Int64>::max())) {
+                throw Poco::DataFormatException("Invalid CBOR: negative integer out of range");
+            }
+            _pHandler->value(-1 - static_cast<Poco::Int64>(v));
+            break;
+        }
+        case MAJOR_BYTES:
+            _pHandler->value(codec::toBase64Url(text(in, major, info)));
+            break;
+        case MAJOR_TEXT:
+            _pHandler->value(text(in, major, info));
+            break;
+        case MAJOR_ARRAY:
+            _pHandler->startArray();
+            if (info == INFO_INDEFINITE) {
+                while (in.peek() != BREAK) {
+                    item(in, depth + 1);
+                }
+                in.get();
+            } else {
+                for (Poco::UInt64 n = readArgument(in, info); n > 0; --n) {
+                    item(in, depth + 1);
+                }
+            }
+            _pHandler->endArray();
+            break;
+        case MAJOR_MAP:
+            _pHandler->startObject();
+            if (info == INFO_INDEFINITE) {
+                while (in.peek() != BREAK) {
+                    mapKey(in);
+                    item(in, depth + 1);
+                }
+                in.get();
+            } else {
+                for (Poco::UInt64 n = readArgument(in, info); n > 0; --n) {
+                    mapKey(in);
+                    item(in, depth + 1);
+                }
+            }
+            _pHandler->endObject();
+            break;
+        case MAJOR_TAG:
+            // Tags only annotate the item that follows.
+            readArgument(in, info);
+            item(in, depth + 1);
+            break;
+        case MAJOR_SIMPLE:
+            switch (info) {
+                case 20: _pHandler->value(false); break;
+                case 21: _pHandler->value(true);  break;
+                case 22:
+                case 23: _pHandler->null();        break;
+                case 25: _pHandler->value(halfToDouble(static_cast<Poco::UInt16>(codec::readBigEndian(in, 2)))); break;
+                case 26: {
+                    const Poco::UInt32 bits = static_cast<Poco::UInt32>(codec::readBigEndian(in, 4));
+                    float f;
+                    std::memcpy(&f, &bits, sizeof(f));
+                    _pHandler->value(static_cast<double>(f));
+                    break;
+                }
+                case 27: {
+                    const Poco::UInt64 bits = codec::readBigEndian(in, 8);
+                    double d;
+                    std::memcpy(&d, &bits, sizeof(d));
+                    _pHandler->value(d);
+                    break;
+                }
+                default:
+                    throw Poco::DataFormatException("Invalid CBOR: unsupported simple value");
+            }
+            break;
+    }
+}
+
+void CborReader::mapKey(std::istream& in) {
+    const unsigned char initial = codec::readByte(in);
+    const unsigned major = initial >> 5;
+    const unsigned info = initial & 0x1F;
+
+    switch (major) {
+        case MAJOR_TEXT:
+            _pHandler->key(text(in, major, info));
+            break;
+        case MAJOR_UNSIGNED:
+            _pHandler->key(std::to_string(readArgument(in, info)));
+            break;
+        case MAJOR_NEGATIVE: {
+            const Poco::UInt64 v = readArgument(in, info);
+            if (v > static_cast<Poco::UInt64>(std::numeric_limits<Poco::Int64>::max())) {
+                throw Poco::DataFormatException("Invalid CBOR: negative integer out of range");
+            }
+            _pHandler->key(std::to_string(-1 - static_cast<Poco::Int64>(v)));
+            break;
+        }
+        default:
+            throw Poco::DataFormatException("Invalid CBOR: map keys must be text or integers");
+    }
+}
+
+std::string CborReader::text(std::istream& in, unsigned major, unsigned info) {
+    std::string result;
+    if (info != INFO_INDEFINITE) {
+        codec::readBytes(in, readArgument(in, info), result);
+        return result;
+    }
+    // Indefinite-length strings are a series of definite chunks.
+    for (;;) {
+        const unsigned char initial = codec::readByte(in);
+        if (initial == BREAK) break;
+        if ((initial >> 5) != major || (initial & 0x1F) == INFO_INDEFINITE) {
+            throw Poco::DataFormatException("Invalid CBOR: bad string chunk");
+        }
+        codec::readBytes(in, readArgument(in, initial & 0x1F), result);
+    }
+    return result;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Poco/JSON/Handler.h"
+#include <istream>
+#include <ostream>
+#include <string>
+
+// CBOR (RFC 8949) support built on Poco::JSON::Handler, so CBOR can be
+// transcoded to and from any other handler without building a DOM.
+
+// Writes handler events as CBOR. Maps and arrays use indefinite-length
+// encoding so output can be streamed before their size is known.
+class CborWriter : public Poco::JSON::Handler {
+public:
+    explicit CborWriter(std::ostream& out);
+
+    void reset() override;
+    void startObject() override;
+    void endObject() override;
+    void startArray() override;
+    void endArray() override;
+    void key(const std::string& k) override;
+    void null() override;
+    void value(int v) override;
+    void value(unsigned v) override;
+#if defined(POCO_HAVE_INT64)
+    void value(Poco::Int64 v) override;
+    void value(Poco::UInt64 v) override;
+#endif
+    void value(const std::string& value) override;
+    void value(double d) override;
+    void value(bool b) override;
+
+private:
+    void writeHead(unsigned major, Poco::UInt64 arg);
+    void writeSigned(Poco::Int64 v);
+    void writeUnsigned(Poco::UInt64 v);
+
+    std::ostream& _out;
+};
+
+// Reads one CBOR data item from a stream and reports it to a handler.
+// Throws Poco::DataFormatException on malformed or unsupported input.
+class CborReader {
+public:
+    explicit CborReader(const Poco::JSON::Handler::Ptr& pHandler);
+
+    void parse(std::istream& in);
+
+private:
+    void item(std::istream& in, int depth);
+    void mapKey(std::istream& in);
+    std::string text(std::istream& in, unsigned major, unsigned info);
+
+    Poco::JSON::Handler::Ptr _pHandler;
+};
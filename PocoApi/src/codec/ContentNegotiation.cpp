@@ -0,0 +1,100 @@
+#include "codec/ContentNegotiation.hpp"
+#include "codec/Cbor.hpp"
+#include "codec/MessagePack.hpp"
+#include "Poco/JSON/PrintHandler.h"
+#include "Poco/Net/MediaType.h"
+#include "Poco/NumberParser.h"
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+
+namespace {
+
+const std::string MEDIA_TYPE_JSON = "application/json";
+const std::string MEDIA_TYPE_CBOR = "application/cbor";
+const std::string MEDIA_TYPE_MSGPACK = "application/msgpack";
+
+bool encodingFromMediaType(const Poco::Net::MediaType& mediaType, BodyEncoding& encoding) {
+    if (Poco::icompare(mediaType.getType(), "application") != 0) {
+        return false;
+    }
+    const std::string subType = Poco::toLower(mediaType.getSubType());
+    if (subType == "json" || Poco::endsWith(subType, std::string("+json"))) {
+        encoding = BodyEncoding::Json;
+    } else if (subType == "cbor" || Poco::endsWith(subType, std::string("+cbor"))) {
+        encoding = BodyEncoding::Cbor;
+    } else if (subType == "msgpack" || subType == "x-msgpack" || subType == "vnd.msgpack") {
+        encoding = BodyEncoding::MessagePack;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace ContentNegotiation {
+
+const std::string& mediaType(BodyEncoding encoding) {
+    switch (encoding) {
+        case BodyEncoding::Cbor:        return MEDIA_TYPE_CBOR;
+        case BodyEncoding::MessagePack: return MEDIA_TYPE_MSGPACK;
+        default:                        return MEDIA_TYPE_JSON;
+    }
+}
+
+bool fromContentType(const std::string& contentType, BodyEncoding& encoding) {
+    if (Poco::trim(contentType).empty()) {
+        encoding = BodyEncoding::Json;
+        return true;
+    }
+    try {
+        return encodingFromMediaType(Poco::Net::MediaType(contentType), encoding);
+    } catch (const Poco::Exception&) {
+        return false;
+    }
+}
+
+bool fromAccept(const std::string& accept, BodyEncoding preferred, BodyEncoding& encoding) {
+    if (Poco::trim(accept).empty()) {
+        encoding = preferred;
+        return true;
+    }
+
+    double bestQuality = 0.0;
+    Poco::StringTokenizer ranges(accept, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+    for (const auto& range : ranges) {
+        try {
+            Poco::Net::MediaType mediaType(range);
+            double quality = 1.0;
+            if (mediaType.hasParameter("q")) {
+                quality = Poco::NumberParser::parseFloat(mediaType.getParameter("q"));
+            }
+            if (quality <= bestQuality) {
+                continue;
+            }
+
+            BodyEncoding candidate;
+            if (mediaType.getSubType() == "*"
+                && (mediaType.getType() == "*" || Poco::icompare(mediaType.getType(), "application") == 0)) {
+                candidate = preferred;
+            } else if (!encodingFromMediaType(mediaType, candidate)) {
+                continue;
+            }
+            encoding = candidate;
+            bestQuality = quality;
+        } catch (const Poco::Exception&) {
+            // Skip malformed ranges rather than failing the whole request.
+        }
+    }
+    return bestQuality > 0.0;
+}
+
+Poco::JSON::Handler::Ptr createWriter(BodyEncoding encoding, std::ostream& out) {
+    switch (encoding) {
+        case BodyEncoding::Cbor:        return new CborWriter(out);
+        case BodyEncoding::MessagePack: return new MessagePackWriter(out);
+        default:                        return new Poco::JSON::PrintHandler(out);
+    }
+}
+
+}
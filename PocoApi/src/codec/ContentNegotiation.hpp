@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Poco/JSON/Handler.h"
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Body encodings PostHandler can read and write.
+enum class BodyEncoding {
+    Json,
+    Cbor,
+    MessagePack
+};
+
+namespace ContentNegotiation {
+
+// Media type sent back in Content-Type for an encoding.
+const std::string& mediaType(BodyEncoding encoding);
+
+// Maps a request Content-Type to an encoding. Returns false for media types
+// we cannot decode; a missing Content-Type is treated as JSON.
+bool fromContentType(const std::string& contentType, BodyEncoding& encoding);
+
+// Picks the response encoding from an Accept header, honouring q-values.
+// Wildcards and a missing header resolve to preferred. Returns false if
+// nothing acceptable is on offer.
+bool fromAccept(const std::string& accept, BodyEncoding preferred, BodyEncoding& encoding);
+
+// Creates a handler that encodes events to out. The handler writes into
+// out as it goes, so out should be a buffer if errors must stay reportable.
+Poco::JSON::Handler::Ptr createWriter(BodyEncoding encoding, std::ostream& out);
+
+}
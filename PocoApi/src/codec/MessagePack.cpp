@@ -0,0 +1,353 @@
+#include "codec/MessagePack.hpp"
+#include "codec/ByteIO.hpp"
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Placeholder header written when a container starts: map32/array32 with
+// a four-byte count, shrunk once the real count is known.
+const std::size_t FULL_HEADER_SIZE = 5;
+
+} // namespace
+
+// --- MessagePackWriter implementation ---
+MessagePackWriter::MessagePackWriter(std::ostream& out)
+    : _out(out) {
+}
+
+void MessagePackWriter::reset() {
+    _buffer.clear();
+    _stack.clear();
+}
+
+void MessagePackWriter::startObject() {
+    startContainer(true);
+}
+
+void MessagePackWriter::endObject() {
+    endContainer(true);
+}
+
+void MessagePackWriter::startArray() {
+    startContainer(false);
+}
+
+void MessagePackWriter::endArray() {
+    endContainer(false);
+}
+
+void MessagePackWriter::key(const std::string& k) {
+    if (_stack.empty() || !_stack.back().isMap) {
+        throw Poco::IllegalStateException("MessagePack key outside of a map");
+    }
+    ++_stack.back().count;
+    writeString(k);
+}
+
+void MessagePackWriter::null() {
+    beforeValue();
+    put(0xC0);
+    afterValue();
+}
+
+void MessagePackWriter::value(int v) {
+    beforeValue();
+    writeSigned(v);
+    afterValue();
+}
+
+void MessagePackWriter::value(unsigned v) {
+    beforeValue();
+    writeUnsigned(v);
+    afterValue();
+}
+
+#if defined(POCO_HAVE_INT64)
+void MessagePackWriter::value(Poco::Int64 v) {
+    beforeValue();
+    writeSigned(v);
+    afterValue();
+}
+
+void MessagePackWriter::value(Poco::UInt64 v) {
+    beforeValue();
+    writeUnsigned(v);
+    afterValue();
+}
+#endif
+
+void MessagePackWriter::value(const std::string& value) {
+    beforeValue();
+    writeString(value);
+    afterValue();
+}
+
+void MessagePackWriter::value(double d) {
+    beforeValue();
+    // Use float32 whenever it round-trips exactly.
+    const float f = static_cast<float>(d);
+    if (static_cast<double>(f) == d) {
+        Poco::UInt32 bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        put(0xCA);
+        putBE(bits, 4);
+    } else {
+        Poco::UInt64 bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        put(0xCB);
+        putBE(bits, 8);
+    }
+    afterValue();
+}
+
+void MessagePackWriter::value(bool b) {
+    beforeValue();
+    put(b ? 0xC3 : 0xC2);
+    afterValue();
+}
+
+void MessagePackWriter::beforeValue() {
+    if (!_stack.empty() && !_stack.back().isMap) {
+        ++_stack.back().count;
+    }
+}
+
+void MessagePackWriter::afterValue() {
+    // Nothing can be patched any more once the outermost value is done.
+    if (_stack.empty()) {
+        _out.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+        _buffer.clear();
+    }
+}
+
+void MessagePackWriter::startContainer(bool isMap) {
+    beforeValue();
+    _stack.push_back(Container{ _buffer.size(), 0, isMap });
+    _buffer.append(FULL_HEADER_SIZE, '\0');
+}
+
+void MessagePackWriter::endContainer(bool isMap) {
+    if (_stack.empty() || _stack.back().isMap != isMap) {
+        throw Poco::IllegalStateException("Unbalanced MessagePack container");
+    }
+    const Container c = _stack.back();
+    _stack.pop_back();
+
+    // Everything after the header belongs to this container, so shrinking
+    // the header only moves this container's own bytes.
+    unsigned char header[FULL_HEADER_SIZE];
+    std::size_t headerSize;
+    if (c.count < 16) {
+        header[0] = static_cast<unsigned char>((isMap ? 0x80 : 0x90) | c.count);
+        headerSize = 1;
+    } else if (c.count <= 0xFFFF) {
+        header[0] = isMap ? 0xDE : 0xDC;
+        header[1] = static_cast<unsigned char>(c.count >> 8);
+        header[2] = static_cast<unsigned char>(c.count);
+        headerSize = 3;
+    } else {
+        header[0] = isMap ? 0xDF : 0xDD;
+        for (int i = 0; i < 4; ++i) {
+            header[1 + i] = static_cast<unsigned char>(c.count >> (24 - 8 * i));
+        }
+        headerSize = FULL_HEADER_SIZE;
+    }
+    _buffer.replace(c.headerOffset, FULL_HEADER_SIZE, reinterpret_cast<const char*>(header), headerSize);
+    afterValue();
+}
+
+void MessagePackWriter::writeString(const std::string& s) {
+    const std::size_t len = s.size();
+    if (len < 32) {
+        put(static_cast<unsigned char>(0xA0 | len));
+    } else if (len <= 0xFF) {
+        put(0xD9);
+        putBE(len, 1);
+    } else if (len <= 0xFFFF) {
+        put(0xDA);
+        putBE(len, 2);
+    } else if (len <= 0xFFFFFFFFULL) {
+        put(0xDB);
+        putBE(len, 4);
+    } else {
+        throw Poco::RangeException("String too long for MessagePack");
+    }
+    _buffer.append(s);
+}
+
+void MessagePackWriter::writeSigned(Poco::Int64 v) {
+    if (v >= 0) {
+        writeUnsigned(static_cast<Poco::UInt64>(v));
+    } else if (v >= -32) {
+        put(static_cast<unsigned char>(v));
+    } else if (v >= std::numeric_limits<Poco::Int8>::min()) {
+        put(0xD0);
+        putBE(static_cast<Poco::UInt64>(v), 1);
+    } else if (v >= std::numeric_limits<Poco::Int16>::min()) {
+        put(0xD1);
+        putBE(static_cast<Poco::UInt64>(v), 2);
+    } else if (v >= std::numeric_limits<Poco::Int32>::min()) {
+        put(0xD2);
+        putBE(static_cast<Poco::UInt64>(v), 4);
+    } else {
+        put(0xD3);
+        putBE(static_cast<Poco::UInt64>(v), 8);
+    }
+}
+
+void MessagePackWriter::writeUnsigned(Poco::UInt64 v) {
+    if (v < 128) {
+        put(static_cast<unsigned char>(v));
+    } else if (v <= 0xFF) {
+        put(0xCC);
+        putBE(v, 1);
+    } else if (v <= 0xFFFF) {
+        put(0xCD);
+        putBE(v, 2);
+    } else if (v <= 0xFFFFFFFFULL) {
+        put(0xCE);
+        putBE(v, 4);
+    } else {
+        put(0xCF);
+        putBE(v, 8);
+    }
+}
+
+void MessagePackWriter::put(unsigned char byte) {
+    _buffer.push_back(static_cast<char>(byte));
+}
+
+void MessagePackWriter::putBE(Poco::UInt64 v, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        put(static_cast<unsigned char>((v >> (8 * i)) & 0xFF));
+    }
+}
+
+// --- MessagePackReader implementation ---
+MessagePackReader::MessagePackReader(const Poco::JSON::Handler::Ptr& pHandler)
+    : _pHandler(pHandler) {
+}
+
+void MessagePackReader::parse(std::istream& in) {
+    item(in, 0);
+    if (in.peek() != std::char_traits<char>::eof()) {
+        throw Poco::DataFormatException("Invalid MessagePack: unexpected data after object");
+    }
+}
+
+void MessagePackReader::item(std::istream& in, int depth) {
+    if (depth > codec::MAX_DEPTH) {
+        throw Poco::DataFormatException("Maximum depth exceeded");
+    }
+
+    const unsigned char b = codec::readByte(in);
+    Poco::UInt64 count = 0;
+    bool isMap = false;
+    std::string s;
+
+    if (b <= 0x7F) {
+        _pHandler->value(static_cast<Poco::Int64>(b));
+        return;
+    }
+    if (b >= 0xE0) {
+        _pHandler->value(static_cast<Poco::Int64>(static_cast<Poco::Int8>(b)));
+        return;
+    }
+    if ((b & 0xE0) == 0xA0) {
+        codec::readBytes(in, b & 0x1F, s);
+        _pHandler->value(s);
+        return;
+    }
+    if ((b & 0xF0) == 0x80 || (b & 0xF0) == 0x90) {
+        isMap = (b & 0xF0) == 0x80;
+        count = b & 0x0F;
+    } else {
+        switch (b) {
+            case 0xC0: _pHandler->null(); return;
+            case 0xC2: _pHandler->value(false); return;
+            case 0xC3: _pHandler->value(true); return;
+            case 0xC4: case 0xC5: case 0xC6:
+                codec::readBytes(in, codec::readBigEndian(in, 1 << (b - 0xC4)), s);
+                _pHandler->value(codec::toBase64Url(s));
+                return;
+            case 0xCA: {
+                const Poco::UInt32 bits = static_cast<Poco::UInt32>(codec::readBigEndian(in, 4));
+                float f;
+                std::memcpy(&f, &bits, sizeof(f));
+                _pHandler->value(static_cast<double>(f));
+                return;
+            }
+            case 0xCB: {
+                const Poco::UInt64 bits = codec::readBigEndian(in, 8);
+                double d;
+                std::memcpy(&d, &bits, sizeof(d));
+                _pHandler->value(d);
+                return;
+            }
+            case 0xCC: case 0xCD: case 0xCE: case 0xCF: {
+                const Poco::UInt64 v = codec::readBigEndian(in, 1 << (b - 0xCC));
+                if (v <= static_cast<Poco::UInt64>(std::numeric_limits<Poco::Int64>::max())) {
+                    _pHandler->value(static_cast<Poco::Int64>(v));
+                } else {
+                    _pHandler->value(v);
+                }
+                return;
+            }
+            case 0xD0: _pHandler->value(static_cast<Poco::Int64>(static_cast<Poco::Int8>(codec::readBigEndian(in, 1)))); return;
+            case 0xD1: _pHandler->value(static_cast<Poco::Int64>(static_cast<Poco::Int16>(codec::readBigEndian(in, 2)))); return;
+            case 0xD2: _pHandler->value(static_cast<Poco::Int64>(static_cast<Poco::Int32>(codec::readBigEndian(in, 4)))); return;
+            case 0xD3: _pHandler->value(static_cast<Poco::Int64>(codec::readBigEndian(in, 8))); return;
+            case 0xD9: case 0xDA: case 0xDB:
+                codec::readBytes(in, codec::readBigEndian(in, 1 << (b - 0xD9)), s);
+                _pHandler->value(s);
+                return;
+            case 0xDC: count = codec::readBigEndian(in, 2); break;
+            case 0xDD: count = codec::readBigEndian(in, 4); break;
+            case 0xDE: count = codec::readBigEndian(in, 2); isMap = true; break;
+            case 0xDF: count = codec::readBigEndian(in, 4); isMap = true; break;
+            default:
+                throw Poco::DataFormatException("Invalid MessagePack: unsupported type byte");
+        }
+    }
+
+    if (isMap) {
+        _pHandler->startObject();
+        for (; count > 0; --count) {
+            mapKey(in);
+            item(in, depth + 1);
+        }
+        _pHandler->endObject();
+    } else {
+        _pHandler->startArray();
+        for (; count > 0; --count) {
+            item(in, depth + 1);
+        }
+        _pHandler->endArray();
+    }
+}
+
+void MessagePackReader::mapKey(std::istream& in) {
+    const unsigned char b = codec::readByte(in);
+    std::string k;
+
+    if ((b & 0xE0) == 0xA0) {
+        codec::readBytes(in, b & 0x1F, k);
+    } else if (b >= 0xD9 && b <= 0xDB) {
+        codec::readBytes(in, codec::readBigEndian(in, 1 << (b - 0xD9)), k);
+    } else if (b <= 0x7F) {
+        k = std::to_string(b);
+    } else if (b >= 0xE0) {
+        k = std::to_string(static_cast<Poco::Int8>(b));
+    } else if (b >= 0xCC && b <= 0xCF) {
+        k = std::to_string(codec::readBigEndian(in, 1 << (b - 0xCC)));
+    } else if (b >= 0xD0 && b <= 0xD3) {
+        const int bytes = 1 << (b - 0xD0);
+        const Poco::UInt64 raw = codec::readBigEndian(in, bytes);
+        const int shift = 64 - 8 * bytes;
+        k = std::to_string(static_cast<Poco::Int64>(raw << shift) >> shift);
+    } else {
+        throw Poco::DataFormatException("Invalid MessagePack: map keys must be strings or integers");
+    }
+    _pHandler->key(k);
+}
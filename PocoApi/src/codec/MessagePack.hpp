@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Poco/JSON/Handler.h"
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// MessagePack support built on Poco::JSON::Handler, mirroring Cbor.hpp.
+
+// Writes handler events as MessagePack. MessagePack containers carry their
+// element count up front, so a top-level container is buffered until it is
+// closed; counts are patched in and headers shrunk to the smallest form.
+class MessagePackWriter : public Poco::JSON::Handler {
+public:
+    explicit MessagePackWriter(std::ostream& out);
+
+    void reset() override;
+    void startObject() override;
+    void endObject() override;
+    void startArray() override;
+    void endArray() override;
+    void key(const std::string& k) override;
+    void null() override;
+    void value(int v) override;
+    void value(unsigned v) override;
+#if defined(POCO_HAVE_INT64)
+    void value(Poco::Int64 v) override;
+    void value(Poco::UInt64 v) override;
+#endif
+    void value(const std::string& value) override;
+    void value(double d) override;
+    void value(bool b) override;
+
+private:
+    struct Container {
+        std::size_t headerOffset;
+        Poco::UInt32 count;
+        bool isMap;
+    };
+
+    void beforeValue();
+    void afterValue();
+    void startContainer(bool isMap);
+    void endContainer(bool isMap);
+    void writeString(const std::string& s);
+    void writeSigned(Poco::Int64 v);
+    void writeUnsigned(Poco::UInt64 v);
+    void put(unsigned char byte);
+    void putBE(Poco::UInt64 v, int bytes);
+
+    std::ostream& _out;
+    std::string _buffer;
+    std::vector<Container> _stack;
+};
+
+// Reads one MessagePack object from a stream and reports it to a handler.
+// Throws Poco::DataFormatException on malformed or unsupported input.
+class MessagePackReader {
+public:
+    explicit MessagePackReader(const Poco::JSON::Handler::Ptr& pHandler);
+
+    void parse(std::istream& in);
+
+private:
+    void item(std::istream& in, int depth);
+    void mapKey(std::istream& in);
+
+    Poco::JSON::Handler::Ptr _pHandler;
+};
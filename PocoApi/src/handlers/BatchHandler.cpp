@@ -0,0 +1,132 @@
+#include "BatchHandler.hpp"
+#include "ResponseWriter.hpp"
+#include "Poco/JSON/PrintHandler.h"
+#include "Poco/String.h"
+#include <sstream>
+#include <streambuf>
+
+namespace {
+
+const std::string CONTENT_TYPE_NDJSON = "application/x-ndjson";
+
+// Longest accepted record line; longer lines are skipped and reported.
+const std::size_t MAX_RECORD_SIZE = 1024 * 1024;
+
+// Replies are flushed to the client as a chunk after this many records,
+// or sooner once the input has nothing more buffered.
+const int FLUSH_EVERY = 32;
+
+// Reads the next line into line, without its terminator. Returns false
+// at end of input; sets tooLong (and discards the rest of the line) if
+// the line exceeds MAX_RECORD_SIZE.
+bool readRecordLine(std::streambuf& in, std::string& line, bool& tooLong) {
+    line.clear();
+    tooLong = false;
+    int c = in.sbumpc();
+    if (c == std::char_traits<char>::eof()) {
+        return false;
+    }
+    for (; c != std::char_traits<char>::eof() && c != '\n'; c = in.sbumpc()) {
+        if (line.size() < MAX_RECORD_SIZE) {
+            line.push_back(static_cast<char>(c));
+        } else {
+            tooLong = true;
+        }
+    }
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return true;
+}
+
+} // namespace
+
+BatchHandler::BatchHandler(JsonEngine engine, RecordSink* pSink)
+    : _processor(engine, pSink) {
+}
+
+void BatchHandler::handleRequest(Poco::Net::HTTPServerRequest& request, 
+                               Poco::Net::HTTPServerResponse& response) {
+    response.setChunkedTransferEncoding(true);
+    response.setContentType(CONTENT_TYPE_NDJSON);
+    ResponseWriter writer(request, response);
+
+    try {
+        processRecords(request.stream(), writer);
+    } catch (const std::exception& ex) {
+        // Reading the batch failed (timeout, reset, bad chunk framing) or
+        // the client went away. Once the headers are out nothing may reach
+        // Poco, which would write its own status line into the body: end
+        // without the last chunk, so the client sees a truncated response.
+        response.setKeepAlive(false);
+        if (writer.sent()) {
+            return;
+        }
+        std::ostringstream body;
+        RecordProcessor::writeError(body, BodyEncoding::Json, ex.what());
+        response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+        response.setContentType(ContentNegotiation::mediaType(BodyEncoding::Json));
+        writer.send(body.str());
+    }
+}
+
+void BatchHandler::processRecords(std::istream& stream, ResponseWriter& writer) {
+    std::streambuf& in = *stream.rdbuf();
+    std::string line;
+    std::ostringstream reply;
+    std::string pending;  // reply lines not yet sent
+    int unsent = 0;
+    bool tooLong = false;
+    Poco::UInt64 records = 0;
+    Poco::UInt64 errors = 0;
+
+    while (readRecordLine(in, line, tooLong)) {
+        if (tooLong || !Poco::trimInPlace(line).empty()) {
+            ++records;
+
+            // Encode into a buffer so a bad record yields an error line only
+            reply.str(std::string());
+            if (tooLong) {
+                ++errors;
+                RecordProcessor::writeError(reply, BodyEncoding::Json,
+                    "Record exceeds " + std::to_string(MAX_RECORD_SIZE) + " bytes");
+            } else {
+                try {
+                    std::istringstream record(line);
+                    _processor.process(record, BodyEncoding::Json, reply, BodyEncoding::Json);
+                } catch (const std::exception& ex) {
+                    ++errors;
+                    reply.str(std::string());
+                    RecordProcessor::writeError(reply, BodyEncoding::Json, ex.what());
+                }
+            }
+            pending += reply.str();
+            pending += '\n';
+            ++unsent;
+        }
+
+        // A client that waits for each reply before sending the next
+        // record has nothing more buffered; it gets its reply right away
+        if (unsent > 0 && (unsent >= FLUSH_EVERY || in.in_avail() == 0)) {
+            writer.sendChunk(pending);
+            pending.clear();
+            unsent = 0;
+        }
+    }
+
+    // Summary line, sent with whatever replies are still pending
+    reply.str(std::string());
+    Poco::JSON::PrintHandler summary(reply);
+    summary.startObject();
+    summary.key("status");
+    summary.value(std::string(errors ? "partial" : "done"));
+    summary.key("records");
+    summary.value(records);
+    summary.key("errors");
+    summary.value(errors);
+    summary.endObject();
+    pending += reply.str();
+    pending += '\n';
+    writer.sendChunk(pending);
+    writer.finish();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ResponseWriter.hpp"
+#include "handlers/RecordProcessor.hpp"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+// Bulk ingest of newline-delimited JSON. Each line is one record, run
+// through the same RecordProcessor as /api/data as soon as it has been
+// read; its reply is streamed back as one NDJSON line of a chunked
+// response, in input order, followed by a summary line. Only one record
+// is held in memory at a time however large the batch is. A batch that
+// cannot be read to the end is answered 400 if nothing was sent yet, and
+// otherwise cut off without its summary line.
+class BatchHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    explicit BatchHandler(JsonEngine engine = JsonEngine::Standard, RecordSink* pSink = nullptr);
+
+    void handleRequest(Poco::Net::HTTPServerRequest& request, 
+                      Poco::Net::HTTPServerResponse& response) override;
+
+private:
+    // Reads, processes and answers the records, then the summary line.
+    // Throws if reading the request or writing the response fails.
+    void processRecords(std::istream& stream, ResponseWriter& writer);
+
+    RecordProcessor _processor;
+};
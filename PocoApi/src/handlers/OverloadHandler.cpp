@@ -0,0 +1,29 @@
+#include "OverloadHandler.hpp"
+#include "ResponseWriter.hpp"
+#include <string>
+
+namespace {
+
+const std::string OVERLOAD_BODY =
+    "{\"status\":\"error\",\"message\":\"Server is overloaded, retry later\"}";
+const std::string RATE_LIMITED_BODY =
+    "{\"status\":\"error\",\"message\":\"Rate limit exceeded, retry later\"}";
+
+}
+
+OverloadHandler::OverloadHandler(Poco::Net::HTTPResponse::HTTPStatus status, int retryAfterSeconds)
+    : _status(status), _retryAfterSeconds(retryAfterSeconds) {
+}
+
+void OverloadHandler::handleRequest(Poco::Net::HTTPServerRequest& request, 
+                                  Poco::Net::HTTPServerResponse& response) {
+    const std::string& body =
+        _status == Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS ? RATE_LIMITED_BODY : OVERLOAD_BODY;
+
+    response.setStatusAndReason(_status);
+    response.set("Retry-After", std::to_string(_retryAfterSeconds));
+    // The body is left unread, so the connection cannot be reused.
+    response.setKeepAlive(false);
+    response.setContentType("application/json");
+    ResponseWriter(request, response).send(body);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+// Rejects a request with Retry-After without reading its body: 503 when
+// the server is overloaded, 429 when the client is over its rate limit.
+class OverloadHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    OverloadHandler(Poco::Net::HTTPResponse::HTTPStatus status, int retryAfterSeconds);
+
+    void handleRequest(Poco::Net::HTTPServerRequest& request, 
+                      Poco::Net::HTTPServerResponse& response) override;
+
+private:
+    Poco::Net::HTTPResponse::HTTPStatus _status;
+    int _retryAfterSeconds;
+};
@@ -1,43 +1,70 @@
 #include "PostHandler.hpp"
-#include "Poco/JSON/Parser.h"
-#include "Poco/JSON/Object.h"
+#include "ResponseWriter.hpp"
+#include "Poco/Exception.h"
 #include <iostream>
+#include <sstream>
+
+namespace {
+
+// Headers and body go out in one write, bypassing the response stream
+void sendBody(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+              BodyEncoding encoding, const std::string& body) {
+    response.setContentType(ContentNegotiation::mediaType(encoding));
+    ResponseWriter(request, response).send(body);
+}
+
+} // namespace
+
+PostHandler::PostHandler(JsonEngine engine, RecordSink* pSink)
+    : _processor(engine, pSink) {
+}
 
 void PostHandler::handleRequest(Poco::Net::HTTPServerRequest& request, 
                               Poco::Net::HTTPServerResponse& response) {
+    // Negotiate request and response encodings
+    BodyEncoding requestEncoding;
+    if (!ContentNegotiation::fromContentType(request.getContentType(), requestEncoding)) {
+        sendError(request, response, BodyEncoding::Json, Poco::Net::HTTPResponse::HTTP_UNSUPPORTED_MEDIA_TYPE,
+                  "Unsupported Content-Type: " + request.getContentType());
+        return;
+    }
+    BodyEncoding responseEncoding;
+    if (!ContentNegotiation::fromAccept(request.get("Accept", ""), requestEncoding, responseEncoding)) {
+        sendError(request, response, BodyEncoding::Json, Poco::Net::HTTPResponse::HTTP_NOT_ACCEPTABLE,
+                  "None of the accepted media types can be produced");
+        return;
+    }
+    response.set("Vary", "Accept");
+
     try {
-        // Set response type
-        response.setContentType("application/json");
-
-        // Parse request body
-        Poco::JSON::Parser parser;
-        auto result = parser.parse(request.stream());
-        auto jsonObj = result.extract<Poco::JSON::Object::Ptr>();
-
-        // Create response
-        Poco::JSON::Object responseObj;
-        responseObj.set("status", "success");
-        responseObj.set("message", "Data received successfully");
-        
-        // Echo back the received data
-        responseObj.set("received_data", jsonObj);
+        // Encode into a buffer so a malformed body can still become a 400
+        std::ostringstream body;
+        _processor.process(request.stream(), requestEncoding, body, responseEncoding);
 
         // Send response
-        std::ostream& out = response.send();
-        responseObj.stringify(out);
-        out.flush();
+        sendBody(request, response, responseEncoding, body.str());
 
+    } catch (const SinkSaturatedException& ex) {
+        // The sink is saturated; ask the client to back off. A receive
+        // timeout on a slow upload is a plain read failure, not this
+        response.set("Retry-After", "1");
+        sendError(request, response, responseEncoding, Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE, ex.displayText());
+    } catch (const SinkException& ex) {
+        // The record was valid but could not be stored; a failed read
+        // (reset, bad chunk framing) is the client's and stays a 400
+        sendError(request, response, responseEncoding, Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, ex.displayText());
     } catch (const std::exception& ex) {
         // Handle errors
-        response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
-        response.setContentType("application/json");
-        
-        Poco::JSON::Object errorObj;
-        errorObj.set("status", "error");
-        errorObj.set("message", ex.what());
-        
-        std::ostream& out = response.send();
-        errorObj.stringify(out);
-        out.flush();
+        sendError(request, response, responseEncoding, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, ex.what());
     }
 }
+
+void PostHandler::sendError(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+                            BodyEncoding encoding, Poco::Net::HTTPResponse::HTTPStatus status,
+                            const std::string& message) {
+    response.setStatusAndReason(status);
+
+    std::ostringstream body;
+    RecordProcessor::writeError(body, encoding, message);
+    sendBody(request, response, encoding, body.str());
+}
@@ -1,11 +1,22 @@
 #pragma once
 
+#include "handlers/RecordProcessor.hpp"
 #include "Poco/Net/HTTPRequestHandler.h"
 #include "Poco/Net/HTTPServerRequest.h"
 #include "Poco/Net/HTTPServerResponse.h"
 
+// Echoes the posted object back. The body may be JSON, CBOR or MessagePack
+// (by Content-Type) and the reply is encoded as negotiated via Accept.
 class PostHandler : public Poco::Net::HTTPRequestHandler {
 public:
+    explicit PostHandler(JsonEngine engine = JsonEngine::Standard, RecordSink* pSink = nullptr);
+
     void handleRequest(Poco::Net::HTTPServerRequest& request, 
                       Poco::Net::HTTPServerResponse& response) override;
+
+private:
+    void sendError(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+                   BodyEncoding encoding, Poco::Net::HTTPResponse::HTTPStatus status, const std::string& message);
+
+    RecordProcessor _processor;
 };
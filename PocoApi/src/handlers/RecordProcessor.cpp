@@ -0,0 +1,139 @@
+#include "RecordProcessor.hpp"
+#include "codec/Cbor.hpp"
+#include "codec/MessagePack.hpp"
+#include "json/SimdJsonParser.hpp"
+#include "Poco/JSON/Parser.h"
+#include "Poco/JSON/PrintHandler.h"
+#include "Poco/JSON/JSONException.h"
+#include <sstream>
+
+POCO_IMPLEMENT_EXCEPTION(SinkException, Poco::RuntimeException, "Record not stored")
+POCO_IMPLEMENT_EXCEPTION(SinkSaturatedException, SinkException, "Record sink saturated")
+
+namespace {
+
+// Forwards a decoded record to the reply writer. A record has to be an
+// object, as it did when it was extracted as a JSON::Object::Ptr.
+class ObjectBodyForwarder : public Poco::JSON::Handler {
+public:
+    explicit ObjectBodyForwarder(const Poco::JSON::Handler::Ptr& pWriter)
+        : _pWriter(pWriter), _started(false) {}
+
+    void reset() override {}
+    void startObject() override { _started = true; _pWriter->startObject(); }
+    void endObject() override { _pWriter->endObject(); }
+    void startArray() override { check(); _pWriter->startArray(); }
+    void endArray() override { _pWriter->endArray(); }
+    void key(const std::string& k) override { _pWriter->key(k); }
+    void null() override { check(); _pWriter->null(); }
+    void value(int v) override { check(); _pWriter->value(v); }
+    void value(unsigned v) override { check(); _pWriter->value(v); }
+#if defined(POCO_HAVE_INT64)
+    void value(Poco::Int64 v) override { check(); _pWriter->value(v); }
+    void value(Poco::UInt64 v) override { check(); _pWriter->value(v); }
+#endif
+    void value(const std::string& v) override { check(); _pWriter->value(v); }
+    void value(double d) override { check(); _pWriter->value(d); }
+    void value(bool b) override { check(); _pWriter->value(b); }
+
+private:
+    void check() {
+        if (!_started) {
+            throw Poco::JSON::JSONException("Request body must be an object");
+        }
+    }
+
+    Poco::JSON::Handler::Ptr _pWriter;
+    bool _started;
+};
+
+// Sends every event to two handlers; used to capture the record as
+// compact JSON for the sink while it is echoed into the reply.
+class TeeHandler : public Poco::JSON::Handler {
+public:
+    TeeHandler(const Poco::JSON::Handler::Ptr& pFirst, const Poco::JSON::Handler::Ptr& pSecond)
+        : _pFirst(pFirst), _pSecond(pSecond) {}
+
+    void reset() override { _pFirst->reset(); _pSecond->reset(); }
+    void startObject() override { _pFirst->startObject(); _pSecond->startObject(); }
+    void endObject() override { _pFirst->endObject(); _pSecond->endObject(); }
+    void startArray() override { _pFirst->startArray(); _pSecond->startArray(); }
+    void endArray() override { _pFirst->endArray(); _pSecond->endArray(); }
+    void key(const std::string& k) override { _pFirst->key(k); _pSecond->key(k); }
+    void null() override { _pFirst->null(); _pSecond->null(); }
+    void value(int v) override { _pFirst->value(v); _pSecond->value(v); }
+    void value(unsigned v) override { _pFirst->value(v); _pSecond->value(v); }
+#if defined(POCO_HAVE_INT64)
+    void value(Poco::Int64 v) override { _pFirst->value(v); _pSecond->value(v); }
+    void value(Poco::UInt64 v) override { _pFirst->value(v); _pSecond->value(v); }
+#endif
+    void value(const std::string& v) override { _pFirst->value(v); _pSecond->value(v); }
+    void value(double d) override { _pFirst->value(d); _pSecond->value(d); }
+    void value(bool b) override { _pFirst->value(b); _pSecond->value(b); }
+
+private:
+    Poco::JSON::Handler::Ptr _pFirst;
+    Poco::JSON::Handler::Ptr _pSecond;
+};
+
+} // namespace
+
+RecordProcessor::RecordProcessor(JsonEngine engine, RecordSink* pSink)
+    : _engine(engine), _pSink(pSink) {
+}
+
+void RecordProcessor::process(std::istream& in, BodyEncoding inEncoding, std::ostream& out, BodyEncoding outEncoding) {
+    Poco::JSON::Handler::Ptr writer = ContentNegotiation::createWriter(outEncoding, out);
+
+    writer->startObject();
+    writer->key("status");
+    writer->value(std::string("success"));
+    writer->key("message");
+    writer->value(std::string("Data received successfully"));
+
+    // Echo back the received data, transcoded straight into the reply
+    writer->key("received_data");
+    std::ostringstream record;
+    Poco::JSON::Handler::Ptr target = writer;
+    if (_pSink) {
+        target = new TeeHandler(writer, new Poco::JSON::PrintHandler(record));
+    }
+    Poco::JSON::Handler::Ptr reader = new ObjectBodyForwarder(target);
+    switch (inEncoding) {
+        case BodyEncoding::Cbor:
+            CborReader(reader).parse(in);
+            break;
+        case BodyEncoding::MessagePack:
+            MessagePackReader(reader).parse(in);
+            break;
+        default:
+            if (_engine == JsonEngine::Simd) {
+                SimdJsonParser(reader).parse(in);
+            } else {
+                Poco::JSON::Parser(reader).parse(in);
+            }
+            break;
+    }
+
+    // The record must be stored before it is acknowledged
+    if (_pSink) {
+        try {
+            _pSink->store(record.str());
+        } catch (const Poco::TimeoutException& ex) {
+            throw SinkSaturatedException(ex.message());
+        } catch (const Poco::IOException& ex) {
+            throw SinkException(ex.message());
+        }
+    }
+    writer->endObject();
+}
+
+void RecordProcessor::writeError(std::ostream& out, BodyEncoding encoding, const std::string& message) {
+    Poco::JSON::Handler::Ptr writer = ContentNegotiation::createWriter(encoding, out);
+    writer->startObject();
+    writer->key("status");
+    writer->value(std::string("error"));
+    writer->key("message");
+    writer->value(message);
+    writer->endObject();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "codec/ContentNegotiation.hpp"
+#include "storage/RecordSink.hpp"
+#include "Poco/Exception.h"
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Thrown by RecordProcessor::process when a decoded record could not be
+// stored; read and decode failures keep their own exception types.
+POCO_DECLARE_EXCEPTION(, SinkException, Poco::RuntimeException)
+
+// The sink is saturated (RecordSink's Poco::TimeoutException); the client
+// should retry later.
+POCO_DECLARE_EXCEPTION(, SinkSaturatedException, SinkException)
+
+// JSON parser used to read records; chosen per route.
+enum class JsonEngine {
+    Standard,   // Poco::JSON::Parser
+    Simd        // SimdJsonParser
+};
+
+// The processing path for one posted record, shared by the single-record
+// and batch handlers: decodes the record, hands it to the sink (if any)
+// and writes its reply envelope.
+class RecordProcessor {
+public:
+    explicit RecordProcessor(JsonEngine engine = JsonEngine::Standard, RecordSink* pSink = nullptr);
+
+    // Decodes one object from in, stores it and writes the success reply,
+    // echoing the object, to out. Throws if the record cannot be read or
+    // decoded, and SinkException (SinkSaturatedException if it is full)
+    // if the sink failed to store it; out may then hold a partial reply,
+    // so callers should encode into a buffer.
+    void process(std::istream& in, BodyEncoding inEncoding, std::ostream& out, BodyEncoding outEncoding);
+
+    // Writes an error reply carrying message to out.
+    static void writeError(std::ostream& out, BodyEncoding encoding, const std::string& message);
+
+private:
+    JsonEngine _engine;
+    RecordSink* _pSink;
+};
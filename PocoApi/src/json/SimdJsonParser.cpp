@@ -0,0 +1,490 @@
+#include "json/SimdJsonParser.hpp"
+#include "Poco/JSON/JSONException.h"
+#include "Poco/NumberParser.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/UTF8Encoding.h"
+#include "Poco/Exception.h"
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_JSON_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Deliberate limit on nesting: Poco::JSON::Parser's default depth is
+// unlimited, so deeper documents that it accepts are rejected here. It
+// bounds the recursion of stage 2 on untrusted bodies.
+const int MAX_DEPTH = 128;
+const std::size_t BLOCK_SIZE = 64;
+
+inline unsigned trailingZeros(std::uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return static_cast<unsigned>(i);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+}
+
+// Bit i of the result is the xor of bits 0..i of the input; turns a mask of
+// quote positions into a mask of "inside a string" positions.
+inline std::uint64_t prefixXor(std::uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+struct BlockMasks {
+    std::uint64_t quote;
+    std::uint64_t backslash;
+    std::uint64_t op;
+    std::uint64_t ws;
+};
+
+#if defined(SIMD_JSON_SSE2)
+inline std::uint64_t matchMask(const __m128i chunk[4], char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    std::uint64_t m0 = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[0], needle)));
+    std::uint64_t m1 = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[1], needle)));
+    std::uint64_t m2 = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[2], needle)));
+    std::uint64_t m3 = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[3], needle)));
+    return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+}
+
+inline void classify(const char* p, BlockMasks& m) {
+    __m128i chunk[4];
+    for (int i = 0; i < 4; ++i) {
+        chunk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+    }
+    m.quote = matchMask(chunk, '"');
+    m.backslash = matchMask(chunk, '\\');
+    m.op = matchMask(chunk, '{') | matchMask(chunk, '}') | matchMask(chunk, '[')
+         | matchMask(chunk, ']') | matchMask(chunk, ':') | matchMask(chunk, ',');
+    m.ws = matchMask(chunk, ' ') | matchMask(chunk, '\t') | matchMask(chunk, '\n') | matchMask(chunk, '\r');
+}
+#else
+inline void classify(const char* p, BlockMasks& m) {
+    m = BlockMasks{0, 0, 0, 0};
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+        const std::uint64_t bit = std::uint64_t(1) << i;
+        switch (p[i]) {
+            case '"':  m.quote |= bit;     break;
+            case '\\': m.backslash |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                m.op |= bit; break;
+            case ' ': case '\t': case '\n': case '\r':
+                m.ws |= bit; break;
+            default: break;
+        }
+    }
+}
+#endif
+
+// Returns the characters escaped by an odd-length run of backslashes.
+// prevEscaped carries a run that crosses the block boundary.
+inline std::uint64_t findEscaped(std::uint64_t backslash, std::uint64_t& prevEscaped) {
+    const std::uint64_t evenBits = 0x5555555555555555ULL;
+    backslash &= ~prevEscaped;
+    const std::uint64_t followsEscape = (backslash << 1) | prevEscaped;
+    const std::uint64_t oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+    const std::uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+    prevEscaped = sequencesStartingOnEvenBits < oddSequenceStarts ? 1 : 0;
+    const std::uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+    return (evenBits ^ invertMask) & followsEscape;
+}
+
+inline bool isDelimiter(char c) {
+    switch (c) {
+        case '{': case '}': case '[': case ']': case ':': case ',':
+        case ' ': case '\t': case '\n': case '\r':
+            return true;
+        default:
+            return false;
+    }
+}
+
+[[noreturn]] void syntaxError(const std::string& what, std::size_t offset) {
+    throw Poco::JSON::JSONException("JSON syntax error: " + what + " at offset " + std::to_string(offset));
+}
+
+int hex4(const std::string& json, std::size_t pos) {
+    if (pos + 4 > json.size()) {
+        syntaxError("invalid unicode escape", pos);
+    }
+    int cp = 0;
+    for (std::size_t i = pos; i < pos + 4; ++i) {
+        const char c = json[i];
+        cp <<= 4;
+        if (c >= '0' && c <= '9') cp |= c - '0';
+        else if (c >= 'a' && c <= 'f') cp |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') cp |= c - 'A' + 10;
+        else syntaxError("invalid unicode escape", pos);
+    }
+    return cp;
+}
+
+// Decodes the string whose opening quote is at off, resolving escapes.
+std::string decodeString(const std::string& json, std::uint32_t off) {
+    std::string result;
+    std::size_t i = off + 1;
+    std::size_t runStart = i;
+    for (;;) {
+        if (i >= json.size()) {
+            syntaxError("unterminated string", off);
+        }
+        const unsigned char c = static_cast<unsigned char>(json[i]);
+        if (c == '"') {
+            result.append(json, runStart, i - runStart);
+            return result;
+        }
+        if (c < 0x20) {
+            syntaxError("control character in string", i);
+        }
+        if (c != '\\') {
+            ++i;
+            continue;
+        }
+        result.append(json, runStart, i - runStart);
+        if (++i >= json.size()) {
+            syntaxError("unterminated string", off);
+        }
+        switch (json[i]) {
+            case '"':  result += '"';  break;
+            case '\\': result += '\\'; break;
+            case '/':  result += '/';  break;
+            case 'b':  result += '\b'; break;
+            case 'f':  result += '\f'; break;
+            case 'n':  result += '\n'; break;
+            case 'r':  result += '\r'; break;
+            case 't':  result += '\t'; break;
+            case 'u': {
+                int cp = hex4(json, i + 1);
+                i += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    if (i + 6 >= json.size() || json[i + 1] != '\\' || json[i + 2] != 'u') {
+                        syntaxError("invalid surrogate pair", i);
+                    }
+                    const int low = hex4(json, i + 3);
+                    if (low < 0xDC00 || low > 0xDFFF) {
+                        syntaxError("invalid surrogate pair", i);
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    syntaxError("invalid surrogate pair", i);
+                }
+                unsigned char utf8[4];
+                const int n = Poco::UTF8Encoding().convert(cp, utf8, sizeof(utf8));
+                result.append(reinterpret_cast<const char*>(utf8), static_cast<std::size_t>(n));
+                break;
+            }
+            default:
+                syntaxError("invalid escape sequence", i);
+        }
+        runStart = ++i;
+    }
+}
+
+// Stage 2: walks the structural index and reports values to a handler.
+class Walker {
+public:
+    Walker(const std::string& json, const std::vector<std::uint32_t>& index, Poco::JSON::Handler& handler)
+        : _json(json), _index(index), _handler(handler), _pos(0), _depth(0) {}
+
+    void document() {
+        value();
+        if (_pos != _index.size()) {
+            syntaxError("unexpected content after document", _index[_pos]);
+        }
+    }
+
+    void valueAt(std::size_t pos) {
+        _pos = pos;
+        value();
+    }
+
+private:
+    std::uint32_t next() {
+        if (_pos >= _index.size()) {
+            syntaxError("unexpected end of input", _json.size());
+        }
+        return _index[_pos++];
+    }
+
+    char peek() const {
+        return _pos < _index.size() ? _json[_index[_pos]] : '\0';
+    }
+
+    void value() {
+        const std::uint32_t off = next();
+        switch (_json[off]) {
+            case '{': object(); break;
+            case '[': array(); break;
+            case '"': _handler.value(decodeString(_json, off)); break;
+            case 't': literal(off, "true");  _handler.value(true);  break;
+            case 'f': literal(off, "false"); _handler.value(false); break;
+            case 'n': literal(off, "null");  _handler.null();       break;
+            default:  number(off); break;
+        }
+    }
+
+    void object() {
+        if (++_depth > MAX_DEPTH) {
+            throw Poco::JSON::JSONException("Maximum depth exceeded");
+        }
+        _handler.startObject();
+        if (peek() == '}') {
+            ++_pos;
+        } else {
+            for (;;) {
+                std::uint32_t off = next();
+                if (_json[off] != '"') {
+                    syntaxError("expected member name", off);
+                }
+                _handler.key(decodeString(_json, off));
+                off = next();
+                if (_json[off] != ':') {
+                    syntaxError("expected ':'", off);
+                }
+                value();
+                off = next();
+                if (_json[off] == '}') break;
+                if (_json[off] != ',') {
+                    syntaxError("expected ',' or '}'", off);
+                }
+            }
+        }
+        _handler.endObject();
+        --_depth;
+    }
+
+    void array() {
+        if (++_depth > MAX_DEPTH) {
+            throw Poco::JSON::JSONException("Maximum depth exceeded");
+        }
+        _handler.startArray();
+        if (peek() == ']') {
+            ++_pos;
+        } else {
+            for (;;) {
+                value();
+                const std::uint32_t off = next();
+                if (_json[off] == ']') break;
+                if (_json[off] != ',') {
+                    syntaxError("expected ',' or ']'", off);
+                }
+            }
+        }
+        _handler.endArray();
+        --_depth;
+    }
+
+    void literal(std::uint32_t off, const char* text) {
+        const std::size_t len = std::strlen(text);
+        if (_json.compare(off, len, text) != 0
+            || (off + len < _json.size() && !isDelimiter(_json[off + len]))) {
+            syntaxError("invalid literal", off);
+        }
+    }
+
+    // Mirrors Poco::JSON::Parser: integers become Int64 (or UInt64 when
+    // they do not fit), anything with a fraction or exponent a double.
+    void number(std::uint32_t off) {
+        std::size_t end = off;
+        while (end < _json.size() && !isDelimiter(_json[end])) ++end;
+
+        std::size_t i = off;
+        if (i < end && _json[i] == '-') ++i;
+        if (i == end || !isDigit(_json[i])) {
+            syntaxError("invalid value", off);
+        }
+        if (_json[i] == '0') {
+            ++i;
+        } else {
+            while (i < end && isDigit(_json[i])) ++i;
+        }
+        bool isFloat = false;
+        if (i < end && _json[i] == '.') {
+            isFloat = true;
+            ++i;
+            if (i == end || !isDigit(_json[i])) syntaxError("invalid number", off);
+            while (i < end && isDigit(_json[i])) ++i;
+        }
+        if (i < end && (_json[i] == 'e' || _json[i] == 'E')) {
+            isFloat = true;
+            ++i;
+            if (i < end && (_json[i] == '+' || _json[i] == '-')) ++i;
+            if (i == end || !isDigit(_json[i])) syntaxError("invalid number", off);
+            while (i < end && isDigit(_json[i])) ++i;
+        }
+        if (i != end) {
+            syntaxError("invalid number", off);
+        }
+
+        const std::string str(_json, off, end - off);
+        if (isFloat) {
+            _handler.value(Poco::NumberParser::parseFloat(str));
+        } else {
+            Poco::Int64 val;
+            if (Poco::NumberParser::tryParse64(str, val)) {
+                _handler.value(val);
+            } else {
+                _handler.value(Poco::NumberParser::parseUnsigned64(str));
+            }
+        }
+    }
+
+    static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    const std::string& _json;
+    const std::vector<std::uint32_t>& _index;
+    Poco::JSON::Handler& _handler;
+    std::size_t _pos;
+    int _depth;
+};
+
+} // namespace
+
+// --- SimdJsonParser implementation ---
+SimdJsonParser::SimdJsonParser(const Poco::JSON::Handler::Ptr& pHandler)
+    : _pHandler(pHandler) {
+}
+
+Poco::Dynamic::Var SimdJsonParser::parse(const std::string& json) {
+    buildIndex(json, _index);
+    Walker(json, _index, *_pHandler).document();
+    return _pHandler->asVar();
+}
+
+Poco::Dynamic::Var SimdJsonParser::parse(std::istream& in) {
+    std::string json;
+    Poco::StreamCopier::copyToString(in, json);
+    return parse(json);
+}
+
+void SimdJsonParser::reset() {
+    _index.clear();
+    _pHandler->reset();
+}
+
+SimdJsonParser::Document SimdJsonParser::index(std::string json) {
+    Document doc;
+    doc._json = std::move(json);
+    buildIndex(doc._json, doc._index);
+    return doc;
+}
+
+void SimdJsonParser::buildIndex(const std::string& json, std::vector<std::uint32_t>& index) {
+    if (json.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        throw Poco::JSON::JSONException("JSON document too large");
+    }
+    index.clear();
+    // Structurals are rarely denser than one in eight bytes.
+    index.reserve(json.size() / 8 + 16);
+
+    std::uint64_t prevEscaped = 0;
+    std::uint64_t prevInString = 0;
+    std::uint64_t prevScalar = 0;
+    char tail[BLOCK_SIZE];
+
+    for (std::size_t base = 0; base < json.size(); base += BLOCK_SIZE) {
+        const char* block = json.data() + base;
+        if (json.size() - base < BLOCK_SIZE) {
+            // Pad the last block with whitespace so it classifies as nothing.
+            std::memset(tail, ' ', BLOCK_SIZE);
+            std::memcpy(tail, block, json.size() - base);
+            block = tail;
+        }
+
+        BlockMasks m;
+        classify(block, m);
+
+        const std::uint64_t escaped = findEscaped(m.backslash, prevEscaped);
+        const std::uint64_t quote = m.quote & ~escaped;
+        const std::uint64_t inString = prefixXor(quote) ^ prevInString;
+        prevInString = static_cast<std::uint64_t>(static_cast<std::int64_t>(inString) >> 63);
+
+        // Scalars (numbers and literals) start where a run of
+        // non-delimiter, non-quote characters begins.
+        const std::uint64_t nonQuoteScalar = ~(m.op | m.ws) & ~quote;
+        const std::uint64_t followsScalar = (nonQuoteScalar << 1) | prevScalar;
+        prevScalar = nonQuoteScalar >> 63;
+        const std::uint64_t scalarStart = nonQuoteScalar & ~followsScalar;
+
+        std::uint64_t structural = ((m.op | scalarStart) & ~inString) | (quote & inString);
+        while (structural) {
+            index.push_back(static_cast<std::uint32_t>(base + trailingZeros(structural)));
+            structural &= structural - 1;
+        }
+    }
+
+    if (prevInString) {
+        syntaxError("unterminated string", json.size());
+    }
+    if (index.empty()) {
+        syntaxError("unexpected end of input", json.size());
+    }
+}
+
+// --- SimdJsonParser::Document implementation ---
+std::size_t SimdJsonParser::Document::findMember(const std::string& key) const {
+    if (_index.empty() || _json[_index[0]] != '{') {
+        throw Poco::JSON::JSONException("Document is not a JSON object");
+    }
+
+    std::size_t pos = 1;
+    while (pos + 2 < _index.size() && _json[_index[pos]] == '"') {
+        const std::size_t valuePos = pos + 2;
+        if (decodeString(_json, _index[pos]) == key) {
+            return valuePos;
+        }
+
+        // Skip the value without materializing it.
+        pos = valuePos;
+        int depth = 0;
+        do {
+            const char c = _json[_index[pos]];
+            if (c == '{' || c == '[') ++depth;
+            else if (c == '}' || c == ']') --depth;
+            ++pos;
+        } while (depth > 0 && pos < _index.size());
+
+        if (pos >= _index.size() || _json[_index[pos]] != ',') {
+            break;
+        }
+        ++pos;
+    }
+    return std::string::npos;
+}
+
+bool SimdJsonParser::Document::has(const std::string& key) const {
+    return findMember(key) != std::string::npos;
+}
+
+Poco::Dynamic::Var SimdJsonParser::Document::get(const std::string& key) const {
+    const std::size_t pos = findMember(key);
+    if (pos == std::string::npos) {
+        throw Poco::NotFoundException("JSON member", key);
+    }
+    Poco::JSON::ParseHandler handler;
+    Walker(_json, _index, handler).valueAt(pos);
+    return handler.asVar();
+}
+
+Poco::Dynamic::Var SimdJsonParser::Document::value() const {
+    Poco::JSON::ParseHandler handler;
+    Walker(_json, _index, handler).document();
+    return handler.asVar();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Poco/JSON/Handler.h"
+#include "Poco/JSON/ParseHandler.h"
+#include "Poco/Dynamic/Var.h"
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Vectorized JSON parser for large request bodies.
+//
+// Parsing runs in two stages. Stage 1 scans the input 64 bytes at a time
+// with SIMD compares to find quotes, backslashes and structural characters,
+// and records the offset of every structural character that is not inside a
+// string. Stage 2 walks that index and reports the document to a
+// Poco::JSON::Handler, so the result (and the exceptions thrown) match what
+// Poco::JSON::Parser produces for the same input.
+class SimdJsonParser {
+public:
+    // Structural index of one document; fields can be read on demand
+    // without materializing the rest of the tree.
+    class Document {
+    public:
+        Document() = default;
+
+        // Returns true if the top-level object has a member called key.
+        bool has(const std::string& key) const;
+
+        // Materializes only the value of the given top-level member.
+        // Throws Poco::NotFoundException if the member does not exist.
+        Poco::Dynamic::Var get(const std::string& key) const;
+
+        // Materializes the whole document.
+        Poco::Dynamic::Var value() const;
+
+        std::size_t size() const { return _json.size(); }
+
+    private:
+        friend class SimdJsonParser;
+
+        std::size_t findMember(const std::string& key) const;
+
+        std::string _json;
+        std::vector<std::uint32_t> _index;
+    };
+
+    explicit SimdJsonParser(const Poco::JSON::Handler::Ptr& pHandler = new Poco::JSON::ParseHandler);
+
+    // Parses the document and returns the handler's result. Like
+    // Poco::JSON::Parser, the handler is not reset; call reset() before
+    // reusing a parser after a failed parse.
+    Poco::Dynamic::Var parse(const std::string& json);
+    Poco::Dynamic::Var parse(std::istream& in);
+
+    void reset();
+
+    // Runs stage 1 only and keeps the index for on-demand access.
+    static Document index(std::string json);
+
+    void setHandler(const Poco::JSON::Handler::Ptr& pHandler) { _pHandler = pHandler; }
+    const Poco::JSON::Handler::Ptr& getHandler() const { return _pHandler; }
+
+private:
+    static void buildIndex(const std::string& json, std::vector<std::uint32_t>& index);
+
+    Poco::JSON::Handler::Ptr _pHandler;
+    std::vector<std::uint32_t> _index;
+};
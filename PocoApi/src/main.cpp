@@ -4,23 +4,103 @@
 #include "Poco/Net/HTTPServerParams.h"
 #include "Poco/Net/ServerSocket.h"
 #include "Poco/Util/ServerApplication.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/Exception.h"
+#include "handlers/BatchHandler.hpp"
+#include "handlers/OverloadHandler.hpp"
 #include "handlers/PostHandler.hpp"
-#include <iostream>
+#include "storage/SegmentLog.hpp"
+#ifdef POCOAPI_DATABASE_SINK
+#include "storage/WriteBehindQueue.hpp"
+#endif
+#include "AccessLog.hpp"
+#include "AdmissionControl.hpp"
+#include "Logger.hpp"
+#include "MetricsHandler.hpp"
+#include "RateLimiter.hpp"
+#include "TrafficCapture.hpp"
+#include <memory>
+#include <string>
+#include <vector>
 
+// POST routes and the JSON parser each one uses
+struct PostRoute {
+    const char* uri;
+    JsonEngine engine;
+};
+
+const PostRoute POST_ROUTES[] = {
+    { "/api/data",      JsonEngine::Standard },
+    { "/api/data/simd", JsonEngine::Simd }
+};
+
+// With an access log, every request to a known route but /metrics gets a
+// record there; with a traffic capture, it is also captured for replay.
 class RequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
 public:
+    RequestHandlerFactory(AdmissionController& admission, RateLimiter& rateLimiter, RecordSink& sink,
+                          AccessLog* pAccessLog = nullptr, TrafficCapture* pCapture = nullptr)
+        : _admission(admission), _rateLimiter(rateLimiter), _sink(sink), _pAccessLog(pAccessLog), _pCapture(pCapture) {
+    }
+
     Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& request) override {
-        if (request.getMethod() == "POST" && request.getURI() == "/api/data") {
-            return new PostHandler;
+        // Taken first, so no early answer leaves the stamp for a later request
+        const std::chrono::microseconds queued = _admission.takeQueueDelay(request.clientAddress());
+        if (request.getMethod() == "GET" && request.getURI() == "/metrics") {
+            return new MetricsHandler;
+        }
+        Poco::Net::HTTPRequestHandler* pHandler = createHandler(request, queued);
+        if (pHandler && _pCapture) {
+            pHandler = new TrafficCaptureHandler(pHandler, *_pCapture);
+        }
+        if (pHandler && _pAccessLog) {
+            const std::string& uri = request.getURI();
+            const std::string path = uri.substr(0, uri.find('?'));
+            return new AccessLogHandler(pHandler, *_pAccessLog, SERVICE_REST, path, queued);
+        }
+        return pHandler;
+    }
+
+private:
+    Poco::Net::HTTPRequestHandler* createHandler(const Poco::Net::HTTPServerRequest& request,
+                                                 std::chrono::microseconds queued) {
+        int retryAfter = 0;
+        if (!_rateLimiter.tryAcquire(_rateLimiter.clientKey(request), retryAfter)) {
+            return new OverloadHandler(Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS, retryAfter);
+        }
+        if (!_admission.admit(queued)) {
+            return new OverloadHandler(Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE, _admission.retryAfterSeconds());
+        }
+        if (request.getMethod() == "POST") {
+            for (const auto& route : POST_ROUTES) {
+                if (request.getURI() == route.uri) {
+                    return new PostHandler(route.engine, &_sink);
+                }
+            }
+            if (request.getURI() == "/api/data/batch") {
+                return new BatchHandler(JsonEngine::Standard, &_sink);
+            }
         }
         return nullptr;
     }
+
+    AdmissionController& _admission;
+    RateLimiter& _rateLimiter;
+    RecordSink& _sink;
+    AccessLog* _pAccessLog;
+    TrafficCapture* _pCapture;
 };
 
 class WebServerApp : public Poco::Util::ServerApplication {
 protected:
     int main(const std::vector<std::string>&) override {
         try {
+            // Records below log.level are dropped where they are logged
+            LogLevel logLevel = LogLevel::Info;
+            if (Logger::parseLevel(config().getString("log.level", "info"), logLevel)) {
+                Logger::instance().setLevel(logLevel);
+            }
+
             // Create server socket
             Poco::Net::ServerSocket socket(8080);
             
@@ -29,15 +109,82 @@ protected:
             params->setMaxQueued(100);
             params->setMaxThreads(16);
             
+            // Shed requests that waited too long in the connection queue. Stamps
+            // of connections that never sent a request go after ten server
+            // timeouts, far beyond any wait still worth measuring.
+            AdmissionController admission(
+                std::chrono::milliseconds(config().getInt("admission.targetQueueDelayMs", 100)),
+                config().getInt("admission.retryAfterSeconds", 1),
+                std::chrono::seconds(10 * params->getTimeout().totalSeconds())
+            );
+            
+            // Per-client token buckets, checked before any body is read
+            RateLimiter rateLimiter(
+                config().getDouble("ratelimit.requestsPerSecond", 50.0),
+                config().getDouble("ratelimit.burst", 100.0)
+            );
+            
+            // Clients sending one of these X-API-Keys get a bucket per key;
+            // everyone else gets one per address
+            Poco::StringTokenizer apiKeys(config().getString("ratelimit.apiKeys", ""), ",",
+                Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+            rateLimiter.setApiKeys(std::vector<std::string>(apiKeys.begin(), apiKeys.end()));
+            
+            // Where accepted records go: the local segment log, synced before
+            // each acknowledgement, or the database through a write-behind queue
+            std::unique_ptr<RecordSink> sink;
+            if (config().getString("storage.sink", "segmentlog") == "database") {
+#ifdef POCOAPI_DATABASE_SINK
+                sink.reset(new WriteBehindQueue(
+                    config().getString("database.connectionString"),
+                    static_cast<std::size_t>(config().getInt("writebehind.capacity", 10000)),
+                    static_cast<std::size_t>(config().getInt("writebehind.maxBatch", 500)),
+                    std::chrono::milliseconds(config().getInt("writebehind.maxDelayMs", 50)),
+                    std::chrono::milliseconds(config().getInt("writebehind.enqueueTimeoutMs", 100)),
+                    config().getString("writebehind.deadLetterPath", "writebehind_dead_letter.ndjson")
+                ));
+#else
+                throw Poco::InvalidArgumentException("storage.sink=database needs a build with POCOAPI_DATABASE_SINK");
+#endif
+            } else {
+                sink.reset(new SegmentLog(
+                    config().getString("recordlog.directory", "recordlog"),
+                    static_cast<std::size_t>(config().getInt64("recordlog.segmentBytes", 64 * 1024 * 1024)),
+                    SegmentLog::GROUP_COMMIT,
+                    static_cast<std::size_t>(config().getInt("recordlog.maxSegments", 0))
+                ));
+            }
+            
+            // One binary record per request, for the accesslog tool
+            std::unique_ptr<AccessLog> accessLog;
+            if (config().getBool("accesslog.enabled", true)) {
+                accessLog.reset(new AccessLog(
+                    config().getString("accesslog.directory", "accesslog"),
+                    static_cast<std::size_t>(config().getInt("accesslog.segmentRecords", 1024 * 1024)),
+                    static_cast<std::size_t>(config().getInt("accesslog.maxSegments", 16))
+                ));
+            }
+            
+            // Whole requests for the replay tool; replaces an earlier capture
+            std::unique_ptr<TrafficCapture> capture;
+            if (config().getBool("capture.enabled", false)) {
+                capture.reset(new TrafficCapture(
+                    config().getString("capture.path", "capture.bin"),
+                    static_cast<std::size_t>(config().getInt64("capture.maxBytes", 1024 * 1024 * 1024)),
+                    static_cast<std::size_t>(config().getInt("capture.maxBodyBytes", 1024 * 1024))
+                ));
+            }
+            
             // Create and start server
             Poco::Net::HTTPServer server(
-                new RequestHandlerFactory, 
+                new RequestHandlerFactory(admission, rateLimiter, *sink, accessLog.get(), capture.get()), 
                 socket, 
                 params
             );
+            server.setConnectionFilter(new QueueTimingFilter(admission));
             
             server.start();
-            std::cout << "Server started on port 8080" << std::endl;
+            logInfo("Server started on port {}", 8080);
             
             // Wait for CTRL-C or kill
             waitForTerminationRequest();
@@ -47,7 +194,7 @@ protected:
             return Application::EXIT_OK;
             
         } catch (const std::exception& ex) {
-            std::cerr << "Error: " << ex.what() << std::endl;
+            logError("Error: {}", ex.what());
             return Application::EXIT_SOFTWARE;
         }
     }
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+// Destination for records accepted by RecordProcessor.
+class RecordSink {
+public:
+    virtual ~RecordSink() = default;
+
+    // Stores one record, given as compact JSON. Called before the record
+    // is acknowledged to the client; throwing Poco::IOException fails it,
+    // Poco::TimeoutException means the sink is saturated and the client
+    // should retry later.
+    virtual void store(const std::string& json) = 0;
+};
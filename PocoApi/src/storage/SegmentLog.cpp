@@ -0,0 +1,366 @@
+#include "storage/SegmentLog.hpp"
+#include "Logger.hpp"
+#include "Poco/Checksum.h"
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Path.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const std::size_t FRAME_HEADER_SIZE = 8;
+const std::size_t MAX_RECORD_SIZE = 0x7FFFFFFF;
+const char* SEGMENT_PREFIX = "segment-";
+const char* SEGMENT_SUFFIX = ".log";
+
+// --- Thin file layer; the log needs append, data sync and nothing else ---
+#if defined(_WIN32)
+int openAppend(const std::string& path) {
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        const int chunk = size > 0x40000000 ? 0x40000000 : static_cast<int>(size);
+        const int n = _write(fd, data, static_cast<unsigned>(chunk));
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool syncData(int fd) {
+    return _commit(fd) == 0;
+}
+
+void syncDirectory(const std::string&) {
+    // NTFS makes new directory entries durable with the file itself.
+}
+
+void closeFile(int fd) {
+    _close(fd);
+}
+#else
+int openAppend(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool syncData(int fd) {
+#if defined(__APPLE__)
+    return ::fsync(fd) == 0;
+#else
+    return ::fdatasync(fd) == 0;
+#endif
+}
+
+// A new segment's directory entry must be durable too, or the whole file
+// can vanish after a crash even though its data was synced.
+void syncDirectory(const std::string& directory) {
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+void closeFile(int fd) {
+    ::close(fd);
+}
+#endif
+
+Poco::UInt32 crc32(const char* data, std::size_t size) {
+    Poco::Checksum crc(Poco::Checksum::TYPE_CRC32);
+    crc.update(data, static_cast<unsigned>(size));
+    return crc.checksum();
+}
+
+void putLE32(std::string& out, Poco::UInt32 v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+}
+
+Poco::UInt32 getLE32(const char* p) {
+    Poco::UInt32 v = 0;
+    for (int i = 3; i >= 0; --i) {
+        v = (v << 8) | static_cast<unsigned char>(p[i]);
+    }
+    return v;
+}
+
+void appendFrame(std::string& out, const std::string& record) {
+    putLE32(out, static_cast<Poco::UInt32>(record.size()));
+    putLE32(out, crc32(record.data(), record.size()));
+    out.append(record);
+}
+
+// Reads intact frames from a segment, calling fn for each. Returns the
+// number of bytes they cover; anything after that is torn or corrupt.
+std::size_t scanSegment(const std::string& path, const std::function<void(const std::string&)>& fn) {
+    std::ifstream in(path, std::ios::binary);
+    std::size_t valid = 0;
+    char header[FRAME_HEADER_SIZE];
+    std::string record;
+    while (in.read(header, FRAME_HEADER_SIZE)) {
+        const Poco::UInt32 length = getLE32(header);
+        const Poco::UInt32 checksum = getLE32(header + 4);
+        if (length > MAX_RECORD_SIZE) break;
+        record.resize(length);
+        if (length > 0 && !in.read(&record[0], length)) break;
+        if (crc32(record.data(), record.size()) != checksum) break;
+        fn(record);
+        valid += FRAME_HEADER_SIZE + length;
+    }
+    return valid;
+}
+
+} // namespace
+
+// --- SegmentLog implementation ---
+SegmentLog::SegmentLog(const std::string& directory, std::size_t maxSegmentBytes, SyncMode mode,
+                       std::size_t maxSegments)
+    : _directory(directory),
+      _maxSegmentBytes(maxSegmentBytes),
+      _mode(mode),
+      _maxSegments(maxSegments),
+      _fd(-1),
+      _segmentBytes(0),
+      _nextSequence(1),
+      _durableSequence(1),
+      _stopping(false) {
+    Poco::File(_directory).createDirectories();
+    recover();
+    _writer = std::thread(&SegmentLog::writerLoop, this);
+}
+
+SegmentLog::~SegmentLog() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _queued.notify_one();
+    _writer.join();
+    closeSegment();
+}
+
+Poco::UInt64 SegmentLog::append(const std::string& record) {
+    if (record.size() > MAX_RECORD_SIZE) {
+        throw Poco::WriteFileException("Record too large for the log");
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_error.empty()) {
+        throw Poco::WriteFileException(_error);
+    }
+    const Poco::UInt64 sequence = _nextSequence++;
+    _pending.push_back(Pending{ sequence, record });
+    _queued.notify_one();
+
+    _durable.wait(lock, [&] { return _durableSequence > sequence || !_error.empty(); });
+    if (_durableSequence <= sequence) {
+        throw Poco::WriteFileException(_error);
+    }
+    return sequence;
+}
+
+void SegmentLog::store(const std::string& json) {
+    append(json);
+}
+
+void SegmentLog::replay(const std::function<void(Poco::UInt64, const std::string&)>& fn) const {
+    for (Poco::UInt64 first : listSegments()) {
+        Poco::UInt64 sequence = first;
+        scanSegment(segmentPath(first), [&](const std::string& record) { fn(sequence++, record); });
+    }
+}
+
+Poco::UInt64 SegmentLog::nextSequence() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _nextSequence;
+}
+
+std::size_t SegmentLog::truncateBefore(Poco::UInt64 sequence) {
+    return removeSegments(1, sequence);
+}
+
+void SegmentLog::recover() {
+    const std::vector<Poco::UInt64> segments = listSegments();
+    if (segments.empty()) {
+        openSegment(_nextSequence);
+        return;
+    }
+
+    // Only the last segment can have been mid-write when we stopped.
+    const Poco::UInt64 first = segments.back();
+    const std::string path = segmentPath(first);
+    Poco::UInt64 count = 0;
+    const std::size_t valid = scanSegment(path, [&](const std::string&) { ++count; });
+
+    Poco::File file(path);
+    if (file.getSize() > valid) {
+        file.setSize(valid);
+    }
+    _nextSequence = _durableSequence = first + count;
+    openSegment(first);
+}
+
+void SegmentLog::openSegment(Poco::UInt64 firstSequence) {
+    const std::string path = segmentPath(firstSequence);
+    const bool created = !Poco::File(path).exists();
+    _fd = openAppend(path);
+    if (_fd < 0) {
+        throw Poco::OpenFileException(path);
+    }
+    if (created) {
+        syncDirectory(_directory);
+    }
+    _segmentBytes = static_cast<std::size_t>(Poco::File(path).getSize());
+}
+
+void SegmentLog::closeSegment() {
+    if (_fd >= 0) {
+        closeFile(_fd);
+        _fd = -1;
+    }
+}
+
+void SegmentLog::writerLoop() {
+    for (;;) {
+        std::deque<Pending> batch;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _queued.wait(lock, [&] { return _stopping || !_pending.empty(); });
+            if (_pending.empty()) {
+                return;
+            }
+            if (_mode == SYNC_EACH_RECORD) {
+                batch.push_back(std::move(_pending.front()));
+                _pending.pop_front();
+            } else {
+                batch.swap(_pending);
+            }
+            if (!_error.empty()) {
+                // The segment's state is unknown after a failed write.
+                continue;
+            }
+        }
+
+        std::string error;
+        try {
+            writeBatch(batch);
+        } catch (const Poco::Exception& ex) {
+            error = ex.displayText();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (error.empty()) {
+                _durableSequence = batch.back().sequence + 1;
+            } else {
+                _error = error;
+            }
+        }
+        _durable.notify_all();
+    }
+}
+
+void SegmentLog::writeBatch(std::deque<Pending>& batch) {
+    std::string buffer;
+    std::size_t size = 0;
+    for (const auto& p : batch) {
+        size += FRAME_HEADER_SIZE + p.record.size();
+    }
+    buffer.reserve(size);
+    for (const auto& p : batch) {
+        appendFrame(buffer, p.record);
+    }
+
+    if (_segmentBytes > 0 && _segmentBytes + buffer.size() > _maxSegmentBytes) {
+        closeSegment();
+        openSegment(batch.front().sequence);
+        if (_maxSegments > 0) {
+            removeSegments(_maxSegments, batch.front().sequence);
+        }
+    }
+
+    if (!writeAll(_fd, buffer.data(), buffer.size()) || !syncData(_fd)) {
+        throw Poco::WriteFileException(segmentPath(batch.front().sequence));
+    }
+    _segmentBytes += buffer.size();
+}
+
+std::string SegmentLog::segmentPath(Poco::UInt64 firstSequence) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%020llu%s", SEGMENT_PREFIX,
+                  static_cast<unsigned long long>(firstSequence), SEGMENT_SUFFIX);
+    return Poco::Path(_directory, name).toString();
+}
+
+// Removes the oldest segments, keeping at least keep of them and any that
+// holds a record at or after before. A segment ends where the next begins.
+std::size_t SegmentLog::removeSegments(std::size_t keep, Poco::UInt64 before) {
+    std::lock_guard<std::mutex> lock(_removeMutex);
+    const std::vector<Poco::UInt64> segments = listSegments();
+    std::size_t removed = 0;
+    for (std::size_t i = 0; i + std::max<std::size_t>(keep, 1) < segments.size() && segments[i + 1] <= before; ++i) {
+        try {
+            Poco::File(segmentPath(segments[i])).remove();
+            ++removed;
+        } catch (const Poco::Exception& ex) {
+            logWarning("Cannot remove old record log segment: {}", ex.displayText());
+            break;
+        }
+    }
+    if (removed > 0) {
+        syncDirectory(_directory);
+    }
+    return removed;
+}
+
+std::vector<Poco::UInt64> SegmentLog::listSegments() const {
+    std::vector<std::string> names;
+    Poco::File(_directory).list(names);
+
+    const std::string prefix(SEGMENT_PREFIX);
+    const std::string suffix(SEGMENT_SUFFIX);
+    std::vector<Poco::UInt64> segments;
+    for (const auto& name : names) {
+        Poco::UInt64 first;
+        if (name.size() > prefix.size() + suffix.size()
+            && name.compare(0, prefix.size(), prefix) == 0
+            && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0
+            && Poco::NumberParser::tryParseUnsigned64(
+                   name.substr(prefix.size(), name.size() - prefix.size() - suffix.size()), first)) {
+            segments.push_back(first);
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "storage/RecordSink.hpp"
+#include "Poco/Types.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Durable append-only record log split into segment files.
+//
+// Appending threads queue their record and block until it is on disk. A
+// single writer thread takes everything queued so far, writes it with one
+// write() and one fdatasync(), and then releases all of those appenders
+// together (group commit), so the cost of a sync is shared by every
+// request that arrived while the previous one was running.
+//
+// Each record is framed as a little-endian length, a CRC-32 of the payload
+// and the payload. Segments are named after the sequence number of their
+// first record and rotated once they reach the size limit. On open, the
+// last segment is scanned and cut back to its last intact record, which
+// drops anything torn by a crash mid-write.
+//
+// Old segments are removed whole: beyond maxSegments on each rotation
+// (0 keeps them all), or once truncateBefore() says a consumer no longer
+// needs their records. The segment being written is never removed.
+class SegmentLog : public RecordSink {
+public:
+    enum SyncMode {
+        GROUP_COMMIT,       // one sync per batch of queued records
+        SYNC_EACH_RECORD    // one write and sync per record
+    };
+
+    explicit SegmentLog(const std::string& directory,
+                        std::size_t maxSegmentBytes = 64 * 1024 * 1024,
+                        SyncMode mode = GROUP_COMMIT,
+                        std::size_t maxSegments = 0);
+    ~SegmentLog();
+
+    SegmentLog(const SegmentLog&) = delete;
+    SegmentLog& operator=(const SegmentLog&) = delete;
+
+    // Appends a record and returns its sequence number once it is durable.
+    // Throws Poco::WriteFileException if it could not be written.
+    Poco::UInt64 append(const std::string& record);
+
+    // RecordSink
+    void store(const std::string& json) override;
+
+    // Calls fn for every record in the log, oldest first.
+    void replay(const std::function<void(Poco::UInt64, const std::string&)>& fn) const;
+
+    // Sequence number the next record will get.
+    Poco::UInt64 nextSequence() const;
+
+    // Removes every segment whose records are all below sequence, for a
+    // consumer that has copied them elsewhere. Returns how many it removed.
+    std::size_t truncateBefore(Poco::UInt64 sequence);
+
+private:
+    struct Pending {
+        Poco::UInt64 sequence;
+        std::string record;
+    };
+
+    void recover();
+    void openSegment(Poco::UInt64 firstSequence);
+    void closeSegment();
+    void writerLoop();
+    void writeBatch(std::deque<Pending>& batch);
+    std::string segmentPath(Poco::UInt64 firstSequence) const;
+    std::vector<Poco::UInt64> listSegments() const;
+    std::size_t removeSegments(std::size_t keep, Poco::UInt64 before);
+
+    const std::string _directory;
+    const std::size_t _maxSegmentBytes;
+    const SyncMode _mode;
+    const std::size_t _maxSegments;
+
+    int _fd;
+    std::size_t _segmentBytes;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _queued;
+    std::condition_variable _durable;
+    std::deque<Pending> _pending;
+    Poco::UInt64 _nextSequence;
+    Poco::UInt64 _durableSequence;   // every record below this is on disk
+    std::string _error;              // set once a write fails; the log is then read-only
+    bool _stopping;
+    std::thread _writer;
+    std::mutex _removeMutex;         // one removal at a time
+};
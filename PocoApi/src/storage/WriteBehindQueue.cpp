@@ -0,0 +1,231 @@
+#include "storage/WriteBehindQueue.hpp"
+#include "Logger.hpp"
+#include "Poco/Exception.h"
+#include "Poco/FileStream.h"
+#include <algorithm>
+
+namespace {
+
+// Retry delays after a failed flush double up to this.
+const std::chrono::milliseconds MAX_RETRY_DELAY(5000);
+
+// Failed batch inserts in a row before the records are tried one by one
+const int SPLIT_AFTER_FAILURES = 3;
+
+// Failed inserts of a record on its own before it is dead-lettered
+const int MAX_RECORD_FAILURES = 3;
+
+const std::vector<double>& flushSizeBuckets() {
+    static const std::vector<double> buckets = { 1, 5, 10, 25, 50, 100, 250, 500, 1000, 2500 };
+    return buckets;
+}
+
+} // namespace
+
+// --- WriteBehindQueue implementation ---
+WriteBehindQueue::WriteBehindQueue(const std::string& connectionString,
+                                   std::size_t capacity,
+                                   std::size_t maxBatch,
+                                   std::chrono::milliseconds maxDelay,
+                                   std::chrono::milliseconds enqueueTimeout,
+                                   const std::string& deadLetterPath)
+    : _capacity(capacity),
+      _maxBatch(maxBatch),
+      _maxDelay(maxDelay),
+      _enqueueTimeout(enqueueTimeout),
+      _deadLetterPath(deadLetterPath),
+      _db(connectionString),
+      _stopping(false),
+      _depth(MetricsRegistry::instance().gauge("writebehind_queue_depth", "Records waiting to be written to the database")),
+      _rejected(MetricsRegistry::instance().counter("writebehind_rejected_total", "Records rejected because the write-behind queue was full")),
+      _flushErrors(MetricsRegistry::instance().counter("writebehind_flush_errors_total", "Failed write-behind flushes")),
+      _dropped(MetricsRegistry::instance().counter("writebehind_dropped_total", "Records discarded at shutdown because the database was unavailable")),
+      _deadLettered(MetricsRegistry::instance().counter("writebehind_dead_letter_total", "Records the database kept refusing, moved to the dead-letter file")),
+      _flushSize(MetricsRegistry::instance().histogram("writebehind_flush_records", "Records written per write-behind flush", flushSizeBuckets())),
+      _flushLatency(MetricsRegistry::instance().histogram("writebehind_flush_latency_ms", "Time taken by each write-behind flush", latencyBucketsMs())) {
+    _flusher = std::thread(&WriteBehindQueue::flushLoop, this);
+}
+
+WriteBehindQueue::~WriteBehindQueue() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _queued.notify_one();
+    _flusher.join();
+    _db.disconnect();
+}
+
+void WriteBehindQueue::store(const std::string& json) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_drained.wait_for(lock, _enqueueTimeout, [&] { return _queue.size() < _capacity; })) {
+        _rejected.inc();
+        throw Poco::TimeoutException("Write-behind queue is full");
+    }
+    _queue.push_back(Queued{ Clock::now(), json, 0 });
+    _depth.set(static_cast<std::int64_t>(_queue.size()));
+    // The flusher needs waking for a first record (to start its timer) and
+    // for a full batch
+    if (_queue.size() == 1 || _queue.size() >= _maxBatch) {
+        _queued.notify_one();
+    }
+}
+
+std::size_t WriteBehindQueue::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _queue.size();
+}
+
+void WriteBehindQueue::flushLoop() {
+    std::vector<std::string> batch;
+    std::vector<RecordOutcome> outcomes;
+    std::vector<std::string> deadLetters;
+    std::chrono::milliseconds retryDelay(0);
+    int batchFailures = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (retryDelay.count() > 0) {
+                _queued.wait_for(lock, retryDelay, [&] { return _stopping; });
+            }
+            // Wait for a full batch, for the oldest record to come due, or
+            // for shutdown
+            for (;;) {
+                if (_stopping || _queue.size() >= _maxBatch) break;
+                if (_queue.empty()) {
+                    _queued.wait(lock);
+                    continue;
+                }
+                const Clock::time_point due = _queue.front().queuedAt + _maxDelay;
+                if (Clock::now() >= due) break;
+                _queued.wait_until(lock, due);
+            }
+            if (_queue.empty()) {
+                return;   // stopping and drained
+            }
+            if (_stopping && retryDelay.count() > 0) {
+                // The database was still failing when we were asked to stop
+                _dropped.inc(_queue.size());
+                logError("Write-behind queue: dropping {} records, database unavailable", _queue.size());
+                _queue.clear();
+                _depth.set(0);
+                _drained.notify_all();
+                return;
+            }
+
+            // Copy rather than pop: the batch stays queued until it is stored
+            batch.clear();
+            const std::size_t n = std::min(_queue.size(), _maxBatch);
+            for (std::size_t i = 0; i < n; ++i) {
+                batch.push_back(_queue[i].record);
+            }
+        }
+
+        if (batchFailures < SPLIT_AFTER_FAILURES) {
+            const bool stored = flush(batch);
+            outcomes.assign(batch.size(), stored ? RECORD_STORED : RECORD_NOT_TRIED);
+            batchFailures = stored ? 0 : batchFailures + 1;
+        } else {
+            flushEach(batch, outcomes);
+        }
+
+        bool pending = false;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            // Only the flusher removes records and new ones go to the back,
+            // so the batch is still the first batch.size() entries
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                Queued& queued = _queue[i];
+                if (outcomes[i] == RECORD_FAILED && ++queued.failures >= MAX_RECORD_FAILURES) {
+                    deadLetters.push_back(std::move(queued.record));
+                } else if (outcomes[i] != RECORD_STORED) {
+                    if (kept != i) {
+                        _queue[kept] = std::move(queued);
+                    }
+                    ++kept;
+                }
+            }
+            _queue.erase(_queue.begin() + static_cast<std::ptrdiff_t>(kept),
+                         _queue.begin() + static_cast<std::ptrdiff_t>(batch.size()));
+            _depth.set(static_cast<std::int64_t>(_queue.size()));
+            if (kept < batch.size()) {
+                _drained.notify_all();
+            }
+            pending = kept > 0;
+        }
+
+        if (!deadLetters.empty()) {
+            deadLetter(deadLetters);
+            deadLetters.clear();
+        }
+        if (!pending) {
+            // Back to whole batches once the records that held them up are gone
+            batchFailures = 0;
+            retryDelay = std::chrono::milliseconds(0);
+        } else {
+            retryDelay = std::min(MAX_RETRY_DELAY, std::max(std::chrono::milliseconds(100), retryDelay * 2));
+        }
+    }
+}
+
+bool WriteBehindQueue::flush(std::vector<std::string>& batch) {
+    const Clock::time_point start = Clock::now();
+    try {
+        if (!_db.isConnected() && !_db.connect()) {
+            _flushErrors.inc();
+            return false;
+        }
+        DatabaseService::UnitOfWork work(_db);
+        _db.insertRecords(batch);
+        work.commit();
+    } catch (const std::exception& ex) {
+        _flushErrors.inc();
+        logError("Write-behind flush failed: {}", ex.what());
+        _db.disconnect();
+        return false;
+    }
+    _flushSize.observe(static_cast<double>(batch.size()));
+    _flushLatency.observe(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    return true;
+}
+
+void WriteBehindQueue::flushEach(const std::vector<std::string>& batch, std::vector<RecordOutcome>& outcomes) {
+    outcomes.assign(batch.size(), RECORD_NOT_TRIED);
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (!_db.isConnected() && !_db.connect()) {
+            _flushErrors.inc();
+            return;
+        }
+        try {
+            DatabaseService::UnitOfWork work(_db);
+            _db.insertRecord(batch[i]);
+            work.commit();
+            outcomes[i] = RECORD_STORED;
+        } catch (const std::exception& ex) {
+            _flushErrors.inc();
+            logError("Write-behind insert failed: {}", ex.what());
+            _db.disconnect();
+            // Held against the record only if the database is still there
+            if (!_db.connect()) {
+                return;
+            }
+            outcomes[i] = RECORD_FAILED;
+        }
+    }
+}
+
+void WriteBehindQueue::deadLetter(const std::vector<std::string>& records) {
+    _deadLettered.inc(records.size());
+    logError("Write-behind queue: moving {} records the database keeps refusing to {}", records.size(), _deadLetterPath);
+    try {
+        Poco::FileOutputStream out(_deadLetterPath, std::ios::out | std::ios::app);
+        for (const auto& record : records) {
+            out << record << '\n';
+        }
+        out.close();
+    } catch (const Poco::Exception& ex) {
+        logError("Write-behind queue: cannot write {}, {} records lost: {}", _deadLetterPath, records.size(), ex.displayText());
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "storage/RecordSink.hpp"
+#include "DatabaseService.hpp"
+#include "Metrics.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stores records in the database asynchronously, in batches.
+//
+// store() only queues the record; a flusher thread inserts whatever is
+// queued once maxBatch records are waiting or the oldest has waited
+// maxDelay, using one array-bound INSERT per batch. When the queue is full
+// store() waits up to enqueueTimeout for room and then throws
+// Poco::TimeoutException, so a slow or unavailable database pushes back on
+// clients instead of growing the queue without bound. Failed batches are
+// retried with backoff and stay at the head of the queue meanwhile.
+//
+// A batch that has failed SPLIT_AFTER_FAILURES times in a row is retried
+// one record at a time, so one record the database will never take (a
+// constraint violation, a value the driver cannot bind) does not hold up
+// the rest. A record that fails on its own while the database is still
+// reachable is retried like a batch; after MAX_RECORD_FAILURES it is
+// appended to the dead-letter file, one JSON line each, and counted in
+// writebehind_dead_letter_total.
+//
+// Records are acknowledged before they reach the database; anything still
+// queued is lost if the process dies.
+class WriteBehindQueue : public RecordSink {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    WriteBehindQueue(const std::string& connectionString,
+                     std::size_t capacity = 10000,
+                     std::size_t maxBatch = 500,
+                     std::chrono::milliseconds maxDelay = std::chrono::milliseconds(50),
+                     std::chrono::milliseconds enqueueTimeout = std::chrono::milliseconds(100),
+                     const std::string& deadLetterPath = "writebehind_dead_letter.ndjson");
+
+    // Flushes what is still queued, then stops the flusher.
+    ~WriteBehindQueue();
+
+    WriteBehindQueue(const WriteBehindQueue&) = delete;
+    WriteBehindQueue& operator=(const WriteBehindQueue&) = delete;
+
+    // RecordSink
+    void store(const std::string& json) override;
+
+    std::size_t size() const;
+
+private:
+    struct Queued {
+        Clock::time_point queuedAt;
+        std::string record;
+        int failures;       // inserts of this record alone that failed
+    };
+
+    enum RecordOutcome {
+        RECORD_STORED,
+        RECORD_FAILED,      // failed with the database reachable
+        RECORD_NOT_TRIED    // the database was unavailable
+    };
+
+    void flushLoop();
+    bool flush(std::vector<std::string>& batch);
+    void flushEach(const std::vector<std::string>& batch, std::vector<RecordOutcome>& outcomes);
+    void deadLetter(const std::vector<std::string>& records);
+
+    const std::size_t _capacity;
+    const std::size_t _maxBatch;
+    const std::chrono::milliseconds _maxDelay;
+    const std::chrono::milliseconds _enqueueTimeout;
+    const std::string _deadLetterPath;
+
+    DatabaseService _db;    // used by the flusher thread only
+
+    mutable std::mutex _mutex;
+    std::condition_variable _queued;
+    std::condition_variable _drained;
+    std::deque<Queued> _queue;
+    bool _stopping;
+    std::thread _flusher;
+
+    Gauge& _depth;
+    Counter& _rejected;
+    Counter& _flushErrors;
+    Counter& _dropped;
+    Counter& _deadLettered;
+    Histogram& _flushSize;
+    Histogram& _flushLatency;
+};
@@ -0,0 +1,207 @@
+#include "AccessLog.hpp"
+#include "Logger.hpp"
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/NumberParser.h>
+#include <Poco/Path.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+const char* SEGMENT_PREFIX = "access-";
+const char* SEGMENT_SUFFIX = ".bin";
+
+std::uint64_t microsecondsSinceEpoch(std::chrono::system_clock::time_point time) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count());
+}
+
+std::uint32_t clampToUInt32(long long value) {
+    return static_cast<std::uint32_t>(std::min<long long>(std::max<long long>(value, 0), 0xFFFFFFFFLL));
+}
+
+}
+
+// --- AccessLog implementation ---
+AccessLog::AccessLog(const std::string& directory, std::size_t recordsPerSegment, std::size_t maxSegments)
+    : _directory(directory),
+      _recordsPerSegment(recordsPerSegment),
+      _maxSegments(std::max<std::size_t>(maxSegments, 1)),
+      _written(MetricsRegistry::instance().counter("access_log_records_total", "Access records written")),
+      _dropped(MetricsRegistry::instance().counter("access_log_dropped_total", "Access records lost because no segment could be mapped")) {
+    try {
+        Poco::File(_directory).createDirectories();
+        // Never write into a segment left by an earlier run; start a new one
+        const std::vector<std::uint64_t> segments = listSegments();
+        std::atomic_store(&_current, openSegment(segments.empty() ? 1 : segments.back() + 1));
+    } catch (const Poco::Exception& ex) {
+        logWarning("Access log disabled: {}", ex.displayText());
+    }
+}
+
+bool AccessLog::isOpen() const {
+    return std::atomic_load(&_current) != nullptr;
+}
+
+void AccessLog::append(AccessRecord& record) {
+    record.crc = accessRecordChecksum(record);
+    for (;;) {
+        const std::shared_ptr<Segment> segment = std::atomic_load(&_current);
+        if (!segment) {
+            _dropped.inc();
+            return;
+        }
+        const std::size_t slot = segment->next.fetch_add(1, std::memory_order_relaxed);
+        if (slot < _recordsPerSegment) {
+            segment->records[slot] = record;
+            _written.inc();
+            return;
+        }
+        rotate(segment);
+    }
+}
+
+void AccessLog::rotate(const std::shared_ptr<Segment>& full) {
+    std::lock_guard<std::mutex> lock(_rotateMutex);
+    if (std::atomic_load(&_current) != full) {
+        // Another thread got here first
+        return;
+    }
+    try {
+        std::atomic_store(&_current, openSegment(full->sequence + 1));
+    } catch (const Poco::Exception& ex) {
+        logError("Access log disabled, cannot open the next segment: {}", ex.displayText());
+        std::atomic_store(&_current, std::shared_ptr<Segment>());
+        return;
+    }
+
+    // The full segment stays mapped until its last writer lets go of it
+    const std::vector<std::uint64_t> segments = listSegments();
+    for (std::size_t i = 0; i + _maxSegments < segments.size(); ++i) {
+        try {
+            Poco::File(segmentPath(segments[i])).remove();
+        } catch (const Poco::Exception& ex) {
+            logWarning("Cannot remove old access log segment: {}", ex.displayText());
+        }
+    }
+}
+
+std::shared_ptr<AccessLog::Segment> AccessLog::openSegment(std::uint64_t sequence) {
+    const std::size_t fileSize = sizeof(AccessLogSegmentHeader) + _recordsPerSegment * sizeof(AccessRecord);
+    Poco::File file(segmentPath(sequence));
+    file.createFile();
+    file.setSize(fileSize);
+
+    std::shared_ptr<Segment> segment = std::make_shared<Segment>();
+    segment->memory.reset(new Poco::SharedMemory(file, Poco::SharedMemory::AM_WRITE));
+    segment->sequence = sequence;
+
+    AccessLogSegmentHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, ACCESS_LOG_MAGIC, sizeof(ACCESS_LOG_MAGIC));
+    header.formatVersion = ACCESS_LOG_FORMAT_VERSION;
+    header.recordSize = static_cast<std::uint32_t>(sizeof(AccessRecord));
+    header.capacity = _recordsPerSegment;
+    header.sequence = sequence;
+    header.createdUs = microsecondsSinceEpoch(std::chrono::system_clock::now());
+    std::memcpy(segment->memory->begin(), &header, sizeof(header));
+    segment->records = reinterpret_cast<AccessRecord*>(segment->memory->begin() + sizeof(header));
+    return segment;
+}
+
+std::string AccessLog::segmentPath(std::uint64_t sequence) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%020llu%s", SEGMENT_PREFIX,
+                  static_cast<unsigned long long>(sequence), SEGMENT_SUFFIX);
+    return Poco::Path(_directory, name).toString();
+}
+
+std::vector<std::uint64_t> AccessLog::listSegments() const {
+    std::vector<std::string> names;
+    Poco::File(_directory).list(names);
+
+    const std::string prefix(SEGMENT_PREFIX);
+    const std::string suffix(SEGMENT_SUFFIX);
+    std::vector<std::uint64_t> segments;
+    for (const auto& name : names) {
+        Poco::UInt64 sequence;
+        if (name.size() > prefix.size() + suffix.size()
+            && name.compare(0, prefix.size(), prefix) == 0
+            && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0
+            && Poco::NumberParser::tryParseUnsigned64(
+                   name.substr(prefix.size(), name.size() - prefix.size() - suffix.size()), sequence)) {
+            segments.push_back(sequence);
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+AccessLog::Notes& AccessLog::notes() {
+    thread_local Notes notes;
+    return notes;
+}
+
+void AccessLog::noteFault(std::string_view faultCode) {
+    copyAccessField(notes().faultCode, sizeof(Notes::faultCode), faultCode);
+}
+
+void AccessLog::noteResponseBytes(std::size_t bytes) {
+    notes().responseBytes += bytes;
+}
+
+AccessMethod AccessLog::methodOf(const std::string& method) {
+    if (method == Poco::Net::HTTPRequest::HTTP_GET) return METHOD_GET;
+    if (method == Poco::Net::HTTPRequest::HTTP_POST) return METHOD_POST;
+    if (method == Poco::Net::HTTPRequest::HTTP_PUT) return METHOD_PUT;
+    if (method == Poco::Net::HTTPRequest::HTTP_DELETE) return METHOD_DELETE;
+    if (method == Poco::Net::HTTPRequest::HTTP_HEAD) return METHOD_HEAD;
+    return METHOD_OTHER;
+}
+
+// --- AccessLogHandler implementation ---
+AccessLogHandler::AccessLogHandler(Poco::Net::HTTPRequestHandler* pHandler, AccessLog& log, AccessService service,
+                                   std::string_view route, std::chrono::microseconds queued)
+    : _pHandler(pHandler), _log(log), _service(service), _queued(queued) {
+    copyAccessField(_route, sizeof(_route), route);
+}
+
+void AccessLogHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) {
+    AccessLog::Notes& notes = AccessLog::notes();
+    std::memset(notes.faultCode, 0, sizeof(notes.faultCode));
+    notes.responseBytes = 0;
+
+    const auto start = std::chrono::system_clock::now();
+    const auto started = std::chrono::steady_clock::now();
+    try {
+        _pHandler->handleRequest(request, response);
+    } catch (...) {
+        // The server answers 500 if it still can
+        record(request, response, start, std::chrono::steady_clock::now() - started,
+               Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+        throw;
+    }
+    record(request, response, start, std::chrono::steady_clock::now() - started, response.getStatus());
+}
+
+void AccessLogHandler::record(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+                              std::chrono::system_clock::time_point start, std::chrono::steady_clock::duration elapsed,
+                              int status) {
+    const AccessLog::Notes& notes = AccessLog::notes();
+    AccessRecord record;
+    record.startUs = microsecondsSinceEpoch(start);
+    record.latencyUs = clampToUInt32(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    record.queueUs = clampToUInt32(_queued.count());
+    record.requestBytes = clampToUInt32(request.getContentLength64());
+    // Bodies sent through ResponseWriter are counted; otherwise the
+    // declared length is all we know
+    record.responseBytes = notes.responseBytes > 0 ? clampToUInt32(static_cast<long long>(notes.responseBytes))
+                                                   : clampToUInt32(response.getContentLength64());
+    record.status = static_cast<std::uint16_t>(status);
+    record.service = _service;
+    record.method = AccessLog::methodOf(request.getMethod());
+    std::memcpy(record.route, _route, sizeof(record.route));
+    std::memcpy(record.faultCode, notes.faultCode, sizeof(record.faultCode));
+    _log.append(record);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "AccessLogFormat.hpp"
+#include "Metrics.hpp"
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/SharedMemory.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary access log: one fixed-size AccessRecord per request, written
+// into memory-mapped segment files in a directory (see AccessLogFormat.hpp
+// and the accesslog tool).
+//
+// Appending claims the next slot of the current segment with an atomic
+// increment and copies the record into the mapping; there is no lock, no
+// formatting and no system call. The thread that finds a segment full
+// maps the next one, and the oldest segments beyond maxSegments are
+// deleted. Records reach the file through the page cache, so they
+// survive the process crashing but not the host. A directory that cannot
+// be written disables the log rather than the service.
+class AccessLog {
+public:
+    AccessLog(const std::string& directory, std::size_t recordsPerSegment = 1024 * 1024, std::size_t maxSegments = 16);
+
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    bool isOpen() const;
+
+    // Fills in the checksum and stores the record.
+    void append(AccessRecord& record);
+
+    // What the handler knows about the request on this thread and the
+    // logging wrapper does not; cleared when the wrapper starts.
+    static void noteFault(std::string_view faultCode);
+    static void noteResponseBytes(std::size_t bytes);
+
+    static AccessMethod methodOf(const std::string& method);
+
+private:
+    friend class AccessLogHandler;
+
+    struct Notes {
+        char faultCode[sizeof(AccessRecord::faultCode)];
+        std::size_t responseBytes;
+    };
+    static Notes& notes();
+
+    struct Segment {
+        std::unique_ptr<Poco::SharedMemory> memory;
+        AccessRecord* records = nullptr;
+        std::uint64_t sequence = 0;
+        std::atomic<std::size_t> next{0};
+    };
+
+    std::shared_ptr<Segment> openSegment(std::uint64_t sequence);
+    void rotate(const std::shared_ptr<Segment>& full);
+    std::string segmentPath(std::uint64_t sequence) const;
+    std::vector<std::uint64_t> listSegments() const;
+
+    const std::string _directory;
+    const std::size_t _recordsPerSegment;
+    const std::size_t _maxSegments;
+
+    std::shared_ptr<Segment> _current;  // std::atomic_load/atomic_store only
+    std::mutex _rotateMutex;
+
+    Counter& _written;
+    Counter& _dropped;
+};
+
+// Times a request handler and appends its access record once the handler
+// has returned.
+class AccessLogHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    // Takes ownership of pHandler. route is the SOAP operation or REST
+    // path; queued is how long the connection waited to be accepted.
+    AccessLogHandler(Poco::Net::HTTPRequestHandler* pHandler, AccessLog& log, AccessService service,
+                     std::string_view route, std::chrono::microseconds queued);
+
+    void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override;
+
+private:
+    void record(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+                std::chrono::system_clock::time_point start, std::chrono::steady_clock::duration elapsed,
+                int status);
+
+    std::unique_ptr<Poco::Net::HTTPRequestHandler> _pHandler;
+    AccessLog& _log;
+    const AccessService _service;
+    char _route[sizeof(AccessRecord::route)];
+    const std::chrono::microseconds _queued;
+};
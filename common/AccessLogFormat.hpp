@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Poco/Checksum.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// On-disk layout of the binary access log, shared by the services that
+// write it and the accesslog tool that reads it.
+//
+// A segment file is an AccessLogSegmentHeader followed by capacity
+// fixed-size AccessRecords, in host byte order (little-endian on every
+// platform we build for). The file is created at full size, so slots
+// not written yet are all zero; a reader keeps only records whose CRC-32
+// matches, which also drops any slot a crash left half written.
+
+const char ACCESS_LOG_MAGIC[8] = { 'A', 'C', 'C', 'E', 'S', 'S', 'L', 'G' };
+const std::uint32_t ACCESS_LOG_FORMAT_VERSION = 1;
+
+struct AccessLogSegmentHeader {
+    char magic[8];
+    std::uint32_t formatVersion;
+    std::uint32_t recordSize;
+    std::uint64_t capacity;         // records in the segment
+    std::uint64_t sequence;         // segment number, also in its file name
+    std::uint64_t createdUs;        // microseconds since the epoch
+    char reserved[24];
+};
+
+enum AccessService : std::uint8_t {
+    SERVICE_SOAP = 1,
+    SERVICE_REST = 2
+};
+
+enum AccessMethod : std::uint8_t {
+    METHOD_OTHER = 0,
+    METHOD_GET = 1,
+    METHOD_POST = 2,
+    METHOD_PUT = 3,
+    METHOD_DELETE = 4,
+    METHOD_HEAD = 5
+};
+
+// One request. Text fields are cut to fit and NUL padded.
+struct AccessRecord {
+    std::uint64_t startUs;          // when the handler started, microseconds since the epoch
+    std::uint32_t latencyUs;        // handler start to response sent
+    std::uint32_t queueUs;          // time the connection waited to be accepted, if known
+    std::uint32_t requestBytes;     // request Content-Length, 0 if none
+    std::uint32_t responseBytes;    // body bytes sent
+    std::uint16_t status;
+    std::uint8_t service;           // AccessService
+    std::uint8_t method;            // AccessMethod
+    char route[24];                 // SOAP operation or REST path
+    char faultCode[24];             // SOAP fault code, empty on success
+    std::uint32_t crc;              // CRC-32 of everything above
+};
+
+static_assert(sizeof(AccessLogSegmentHeader) == 64, "AccessLogSegmentHeader layout");
+static_assert(sizeof(AccessRecord) == 80, "AccessRecord layout");
+
+inline std::uint32_t accessRecordChecksum(const AccessRecord& record) {
+    Poco::Checksum crc32(Poco::Checksum::TYPE_CRC32);
+    crc32.update(reinterpret_cast<const char*>(&record), static_cast<unsigned>(offsetof(AccessRecord, crc)));
+    return crc32.checksum();
+}
+
+inline void copyAccessField(char* field, std::size_t size, std::string_view text) {
+    const std::size_t length = text.size() < size ? text.size() : size;
+    std::memcpy(field, text.data(), length);
+    std::memset(field + length, 0, size - length);
+}
+
+// A text field as written, without its padding.
+inline std::string_view accessField(const char* field, std::size_t size) {
+    std::size_t length = 0;
+    while (length < size && field[length] != '\0') {
+        ++length;
+    }
+    return std::string_view(field, length);
+}
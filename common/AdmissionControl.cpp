@@ -0,0 +1,81 @@
+#include "AdmissionControl.hpp"
+#include <Poco/Exception.h>
+
+namespace {
+
+// How often the acceptor looks for stamps older than staleAfter
+const std::chrono::seconds PURGE_INTERVAL(60);
+
+}
+
+// --- AdmissionController implementation ---
+AdmissionController::AdmissionController(std::chrono::milliseconds targetQueueDelay, int retryAfterSeconds,
+                                         std::chrono::seconds staleAfter)
+    : _targetQueueDelay(targetQueueDelay),
+      _retryAfterSeconds(retryAfterSeconds),
+      _staleAfter(staleAfter),
+      _lastPurge(Clock::now()),
+      _served(MetricsRegistry::instance().counter("admission_served_total", "Requests admitted by admission control")),
+      _shed(MetricsRegistry::instance().counter("admission_shed_total", "Requests rejected because they queued too long")),
+      _queueDelay(MetricsRegistry::instance().histogram("admission_queue_delay_ms", "Time connections spent in the accept queue", latencyBucketsMs())) {
+}
+
+void AdmissionController::connectionQueued(const Poco::Net::SocketAddress& peer) {
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queuedAt[peer.toString()] = now;
+    if (now - _lastPurge > PURGE_INTERVAL) {
+        purgeStale(now);
+    }
+}
+
+std::chrono::microseconds AdmissionController::takeQueueDelay(const Poco::Net::SocketAddress& peer) {
+    const Clock::time_point now = Clock::now();
+    Clock::duration waited;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _queuedAt.find(peer.toString());
+        if (it == _queuedAt.end()) {
+            return std::chrono::microseconds::zero();
+        }
+        waited = now - it->second;
+        _queuedAt.erase(it);
+    }
+
+    _queueDelay.observe(std::chrono::duration<double, std::milli>(waited).count());
+    return std::chrono::duration_cast<std::chrono::microseconds>(waited);
+}
+
+bool AdmissionController::admit(std::chrono::microseconds waited) {
+    if (waited > _targetQueueDelay) {
+        _shed.inc();
+        return false;
+    }
+    _served.inc();
+    return true;
+}
+
+void AdmissionController::purgeStale(Clock::time_point now) {
+    for (auto it = _queuedAt.begin(); it != _queuedAt.end();) {
+        if (now - it->second > _staleAfter) {
+            it = _queuedAt.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    _lastPurge = now;
+}
+
+// --- QueueTimingFilter implementation ---
+QueueTimingFilter::QueueTimingFilter(AdmissionController& controller)
+    : _controller(controller) {
+}
+
+bool QueueTimingFilter::accept(const Poco::Net::StreamSocket& socket) {
+    try {
+        _controller.connectionQueued(socket.peerAddress());
+    } catch (const Poco::Exception&) {
+        // The peer is already gone; let the server deal with it as usual.
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Metrics.hpp"
+#include <Poco/Net/SocketAddress.h>
+#include <Poco/Net/StreamSocket.h>
+#include <Poco/Net/TCPServerConnectionFilter.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Sheds load when connections wait too long in the HTTPServer queue.
+//
+// QueueTimingFilter stamps each connection as the acceptor thread queues
+// it; when a worker thread later builds a handler for the connection's
+// first request, takeQueueDelay() turns the stamp into the time spent
+// queued and admit() compares that against the target. Requests that have
+// already waited too long are rejected with a cheap 503 instead of being
+// served to a client that has likely given up.
+//
+// A connection closed before its first request leaves its stamp behind,
+// so stamps older than staleAfter are purged. A purged stamp reads as no
+// queueing at all, which would admit the request, so staleAfter must be
+// far beyond any wait still worth measuring: the callers pass a multiple
+// of the HTTPServer timeout.
+class AdmissionController {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    AdmissionController(std::chrono::milliseconds targetQueueDelay, int retryAfterSeconds,
+                        std::chrono::seconds staleAfter = std::chrono::minutes(10));
+
+    // Called from the acceptor thread for every accepted connection.
+    void connectionQueued(const Poco::Net::SocketAddress& peer);
+
+    // Called from the request handler factory for every request, before
+    // anything else may answer it, so a connection's stamp is always
+    // taken by its first request and never left for a later one. Returns
+    // the time the connection spent queued; zero for later requests on a
+    // kept-alive connection, which were never queued and add no sample.
+    std::chrono::microseconds takeQueueDelay(const Poco::Net::SocketAddress& peer);
+
+    // Returns false if a request that waited this long in the queue should
+    // be shed.
+    bool admit(std::chrono::microseconds waited);
+
+    int retryAfterSeconds() const { return _retryAfterSeconds; }
+
+private:
+    void purgeStale(Clock::time_point now);
+
+    const std::chrono::milliseconds _targetQueueDelay;
+    const int _retryAfterSeconds;
+    const std::chrono::seconds _staleAfter;
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, Clock::time_point> _queuedAt;
+    Clock::time_point _lastPurge;
+
+    Counter& _served;
+    Counter& _shed;
+    Histogram& _queueDelay;
+};
+
+class QueueTimingFilter : public Poco::Net::TCPServerConnectionFilter {
+public:
+    explicit QueueTimingFilter(AdmissionController& controller);
+
+    bool accept(const Poco::Net::StreamSocket& socket) override;
+
+private:
+    AdmissionController& _controller;
+};
@@ -0,0 +1,76 @@
+#include "AllocationCounter.hpp"
+
+#ifdef SOAP_ALLOCATION_CHECK
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local std::uint64_t allocations = 0;
+
+void* allocate(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+}
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// --- AllocationCounter implementation ---
+bool AllocationCounter::enabled() {
+    return true;
+}
+
+std::uint64_t AllocationCounter::thisThread() {
+    return allocations;
+}
+
+#else
+
+// --- AllocationCounter implementation ---
+bool AllocationCounter::enabled() {
+    return false;
+}
+
+std::uint64_t AllocationCounter::thisThread() {
+    return 0;
+}
+
+#endif
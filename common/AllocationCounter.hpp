@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts the heap allocations made by the calling thread, for checking
+// that a hot path does not allocate.
+//
+// Counting needs the global operator new replaced, which the
+// AllocationCounter translation unit does when the build defines
+// SOAP_ALLOCATION_CHECK. Without it enabled() is false and the count is
+// always 0, at no cost.
+class AllocationCounter {
+public:
+    static bool enabled();
+    static std::uint64_t thisThread();
+};
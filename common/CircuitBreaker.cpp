@@ -0,0 +1,93 @@
+#include "CircuitBreaker.hpp"
+
+// --- CircuitBreaker implementation ---
+CircuitBreaker::CircuitBreaker(int failureThreshold, std::chrono::milliseconds openPeriod, int halfOpenProbes)
+    : _failureThreshold(failureThreshold),
+      _openPeriod(openPeriod),
+      _halfOpenProbes(halfOpenProbes),
+      _state(CLOSED),
+      _consecutiveFailures(0),
+      _probesInFlight(0),
+      _probeSuccesses(0),
+      _opened(MetricsRegistry::instance().counter("db_circuit_opened_total", "Times a database circuit breaker opened")),
+      _rejected(MetricsRegistry::instance().counter("db_circuit_rejected_total", "Database calls failed fast by an open circuit")),
+      _openBreakers(MetricsRegistry::instance().gauge("db_circuit_open", "Database circuit breakers not closed")) {
+}
+
+bool CircuitBreaker::allow() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_state == OPEN) {
+        if (Clock::now() < _openUntil) {
+            _rejected.inc();
+            return false;
+        }
+        _state = HALF_OPEN;
+        _probesInFlight = 0;
+        _probeSuccesses = 0;
+    }
+    if (_state == HALF_OPEN) {
+        if (_probesInFlight >= _halfOpenProbes) {
+            _rejected.inc();
+            return false;
+        }
+        ++_probesInFlight;
+    }
+    return true;
+}
+
+void CircuitBreaker::onSuccess() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_state == HALF_OPEN) {
+        endProbe();
+        if (++_probeSuccesses >= _halfOpenProbes) {
+            close();
+        }
+        return;
+    }
+    _consecutiveFailures = 0;
+}
+
+void CircuitBreaker::onFailure() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_state == HALF_OPEN) {
+        endProbe();
+        open(Clock::now());
+        return;
+    }
+    if (_state == CLOSED && ++_consecutiveFailures >= _failureThreshold) {
+        open(Clock::now());
+    }
+}
+
+void CircuitBreaker::onNeutral() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_state == HALF_OPEN) {
+        endProbe();
+    }
+}
+
+CircuitBreaker::State CircuitBreaker::state() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _state;
+}
+
+void CircuitBreaker::open(Clock::time_point now) {
+    if (_state == CLOSED) {
+        _openBreakers.add(1);
+    }
+    _state = OPEN;
+    _openUntil = now + _openPeriod;
+    _opened.inc();
+}
+
+void CircuitBreaker::close() {
+    _state = CLOSED;
+    _consecutiveFailures = 0;
+    _openBreakers.add(-1);
+}
+
+void CircuitBreaker::endProbe() {
+    if (_probesInFlight > 0) {
+        --_probesInFlight;
+    }
+}
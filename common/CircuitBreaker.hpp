@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Metrics.hpp"
+#include <chrono>
+#include <mutex>
+
+// Stops calls to a failing dependency so it gets a chance to recover.
+//
+// CLOSED lets every call through and counts consecutive failures; at the
+// threshold the breaker opens. OPEN rejects every call until the open
+// period has passed, then HALF_OPEN lets a few probe calls through at a
+// time: enough successes close the breaker, any failure opens it again.
+// Each call must be allowed before it starts and report its outcome
+// (success, failure or neither) when it ends.
+class CircuitBreaker {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum State {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    };
+
+    CircuitBreaker(int failureThreshold = 5,
+                   std::chrono::milliseconds openPeriod = std::chrono::milliseconds(5000),
+                   int halfOpenProbes = 3);
+
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    // False if the call must fail fast.
+    bool allow();
+
+    void onSuccess();
+    void onFailure();
+    // The call ended without telling us anything about the dependency
+    // (e.g. the caller gave up first).
+    void onNeutral();
+
+    State state() const;
+
+private:
+    void open(Clock::time_point now);
+    void close();
+    void endProbe();
+
+    const int _failureThreshold;
+    const std::chrono::milliseconds _openPeriod;
+    const int _halfOpenProbes;
+
+    mutable std::mutex _mutex;
+    State _state;
+    int _consecutiveFailures;
+    Clock::time_point _openUntil;
+    int _probesInFlight;
+    int _probeSuccesses;
+
+    Counter& _opened;
+    Counter& _rejected;
+    Gauge& _openBreakers;
+};
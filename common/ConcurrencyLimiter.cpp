@@ -0,0 +1,93 @@
+#include "ConcurrencyLimiter.hpp"
+#include <algorithm>
+
+namespace {
+
+// Calls per baseline window; the baseline follows the dependency's own
+// latency as it changes over time (e.g. a bigger table)
+const std::size_t BASELINE_WINDOW = 250;
+
+}
+
+// --- ConcurrencyLimiter implementation ---
+ConcurrencyLimiter::ConcurrencyLimiter(int initialLimit, int minLimit, int maxLimit,
+                                       double tolerance, double backoffRatio)
+    : _minLimit(minLimit),
+      _maxLimit(maxLimit),
+      _tolerance(tolerance),
+      _backoffRatio(backoffRatio),
+      _limit(0.0),
+      _inFlight(0),
+      _baselineMs(0.0),
+      _windowMinMs(0.0),
+      _windowSamples(0),
+      _limitGauge(MetricsRegistry::instance().gauge("db_concurrency_limit", "Adaptive limit on concurrent database calls")),
+      _inFlightGauge(MetricsRegistry::instance().gauge("db_concurrency_in_flight", "Database calls in flight")),
+      _rejected(MetricsRegistry::instance().counter("db_concurrency_rejected_total", "Database calls failed fast at the concurrency limit")) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    setLimit(initialLimit);
+}
+
+bool ConcurrencyLimiter::tryAcquire() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_inFlight >= static_cast<int>(_limit)) {
+        _rejected.inc();
+        return false;
+    }
+    ++_inFlight;
+    _inFlightGauge.add(1);
+    return true;
+}
+
+void ConcurrencyLimiter::release(double latencyMs, bool failed) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const int inFlight = _inFlight--;
+    _inFlightGauge.add(-1);
+
+    if (failed) {
+        // A failure may be fast (connection refused) and says nothing
+        // about the baseline
+        setLimit(_limit * _backoffRatio);
+        return;
+    }
+
+    if (_windowSamples == 0 || latencyMs < _windowMinMs) {
+        _windowMinMs = latencyMs;
+    }
+    if (++_windowSamples >= BASELINE_WINDOW) {
+        _baselineMs = _windowMinMs;
+        _windowSamples = 0;
+    }
+    if (_baselineMs == 0.0 || latencyMs < _baselineMs) {
+        _baselineMs = latencyMs;
+    }
+
+    if (latencyMs > _tolerance * _baselineMs) {
+        setLimit(_limit * _backoffRatio);
+    } else if (inFlight * 2 >= static_cast<int>(_limit)) {
+        // Only grow a limit that is being used, or it drifts up unchecked
+        setLimit(_limit + 1.0);
+    }
+}
+
+void ConcurrencyLimiter::releaseWithoutSample() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    --_inFlight;
+    _inFlightGauge.add(-1);
+}
+
+int ConcurrencyLimiter::limit() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return static_cast<int>(_limit);
+}
+
+int ConcurrencyLimiter::inFlight() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _inFlight;
+}
+
+void ConcurrencyLimiter::setLimit(double limit) {
+    limit = std::min(std::max(limit, _minLimit), _maxLimit);
+    _limitGauge.add(static_cast<int>(limit) - static_cast<int>(_limit));
+    _limit = limit;
+}
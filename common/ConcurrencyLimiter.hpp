@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Metrics.hpp"
+#include <cstddef>
+#include <mutex>
+
+// Caps the calls in flight to a dependency at a limit that adapts to its
+// latency (AIMD).
+//
+// The limiter tracks the lowest latency seen over the last window of
+// calls as the no-load baseline. A call that fails or takes longer than
+// tolerance times the baseline means the dependency is queueing, and the
+// limit is cut by the backoff ratio; a call that succeeds in time while
+// the limit was actually being used raises it by one. When the dependency
+// slows down, callers are turned away before they pile on more load; as
+// it recovers the limit climbs back.
+class ConcurrencyLimiter {
+public:
+    ConcurrencyLimiter(int initialLimit = 20, int minLimit = 1, int maxLimit = 200,
+                       double tolerance = 2.0, double backoffRatio = 0.9);
+
+    ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+    ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+    // False if the limit is reached; the call must then fail fast.
+    bool tryAcquire();
+
+    // Ends a call allowed by tryAcquire().
+    void release(double latencyMs, bool failed);
+    // Ends a call whose outcome says nothing about the dependency (e.g.
+    // the caller gave up first), leaving the limit alone.
+    void releaseWithoutSample();
+
+    int limit() const;
+    int inFlight() const;
+
+private:
+    void setLimit(double limit);
+
+    const double _minLimit;
+    const double _maxLimit;
+    const double _tolerance;
+    const double _backoffRatio;
+
+    mutable std::mutex _mutex;
+    double _limit;
+    int _inFlight;
+    double _baselineMs;        // lowest latency over the previous window
+    double _windowMinMs;       // lowest latency in the current window
+    std::size_t _windowSamples;
+
+    Gauge& _limitGauge;
+    Gauge& _inFlightGauge;
+    Counter& _rejected;
+};
@@ -0,0 +1,431 @@
+#include "DatabaseService.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include <Poco/Data/ODBC/Connector.h>
+#include <Poco/Data/Statement.h>
+#include <Poco/Data/RecordSet.h>
+#include <Poco/Data/DataException.h>
+#include <Poco/Data/Bulk.h>
+#include <Poco/Any.h>
+#include <Poco/Exception.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Poco::Data;
+
+namespace {
+
+const std::string DEFAULT_CONNECTION_STRING =
+    "DRIVER={ODBC Driver 17 for SQL Server};"
+    "SERVER=PR-BACHLITZANA;"
+    "DATABASE=FIDUCIAM_PROD;"
+    "UID=db2admin;"
+    "PWD=db2admin1;";
+
+// SQL Server takes at most 2100 parameters per statement.
+const std::size_t MAX_IN_LIST = 1000;
+
+Counter& roundTripCounter() {
+    static Counter& counter = MetricsRegistry::instance().counter(
+        "db_round_trips_total", "Statements, commits and rollbacks sent to the database");
+    return counter;
+}
+
+}
+
+// --- DatabaseService::UnitOfWork implementation ---
+DatabaseService::UnitOfWork::UnitOfWork(DatabaseService& db)
+    : _db(db), _done(false) {
+    if (_db.accessMode() == READ_ONLY) {
+        throw Poco::IllegalStateException("Unit of work on a read-only database service");
+    }
+    _db.BeginTransaction();
+}
+
+DatabaseService::UnitOfWork::~UnitOfWork() {
+    if (!_done) {
+        _db.RollbackTransaction();
+    }
+}
+
+void DatabaseService::UnitOfWork::commit() {
+    if (!_db.CommitTransaction()) {
+        throw Poco::IOException(_db.errorMessage());
+    }
+    _done = true;
+}
+
+// --- DatabaseService implementation ---
+DatabaseService::DatabaseService()
+    : DatabaseService(DEFAULT_CONNECTION_STRING) {
+}
+
+const std::string& DatabaseService::defaultConnectionString() {
+    return DEFAULT_CONNECTION_STRING;
+}
+
+DatabaseService::DatabaseService(const std::string& connectionString, AccessMode mode)
+    : _connectionString(connectionString),
+      _mode(mode),
+      _pooled(false),
+      _roundTrips(0) {
+    Poco::Data::ODBC::Connector::registerConnector();
+}
+
+DatabaseService::DatabaseService(const Session& session, AccessMode mode)
+    : _mode(mode),
+      _pooled(true),
+      _roundTrips(0) {
+    _session.reset(new Session(session));
+}
+
+DatabaseService::DatabaseService(DatabaseService&& other) = default;
+DatabaseService::~DatabaseService() = default;
+
+bool DatabaseService::connect() {
+    try {
+        if (_pooled) {
+            // Pooled sessions are reused across modes and deadlines; set ours again
+            if (!_session) {
+                return false;
+            }
+            _session->setFeature("autoCommit", _mode == READ_ONLY);
+            _session->setProperty("queryTimeout", Poco::Any(0));
+            return true;
+        }
+        _session.reset(new Session("ODBC", _connectionString));
+        _session->setFeature("autoCommit", _mode == READ_ONLY);
+        return true;
+    } catch (const Poco::Exception& ex) {
+        _errorMessage = "ERR_CONNECT: " + ex.displayText();
+        logError("Database connection error: {}", _errorMessage);
+        return false;
+    }
+}
+
+bool DatabaseService::isConnected() const {
+    return _session && _session->isConnected();
+}
+
+void DatabaseService::setQueryTimeout(std::chrono::milliseconds timeout) {
+    if (!_session) {
+        throw std::runtime_error("Database session is not connected.");
+    }
+    const auto seconds = std::max<std::chrono::milliseconds::rep>(1, (timeout.count() + 999) / 1000);
+    _session->setProperty("queryTimeout", Poco::Any(static_cast<int>(seconds)));
+}
+
+bool DatabaseService::BeginTransaction() {
+    // autoCommit=false makes the first statement begin the transaction
+    // implicitly; there is nothing to send to the server.
+    return isConnected();
+}
+
+bool DatabaseService::CommitTransaction() {
+    if (_mode == READ_ONLY) {
+        return true;
+    }
+    if (isConnected()) {
+        try {
+            // Commit the transaction and save all changes
+            countRoundTrip();
+            _session->commit();
+            return true;
+        } catch (const Poco::Exception& ex) {
+            _errorMessage = "ERR_COMMIT_TRANSACTION: " + ex.message();
+            logError("{}", _errorMessage);
+            return false;
+        }
+    }
+    return false;
+}
+
+bool DatabaseService::RollbackTransaction() {
+    if (_mode == READ_ONLY) {
+        return true;
+    }
+    if (isConnected()) {
+        try {
+            // Rollback the transaction and undo all changes
+            countRoundTrip();
+            _session->rollback();
+            return true;
+        } catch (const Poco::Exception& ex) {
+            _errorMessage = "ERR_ROLLBACK_TRANSACTION: " + ex.message();
+            logError("{}", _errorMessage);
+            return false;
+        }
+    }
+    return false;
+}
+
+std::string DatabaseService::getFullName(const std::string& firstName) {
+    if (!_session) {
+        throw std::runtime_error("Database session is not connected.");
+    }
+
+    try {
+        std::string userLName;
+
+        Statement select(*_session);
+        select << "SELECT USER_LNAME FROM [dbo].[USER] WHERE USER_FNAME = ?",
+            Keywords::into(userLName),
+            Keywords::use(firstName),
+            Keywords::limit(1); // Ensure only one result is returned
+
+        if (execute(select) > 0) {
+            return firstName + " " + userLName;
+        }
+        return ""; // Not found
+    } catch (const DataException& e) {
+        logError("Query execution error: {}", e.displayText());
+        throw; // Re-throw to be caught by the main handler
+    }
+}
+
+std::map<std::string, std::string> DatabaseService::getFullNames(const std::vector<std::string>& firstNames) {
+    if (!_session) {
+        throw std::runtime_error("Database session is not connected.");
+    }
+
+    std::map<std::string, std::string> fullNames;
+    try {
+        for (std::size_t begin = 0; begin < firstNames.size(); begin += MAX_IN_LIST) {
+            const std::size_t end = std::min(firstNames.size(), begin + MAX_IN_LIST);
+            std::vector<std::string> requested;
+            std::vector<std::string> foundLast;
+
+            // Each row carries the name as it was asked for, not as it is
+            // stored: the column's collation matches "john" and "John " to
+            // John, and callers look their results up by their own string.
+            Statement select(*_session);
+            std::string sql = "SELECT v.name, u.USER_LNAME FROM (VALUES ";
+            for (std::size_t i = begin; i < end; ++i) {
+                sql += (i == begin) ? "(?)" : ",(?)";
+            }
+            sql += ") v(name) JOIN [dbo].[USER] u ON u.USER_FNAME = v.name";
+            select << sql, Keywords::into(requested), Keywords::into(foundLast);
+            for (std::size_t i = begin; i < end; ++i) {
+                select, Keywords::use(firstNames[i]);
+            }
+            execute(select);
+
+            // Like getFullName, the first row for a name wins
+            for (std::size_t i = 0; i < requested.size(); ++i) {
+                fullNames.emplace(requested[i], requested[i] + " " + foundLast[i]);
+            }
+        }
+    } catch (const DataException& e) {
+        logError("Query execution error: {}", e.displayText());
+        throw;
+    }
+    return fullNames;
+}
+
+std::vector<NameRow> DatabaseService::loadNames(Poco::Int64 sinceVersion, Poco::Int64* pWatermark) {
+    if (!_session) {
+        throw std::runtime_error("Database session is not connected.");
+    }
+
+    try {
+        std::vector<std::string> firstNames;
+        std::vector<std::string> lastNames;
+        std::vector<Poco::Int64> versions;
+
+        // Every version below the lowest one an open transaction holds is
+        // final; nothing can commit under it later. Taken before the rows,
+        // so rows committed in between are simply left for the next call.
+        Poco::Int64 upTo = 0;
+        Statement bound(*_session);
+        bound << "SELECT CAST(MIN_ACTIVE_ROWVERSION() AS BIGINT)",
+            Keywords::into(upTo);
+        execute(bound);
+
+        // rowversion is a monotonically increasing binary(8); as a BIGINT it
+        // makes a watermark that can be bound and compared directly
+        Statement select(*_session);
+        select << "SELECT USER_FNAME, USER_LNAME, CAST(ROW_VERSION AS BIGINT) FROM [dbo].[USER] "
+                  "WHERE ROW_VERSION > CAST(CAST(? AS BIGINT) AS BINARY(8)) "
+                  "AND ROW_VERSION < CAST(CAST(? AS BIGINT) AS BINARY(8)) ORDER BY ROW_VERSION",
+            Keywords::into(firstNames),
+            Keywords::into(lastNames),
+            Keywords::into(versions),
+            Keywords::use(sinceVersion),
+            Keywords::use(upTo);
+        execute(select);
+
+        if (pWatermark) {
+            *pWatermark = std::max(sinceVersion, upTo - 1);
+        }
+
+        std::vector<NameRow> rows;
+        rows.reserve(firstNames.size());
+        for (std::size_t i = 0; i < firstNames.size(); ++i) {
+            rows.push_back(NameRow{ firstNames[i], lastNames[i], versions[i] });
+        }
+        return rows;
+    } catch (const DataException& e) {
+        logError("Query execution error: {}", e.displayText());
+        throw;
+    }
+}
+
+std::vector<std::string> DatabaseService::loadFirstNames() {
+    if (!_session) {
+        throw std::runtime_error("Database session is not connected.");
+    }
+
+    try {
+        std::vector<std::string> firstNames;
+        Statement select(*_session);
+        select << "SELECT DISTINCT USER_FNAME FROM [dbo].[USER]",
+            Keywords::into(firstNames);
+        execute(select);
+        return firstNames;
+    } catch (const DataException& e) {
+        logError("Query execution error: {}", e.displayText());
+        throw;
+    }
+}
+
+void DatabaseService::exportUsers(const std::string& firstName, std::size_t rowsPerFetch,
+                                  const RowBatchHandler& onBatch) {
+    if (!_session) {
+        throw std::runtime_error("Database session is not connected.");
+    }
+
+    try {
+        std::vector<std::string> firstNames;
+        std::vector<std::string> lastNames;
+
+        Statement select(*_session);
+        if (firstName.empty()) {
+            select << "SELECT USER_FNAME, USER_LNAME FROM [dbo].[USER]",
+                Keywords::into(firstNames, Keywords::bulk(rowsPerFetch)),
+                Keywords::into(lastNames, Keywords::bulk(rowsPerFetch));
+        } else {
+            select << "SELECT USER_FNAME, USER_LNAME FROM [dbo].[USER] WHERE USER_FNAME = ?",
+                Keywords::into(firstNames, Keywords::bulk(rowsPerFetch)),
+                Keywords::into(lastNames, Keywords::bulk(rowsPerFetch)),
+                Keywords::use(firstName);
+        }
+
+        // Each execute() fetches the next row array
+        while (!select.done()) {
+            const std::size_t rows = std::min(execute(select), firstNames.size());
+            if (rows > 0) {
+                onBatch(firstNames, lastNames, rows);
+            }
+        }
+    } catch (const DataException& e) {
+        logError("Query execution error: {}", e.displayText());
+        throw;
+    }
+}
+
+std::vector<NameRow> DatabaseService::listUsers(const NameRow* pAfter, std::size_t pageSize) {
+    if (!_session) {
+        throw std::runtime_error("Database session is not connected.");
+    }
+
+    try {
+        // SQL Server has no row value comparison, so the key predicate is
+        // spelled out. Names compare as binary, not in the column
+        // collation, so the order and the predicate agree with keyBefore(),
+        // which ShardRouter merges shards with; the query resolves to one
+        // index seek when the index over (USER_FNAME, USER_LNAME) is in a
+        // binary collation too (see the README).
+        const int top = static_cast<int>(pageSize);
+        std::vector<std::string> firstNames;
+        std::vector<std::string> lastNames;
+        std::vector<Poco::Int64> versions;
+
+        Statement select(*_session);
+        if (pAfter) {
+            select << "SELECT TOP (?) USER_FNAME, USER_LNAME, CAST(ROW_VERSION AS BIGINT) FROM [dbo].[USER] "
+                      "WHERE USER_FNAME COLLATE Latin1_General_BIN2 > ? "
+                      "OR (USER_FNAME COLLATE Latin1_General_BIN2 = ? "
+                      "AND (USER_LNAME COLLATE Latin1_General_BIN2 > ? "
+                      "OR (USER_LNAME COLLATE Latin1_General_BIN2 = ? "
+                      "AND ROW_VERSION > CAST(CAST(? AS BIGINT) AS BINARY(8))))) "
+                      "ORDER BY USER_FNAME COLLATE Latin1_General_BIN2, USER_LNAME COLLATE Latin1_General_BIN2, "
+                      "ROW_VERSION",
+                Keywords::use(top),
+                Keywords::use(pAfter->firstName), Keywords::use(pAfter->firstName),
+                Keywords::use(pAfter->lastName), Keywords::use(pAfter->lastName),
+                Keywords::use(pAfter->version),
+                Keywords::into(firstNames), Keywords::into(lastNames), Keywords::into(versions);
+        } else {
+            select << "SELECT TOP (?) USER_FNAME, USER_LNAME, CAST(ROW_VERSION AS BIGINT) FROM [dbo].[USER] "
+                      "ORDER BY USER_FNAME COLLATE Latin1_General_BIN2, USER_LNAME COLLATE Latin1_General_BIN2, "
+                      "ROW_VERSION",
+                Keywords::use(top),
+                Keywords::into(firstNames), Keywords::into(lastNames), Keywords::into(versions);
+        }
+        execute(select);
+
+        std::vector<NameRow> rows;
+        rows.reserve(firstNames.size());
+        for (std::size_t i = 0; i < firstNames.size(); ++i) {
+            rows.push_back(NameRow{ firstNames[i], lastNames[i], versions[i] });
+        }
+        return rows;
+    } catch (const DataException& e) {
+        logError("Query execution error: {}", e.displayText());
+        throw;
+    }
+}
+
+void DatabaseService::insertRecords(std::vector<std::string>& records) {
+    if (!_session) {
+        throw std::runtime_error("Database session is not connected.");
+    }
+    if (records.empty()) {
+        return;
+    }
+
+    try {
+        // One execution for the whole batch: the vector is bound as a
+        // parameter array, so the rows travel in a single round trip and
+        // SQL Server's 2100-parameter limit does not apply.
+        Statement insert(*_session);
+        insert << "INSERT INTO [dbo].[RECORD] (RECORD_JSON) VALUES (?)",
+            Keywords::use(records, Keywords::bulk);
+        execute(insert);
+    } catch (const DataException& e) {
+        _errorMessage = "ERR_INSERT_RECORDS: " + e.displayText();
+        logError("{}", _errorMessage);
+        throw;
+    }
+}
+
+void DatabaseService::insertRecord(const std::string& record) {
+    if (!_session) {
+        throw std::runtime_error("Database session is not connected.");
+    }
+
+    try {
+        Statement insert(*_session);
+        insert << "INSERT INTO [dbo].[RECORD] (RECORD_JSON) VALUES (?)",
+            Keywords::use(record);
+        execute(insert);
+    } catch (const DataException& e) {
+        _errorMessage = "ERR_INSERT_RECORD: " + e.displayText();
+        logError("{}", _errorMessage);
+        throw;
+    }
+}
+
+void DatabaseService::disconnect() {
+    _session.reset();
+}
+
+std::size_t DatabaseService::execute(Statement& statement) {
+    countRoundTrip();
+    return statement.execute();
+}
+
+void DatabaseService::countRoundTrip() {
+    ++_roundTrips;
+    roundTripCounter().inc();
+}
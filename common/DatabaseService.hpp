@@ -0,0 +1,158 @@
+#pragma once
+
+#include <Poco/Data/Session.h>
+#include <Poco/Types.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One [dbo].[USER] row as loaded into NameIndex.
+struct NameRow {
+    std::string firstName;
+    std::string lastName;
+    Poco::Int64 version;    // ROW_VERSION (rowversion) as a number
+};
+
+// Key order of USER rows, as paged by DatabaseService::listUsers().
+inline bool keyBefore(const NameRow& a, const NameRow& b) {
+    if (a.firstName != b.firstName) return a.firstName < b.firstName;
+    if (a.lastName != b.lastName) return a.lastName < b.lastName;
+    return a.version < b.version;
+}
+
+// Encapsulates all database-related logic to keep the HTTP handlers clean.
+// Shared by the SOAP service (name lookups) and the REST service (record
+// storage). One instance owns one session and is not thread-safe.
+//
+// A READ_ONLY service runs every query in autocommit mode: each statement
+// is its own transaction, so a lookup is one round trip and holds its
+// shared locks only while it runs, with no commit or rollback to follow.
+// (With READ_COMMITTED_SNAPSHOT on the database, reads take no shared
+// locks at all.) A READ_WRITE service runs with autocommit off; group its
+// writes with a UnitOfWork so they share a single commit.
+class DatabaseService {
+public:
+    enum AccessMode {
+        READ_WRITE,
+        READ_ONLY
+    };
+
+    // Groups the writes made through a READ_WRITE service into one
+    // transaction. Rolls back on destruction unless commit() was called.
+    class UnitOfWork {
+    public:
+        explicit UnitOfWork(DatabaseService& db);
+        ~UnitOfWork();
+
+        UnitOfWork(const UnitOfWork&) = delete;
+        UnitOfWork& operator=(const UnitOfWork&) = delete;
+
+        // Throws Poco::IOException if the commit fails.
+        void commit();
+
+    private:
+        DatabaseService& _db;
+        bool _done;
+    };
+
+    // Connects to the default SQL Server database.
+    DatabaseService();
+    explicit DatabaseService(const std::string& connectionString, AccessMode mode = READ_WRITE);
+
+    // Uses an already open session, typically from a SessionPool; it goes
+    // back to the pool on disconnect().
+    DatabaseService(const Poco::Data::Session& session, AccessMode mode);
+
+    DatabaseService(DatabaseService&& other);
+    ~DatabaseService();
+
+    // Connects to the database
+    bool connect();
+    bool isConnected() const;
+
+    // Limits each statement prepared from now on to the given time; the
+    // driver cancels a statement that runs longer. ODBC counts whole
+    // seconds and takes 0 as no limit, so the time is rounded up and is
+    // never less than one second: a query may run up to a second past the
+    // deadline it was given.
+    void setQueryTimeout(std::chrono::milliseconds timeout);
+
+    // No-ops returning true for a READ_ONLY service: there is never an
+    // open transaction to end.
+    bool BeginTransaction();
+    bool CommitTransaction();
+    bool RollbackTransaction();
+
+    // Fetches the full name for a given first name; empty if not found.
+    std::string getFullName(const std::string& firstName);
+
+    // Full names for many first names at once, keyed and built from the
+    // names exactly as given, like getFullName; names that are not found
+    // are absent from the result.
+    std::map<std::string, std::string> getFullNames(const std::vector<std::string>& firstNames);
+
+    // Returns the [dbo].[USER] rows changed since the given ROW_VERSION
+    // (every row for 0), oldest change first. Rows at or above
+    // MIN_ACTIVE_ROWVERSION() are left for the next call: a transaction
+    // still open may commit a lower version than one already visible. The
+    // version to pass next time is stored in pWatermark if given.
+    std::vector<NameRow> loadNames(Poco::Int64 sinceVersion, Poco::Int64* pWatermark = nullptr);
+
+    // Returns every distinct USER_FNAME.
+    std::vector<std::string> loadFirstNames();
+
+    // Receives one fetched batch of USER rows: the first rows entries of
+    // firstNames and lastNames.
+    typedef std::function<void(const std::vector<std::string>& firstNames,
+                               const std::vector<std::string>& lastNames,
+                               std::size_t rows)> RowBatchHandler;
+
+    // Streams the USER rows with the given first name (every row if it is
+    // empty) to onBatch, rowsPerFetch at a time. Rows are fetched as ODBC
+    // row arrays into the same buffers each time, so memory use does not
+    // grow with the result.
+    void exportUsers(const std::string& firstName, std::size_t rowsPerFetch, const RowBatchHandler& onBatch);
+
+    // Up to pageSize USER rows in key order (first name, last name, row
+    // version; names compared as binary, like keyBefore()), starting
+    // after the given key, or at the beginning without one. Keyset
+    // paging: a page deep into the table costs an index seek, the same as
+    // the first page, where OFFSET would read and discard all the rows
+    // before it. One statement per call, as ShardRouter hands each page a
+    // fresh service over a pooled session.
+    std::vector<NameRow> listUsers(const NameRow* pAfter, std::size_t pageSize);
+
+    // Inserts the records (compact JSON) in one statement, binding them as
+    // an ODBC parameter array. Does not commit; run it in a UnitOfWork.
+    void insertRecords(std::vector<std::string>& records);
+
+    // Inserts one record. Does not commit; run it in a UnitOfWork.
+    void insertRecord(const std::string& record);
+
+    // Disconnects from the database
+    void disconnect();
+
+    const std::string& errorMessage() const { return _errorMessage; }
+
+    AccessMode accessMode() const { return _mode; }
+
+    // Statements, commits and rollbacks sent to the server so far.
+    std::uint64_t roundTrips() const { return _roundTrips; }
+
+    static const std::string& defaultConnectionString();
+
+private:
+    std::size_t execute(Poco::Data::Statement& statement);
+    void countRoundTrip();
+
+    std::string _connectionString;
+    AccessMode _mode;
+    bool _pooled;
+    std::uint64_t _roundTrips;
+    std::unique_ptr<Poco::Data::Session> _session;
+    std::string _errorMessage;
+};
@@ -0,0 +1,31 @@
+#include "Deadline.hpp"
+#include <Poco/Exception.h>
+#include <Poco/NumberParser.h>
+#include <algorithm>
+
+const std::string Deadline::HEADER = "X-Deadline-Ms";
+
+// --- Deadline implementation ---
+Deadline::Deadline(std::chrono::milliseconds budget)
+    : _expiry(Clock::now() + budget) {
+}
+
+Deadline Deadline::fromRequest(const Poco::Net::HTTPRequest& request, const DeadlinePolicy& policy) {
+    std::chrono::milliseconds budget = policy.defaultBudget;
+    int headerMs = 0;
+    if (request.has(HEADER) && Poco::NumberParser::tryParse(request.get(HEADER), headerMs) && headerMs >= 0) {
+        budget = std::chrono::milliseconds(headerMs);
+    }
+    return Deadline(std::min(budget, policy.maxBudget));
+}
+
+std::chrono::milliseconds Deadline::remaining() const {
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(_expiry - Clock::now());
+    return std::max(left, std::chrono::milliseconds(0));
+}
+
+void Deadline::check(const char* stage) const {
+    if (expired()) {
+        throw Poco::TimeoutException("Deadline exceeded before " + std::string(stage));
+    }
+}
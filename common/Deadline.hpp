@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Poco/Net/HTTPRequest.h>
+#include <chrono>
+#include <string>
+
+// Server-side deadline settings.
+struct DeadlinePolicy {
+    std::chrono::milliseconds defaultBudget;    // when the client states none
+    std::chrono::milliseconds maxBudget;        // cap on what a client may ask for
+};
+
+// The time left to answer a request, fixed when the request arrives.
+//
+// The client may state its own budget in the X-Deadline-Ms header (the
+// milliseconds it is still prepared to wait); otherwise the server's
+// default applies. Each stage of the request checks the deadline before
+// starting, so work stops as soon as nobody is waiting for the answer,
+// and blocking calls are bounded by remaining().
+class Deadline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static const std::string HEADER;
+
+    explicit Deadline(std::chrono::milliseconds budget);
+
+    // Budget from the request's header if it has a valid one, else the
+    // default; never more than maxBudget.
+    static Deadline fromRequest(const Poco::Net::HTTPRequest& request, const DeadlinePolicy& policy);
+
+    bool expired() const { return Clock::now() >= _expiry; }
+    Clock::time_point expiresAt() const { return _expiry; }
+
+    // Zero once expired.
+    std::chrono::milliseconds remaining() const;
+
+    // Throws Poco::TimeoutException naming the stage if expired.
+    void check(const char* stage) const;
+
+private:
+    Clock::time_point _expiry;
+};
@@ -0,0 +1,272 @@
+#include "Logger.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+// How often the drain thread wakes when nobody asks it to flush
+const std::chrono::milliseconds DRAIN_INTERVAL(10);
+
+const char* const LEVEL_NAMES[] = { "trace", "debug", "info", "warning", "error" };
+
+void appendTime(std::string& out, std::int64_t ticks) {
+    using namespace std::chrono;
+    const system_clock::time_point time{ system_clock::duration(ticks) };
+    const std::time_t seconds = system_clock::to_time_t(time);
+    const long long millis = duration_cast<milliseconds>(time.time_since_epoch()).count() % 1000;
+    std::tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    char buffer[32];
+    const std::size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &utc);
+    out.append(buffer, length);
+    std::snprintf(buffer, sizeof(buffer), ".%03lldZ", millis);
+    out.append(buffer);
+}
+
+// Quoted logfmt value
+void appendQuoted(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            default:   out += c; break;
+        }
+    }
+    out += '"';
+}
+
+}
+
+// --- ArgWriter implementation ---
+bool Logger::ArgWriter::reserve(std::size_t length) {
+    if (_pos + length > sizeof(_slot.args)) {
+        _slot.truncated = true;
+        return false;
+    }
+    return true;
+}
+
+void Logger::ArgWriter::putText(const char* data, std::size_t length) {
+    const std::size_t header = 1 + sizeof(std::uint16_t);
+    if (!reserve(header + 1)) {
+        return;
+    }
+    if (_pos + header + length > sizeof(_slot.args)) {
+        length = sizeof(_slot.args) - _pos - header;
+        _slot.truncated = true;
+    }
+    const std::uint16_t size = static_cast<std::uint16_t>(length);
+    _slot.args[_pos++] = ARG_TEXT;
+    std::memcpy(_slot.args + _pos, &size, sizeof(size));
+    _pos += sizeof(size);
+    std::memcpy(_slot.args + _pos, data, length);
+    _pos += length;
+}
+
+// --- Logger implementation ---
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : _level(static_cast<int>(LogLevel::Info)),
+      _nextThread(0),
+      _flushRequested(0),
+      _flushDone(0),
+      _stopping(false),
+      _records(MetricsRegistry::instance().counter("log_records_total", "Log records written")),
+      _dropped(MetricsRegistry::instance().counter("log_dropped_total", "Log records dropped because a ring was full")) {
+    static_assert(sizeof(Slot) == SLOT_SIZE, "Slot layout");
+    _drainer = std::thread([this] { run(); });
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    _drainer.join();
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& level) {
+    for (std::size_t i = 0; i < sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]); ++i) {
+        if (name == LEVEL_NAMES[i]) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    const std::uint64_t ticket = ++_flushRequested;
+    _wake.notify_one();
+    _flushed.wait(lock, [this, ticket] { return _flushDone >= ticket || _stopping; });
+}
+
+Logger::Ring& Logger::threadRing() {
+    // Marks the ring retired when its thread exits; the drain thread
+    // releases it once it is empty
+    struct Holder {
+        std::shared_ptr<Ring> ring;
+        ~Holder() {
+            if (ring) {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Holder holder;
+    if (!holder.ring) {
+        auto ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(_mutex);
+        ring->thread = ++_nextThread;
+        _rings.push_back(ring);
+        holder.ring = ring;
+    }
+    return *holder.ring;
+}
+
+void Logger::run() {
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::vector<std::pair<std::int64_t, std::string>> lines;
+    std::string batch;
+    for (;;) {
+        std::uint64_t requested = 0;
+        bool stopping = false;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait_for(lock, DRAIN_INTERVAL, [this] { return _stopping || _flushRequested > _flushDone; });
+            requested = _flushRequested;
+            stopping = _stopping;
+            rings = _rings;
+        }
+
+        lines.clear();
+        for (const auto& ring : rings) {
+            drain(*ring, lines);
+        }
+        if (!lines.empty()) {
+            // Rings are drained one after another; put their records back
+            // in time order
+            std::stable_sort(lines.begin(), lines.end(),
+                             [](const auto& a, const auto& b) { return a.first < b.first; });
+            batch.clear();
+            for (const auto& line : lines) {
+                batch += line.second;
+            }
+            std::fwrite(batch.data(), 1, batch.size(), stderr);
+            std::fflush(stderr);
+            _records.inc(lines.size());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _flushDone = requested;
+            _rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](const std::shared_ptr<Ring>& ring) {
+                return ring->retired.load(std::memory_order_acquire)
+                    && ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+            }), _rings.end());
+        }
+        _flushed.notify_all();
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void Logger::drain(Ring& ring, std::vector<std::pair<std::int64_t, std::string>>& lines) {
+    std::size_t tail = ring.tail.load(std::memory_order_relaxed);
+    const std::size_t head = ring.head.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+        const Slot& slot = ring.slots[tail % RING_SLOTS];
+        std::string line;
+        format(slot, ring.thread, line);
+        lines.emplace_back(slot.time, std::move(line));
+    }
+    ring.tail.store(tail, std::memory_order_release);
+
+    const std::uint64_t dropped = ring.dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        _dropped.inc(dropped);
+        std::string line;
+        line += "ts=";
+        appendTime(line, std::chrono::system_clock::now().time_since_epoch().count());
+        line += " level=warning thread=" + std::to_string(ring.thread);
+        line += " msg=\"log ring full\" dropped=" + std::to_string(dropped) + "\n";
+        lines.emplace_back(std::chrono::system_clock::now().time_since_epoch().count(), std::move(line));
+    }
+}
+
+void Logger::format(const Slot& slot, unsigned thread, std::string& line) {
+    line += "ts=";
+    appendTime(line, slot.time);
+    line += " level=";
+    line += LEVEL_NAMES[static_cast<int>(slot.level)];
+    line += " thread=" + std::to_string(thread);
+    line += " msg=";
+
+    // Replace each {} with the next argument
+    std::string message;
+    std::size_t pos = 0;
+    const char* p = slot.format;
+    while (*p) {
+        if (p[0] == '{' && p[1] == '}' && pos < slot.size) {
+            const unsigned char type = static_cast<unsigned char>(slot.args[pos++]);
+            switch (type) {
+                case ARG_INT: {
+                    std::int64_t v;
+                    std::memcpy(&v, slot.args + pos, sizeof(v));
+                    pos += sizeof(v);
+                    message += std::to_string(v);
+                    break;
+                }
+                case ARG_UINT: {
+                    std::uint64_t v;
+                    std::memcpy(&v, slot.args + pos, sizeof(v));
+                    pos += sizeof(v);
+                    message += std::to_string(v);
+                    break;
+                }
+                case ARG_DOUBLE: {
+                    double v;
+                    std::memcpy(&v, slot.args + pos, sizeof(v));
+                    pos += sizeof(v);
+                    char buffer[32];
+                    std::snprintf(buffer, sizeof(buffer), "%g", v);
+                    message += buffer;
+                    break;
+                }
+                case ARG_BOOL:
+                    message += slot.args[pos++] ? "true" : "false";
+                    break;
+                case ARG_TEXT: {
+                    std::uint16_t length;
+                    std::memcpy(&length, slot.args + pos, sizeof(length));
+                    pos += sizeof(length);
+                    message.append(slot.args + pos, length);
+                    pos += length;
+                    break;
+                }
+            }
+            p += 2;
+        } else {
+            message += *p++;
+        }
+    }
+    if (slot.truncated) {
+        message += "...";
+    }
+    appendQuoted(line, message);
+    line += '\n';
+}
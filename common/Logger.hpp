@@ -0,0 +1,210 @@
+#pragma once
+
+#include "Metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Levels below this are compiled out of logTrace() etc.: 0 keeps
+// everything, 1 drops Trace, ... 4 keeps only Error.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+enum class LogLevel { Trace, Debug, Info, Warning, Error };
+
+// Asynchronous structured logger.
+//
+// A log call copies its format string pointer and its arguments, in
+// binary, into a ring buffer owned by the calling thread and returns:
+// there is no lock, no formatting and no I/O on the caller's thread. A
+// background thread drains the rings every few milliseconds, formats the
+// records and writes them to stderr as logfmt lines:
+//
+//   ts=2026-01-02T03:04:05.678Z level=error thread=3 msg="..."
+//
+// When a thread's ring is full its records are dropped rather than
+// blocking; the drops are counted in log_dropped_total and reported in
+// the log. The format must be a string literal; each {} in it is replaced
+// by the next argument (integers, floating point, bool and text).
+class Logger {
+public:
+    static Logger& instance();
+
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Records below the level are discarded at the call site.
+    void setLevel(LogLevel level) { _level.store(static_cast<int>(level), std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= _level.load(std::memory_order_relaxed);
+    }
+
+    // "trace", "debug", "info", "warning" or "error".
+    static bool parseLevel(const std::string& name, LogLevel& level);
+
+    template <typename... Args>
+    void write(LogLevel level, const char* format, const Args&... args);
+
+    // Blocks until every record logged before the call has been written.
+    void flush();
+
+private:
+    // A record with its arguments fits in one slot; longer text is cut
+    static const std::size_t SLOT_SIZE = 256;
+    static const std::size_t RING_SLOTS = 512;
+
+    enum ArgType : unsigned char { ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_BOOL, ARG_TEXT };
+
+    struct Slot {
+        std::int64_t time;          // system_clock ticks
+        const char* format;
+        LogLevel level;
+        std::uint16_t size;         // bytes of args used
+        bool truncated;
+        char args[SLOT_SIZE - sizeof(std::int64_t) - sizeof(const char*) - 8];
+    };
+
+    // Single producer (its thread), single consumer (the drain thread).
+    struct Ring {
+        Slot slots[RING_SLOTS];
+        std::atomic<std::size_t> head{0};   // next slot to fill
+        std::atomic<std::size_t> tail{0};   // next slot to drain
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<bool> retired{false};   // its thread has exited
+        unsigned thread = 0;
+    };
+
+    class ArgWriter {
+    public:
+        explicit ArgWriter(Slot& slot) : _slot(slot), _pos(0) {}
+
+        template <typename T>
+        void put(const T& value);
+        void putText(const char* data, std::size_t length);
+        void finish() { _slot.size = static_cast<std::uint16_t>(_pos); }
+
+    private:
+        bool reserve(std::size_t length);
+
+        Slot& _slot;
+        std::size_t _pos;
+    };
+
+    Logger();
+
+    Ring& threadRing();
+    void run();
+    void drain(Ring& ring, std::vector<std::pair<std::int64_t, std::string>>& lines);
+    static void format(const Slot& slot, unsigned thread, std::string& line);
+
+    std::atomic<int> _level;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _flushed;
+    std::vector<std::shared_ptr<Ring>> _rings;
+    unsigned _nextThread;
+    std::uint64_t _flushRequested;
+    std::uint64_t _flushDone;
+    bool _stopping;
+
+    Counter& _records;
+    Counter& _dropped;
+    std::thread _drainer;
+};
+
+// --- Logger template implementation ---
+template <typename T>
+void Logger::ArgWriter::put(const T& value) {
+    using V = std::decay_t<T>;
+    if constexpr (std::is_same_v<V, bool>) {
+        if (reserve(2)) {
+            _slot.args[_pos++] = ARG_BOOL;
+            _slot.args[_pos++] = value ? 1 : 0;
+        }
+    } else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>) {
+        const std::int64_t v = value;
+        if (reserve(1 + sizeof(v))) {
+            _slot.args[_pos++] = ARG_INT;
+            std::memcpy(_slot.args + _pos, &v, sizeof(v));
+            _pos += sizeof(v);
+        }
+    } else if constexpr (std::is_integral_v<V>) {
+        const std::uint64_t v = value;
+        if (reserve(1 + sizeof(v))) {
+            _slot.args[_pos++] = ARG_UINT;
+            std::memcpy(_slot.args + _pos, &v, sizeof(v));
+            _pos += sizeof(v);
+        }
+    } else if constexpr (std::is_floating_point_v<V>) {
+        const double v = value;
+        if (reserve(1 + sizeof(v))) {
+            _slot.args[_pos++] = ARG_DOUBLE;
+            std::memcpy(_slot.args + _pos, &v, sizeof(v));
+            _pos += sizeof(v);
+        }
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        const std::string_view text(value);
+        putText(text.data(), text.size());
+    } else {
+        static_assert(std::is_convertible_v<const T&, std::string_view>, "Unsupported log argument type");
+    }
+}
+
+template <typename... Args>
+void Logger::write(LogLevel level, const char* format, const Args&... args) {
+    if (!enabled(level)) {
+        return;
+    }
+    Ring& ring = threadRing();
+    const std::size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) == RING_SLOTS) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Slot& slot = ring.slots[head % RING_SLOTS];
+    slot.time = std::chrono::system_clock::now().time_since_epoch().count();
+    slot.format = format;
+    slot.level = level;
+    slot.truncated = false;
+    ArgWriter writer(slot);
+    (writer.put(args), ...);
+    writer.finish();
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+template <LogLevel Level, typename... Args>
+void logAt(const char* format, const Args&... args) {
+    if constexpr (static_cast<int>(Level) >= LOG_MIN_LEVEL) {
+        Logger::instance().write(Level, format, args...);
+    }
+}
+
+template <typename... Args>
+void logTrace(const char* format, const Args&... args) { logAt<LogLevel::Trace>(format, args...); }
+
+template <typename... Args>
+void logDebug(const char* format, const Args&... args) { logAt<LogLevel::Debug>(format, args...); }
+
+template <typename... Args>
+void logInfo(const char* format, const Args&... args) { logAt<LogLevel::Info>(format, args...); }
+
+template <typename... Args>
+void logWarning(const char* format, const Args&... args) { logAt<LogLevel::Warning>(format, args...); }
+
+template <typename... Args>
+void logError(const char* format, const Args&... args) { logAt<LogLevel::Error>(format, args...); }
@@ -0,0 +1,111 @@
+#include "LookupBatcher.hpp"
+#include "ShardRouter.hpp"
+#include <Poco/Exception.h>
+#include <algorithm>
+
+namespace {
+
+// EWMA weight of each new inter-arrival time
+const double ARRIVAL_ALPHA = 0.05;
+
+// How many more lookups a batch should wait for
+const double WINDOW_LOOKUPS = 8.0;
+
+const std::vector<double>& batchSizeBuckets() {
+    static const std::vector<double> buckets = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024 };
+    return buckets;
+}
+
+}
+
+// --- LookupBatcher implementation ---
+LookupBatcher::LookupBatcher(ShardRouter& router, std::size_t maxBatch, std::chrono::microseconds maxWindow)
+    : _router(router),
+      _maxBatch(maxBatch),
+      _maxWindow(maxWindow),
+      _lastArrival(Deadline::Clock::now()),
+      _interArrivalUs(static_cast<double>(maxWindow.count())),
+      _windowUs(0),
+      _batchSize(MetricsRegistry::instance().histogram("lookup_batch_size", "Names per batched lookup query", batchSizeBuckets())),
+      _windowGauge(MetricsRegistry::instance().gauge("lookup_batch_window_us", "Current lookup batching window")) {
+}
+
+std::chrono::microseconds LookupBatcher::window() const {
+    return std::chrono::microseconds(_windowUs.load(std::memory_order_relaxed));
+}
+
+std::string LookupBatcher::getFullName(const std::string& firstName, const Deadline& deadline) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    noteArrival(Deadline::Clock::now());
+
+    std::shared_ptr<Batch> batch = _open;
+    const bool leader = !batch;
+    if (leader) {
+        batch = std::make_shared<Batch>();
+        batch->latestDeadline = deadline.expiresAt();
+        _open = batch;
+    }
+    batch->names.insert(firstName);
+    batch->latestDeadline = std::max(batch->latestDeadline, deadline.expiresAt());
+    if (batch->names.size() >= _maxBatch) {
+        batch->sealed = true;
+        _open.reset();
+        batch->changed.notify_all();
+    }
+
+    if (leader) {
+        batch->changed.wait_for(lock, window(), [&batch] { return batch->sealed; });
+        if (!batch->sealed) {
+            batch->sealed = true;
+            _open.reset();
+        }
+        lock.unlock();
+        run(batch);
+        lock.lock();
+    } else if (!batch->changed.wait_until(lock, deadline.expiresAt(), [&batch] { return batch->done; })) {
+        // The batch carries on for the others
+        throw Poco::TimeoutException("Deadline exceeded waiting for a batched lookup");
+    }
+
+    if (batch->error) {
+        std::rethrow_exception(batch->error);
+    }
+    auto it = batch->fullNames.find(firstName);
+    return it != batch->fullNames.end() ? it->second : std::string();
+}
+
+void LookupBatcher::noteArrival(Deadline::Clock::time_point now) {
+    const double gapUs = std::chrono::duration<double, std::micro>(now - _lastArrival).count();
+    _lastArrival = now;
+    _interArrivalUs += ARRIVAL_ALPHA * (gapUs - _interArrivalUs);
+
+    // Not worth waiting if even the next lookup would not arrive in time
+    const double maxUs = static_cast<double>(_maxWindow.count());
+    const long long us = _interArrivalUs >= maxUs
+        ? 0 : static_cast<long long>(std::min(_interArrivalUs * WINDOW_LOOKUPS, maxUs));
+    _windowUs.store(us, std::memory_order_relaxed);
+    _windowGauge.set(us);
+}
+
+void LookupBatcher::run(const std::shared_ptr<Batch>& batch) {
+    // Sealed: no one else touches names or latestDeadline now
+    const std::vector<std::string> names(batch->names.begin(), batch->names.end());
+    _batchSize.observe(static_cast<double>(names.size()));
+
+    // Bounded by the most patient caller; the others stop waiting sooner
+    const Deadline deadline(std::chrono::duration_cast<std::chrono::milliseconds>(
+        batch->latestDeadline - Deadline::Clock::now()));
+    std::map<std::string, std::string> fullNames;
+    std::exception_ptr error;
+    try {
+        fullNames = _router.getFullNames(names, &deadline);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    batch->fullNames = std::move(fullNames);
+    batch->error = error;
+    batch->done = true;
+    batch->changed.notify_all();
+}
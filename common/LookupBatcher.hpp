@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Deadline.hpp"
+#include "Metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class ShardRouter;
+
+// Merges concurrent single-name lookups into IN queries.
+//
+// The first caller to arrive opens a batch and leads it: it waits for the
+// batch window, or until the batch is full, then runs one
+// ShardRouter::getFullNames() for every name collected and hands each
+// waiting caller its answer. Callers arriving meanwhile join the next
+// batch, so while a batch runs the next one fills up by itself, as in a
+// group commit.
+//
+// The window adapts to load: it is about the time the next few lookups
+// take to arrive, given the recent arrival rate, and never more than
+// maxWindow. When lookups are too sparse to be worth waiting for, the
+// window is zero and a lone lookup goes out at once.
+class LookupBatcher {
+public:
+    LookupBatcher(ShardRouter& router, std::size_t maxBatch = 256,
+                  std::chrono::microseconds maxWindow = std::chrono::microseconds(2000));
+
+    LookupBatcher(const LookupBatcher&) = delete;
+    LookupBatcher& operator=(const LookupBatcher&) = delete;
+
+    // The full name for firstName, empty if not found. Throws what the
+    // batch query threw, or Poco::TimeoutException if the deadline passes
+    // first.
+    std::string getFullName(const std::string& firstName, const Deadline& deadline);
+
+    std::chrono::microseconds window() const;
+
+private:
+    struct Batch {
+        std::set<std::string> names;
+        Deadline::Clock::time_point latestDeadline;
+        std::map<std::string, std::string> fullNames;
+        std::exception_ptr error;
+        bool sealed = false;
+        bool done = false;
+        std::condition_variable changed;
+    };
+
+    void noteArrival(Deadline::Clock::time_point now);
+    void run(const std::shared_ptr<Batch>& batch);
+
+    ShardRouter& _router;
+    const std::size_t _maxBatch;
+    const std::chrono::microseconds _maxWindow;
+
+    std::mutex _mutex;
+    std::shared_ptr<Batch> _open;
+    Deadline::Clock::time_point _lastArrival;
+    double _interArrivalUs;        // EWMA
+    std::atomic<long long> _windowUs;
+
+    Histogram& _batchSize;
+    Gauge& _windowGauge;
+};
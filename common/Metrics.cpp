@@ -0,0 +1,95 @@
+#include "Metrics.hpp"
+
+// --- Histogram implementation ---
+Histogram::Histogram(std::vector<double> bounds)
+    : _bounds(std::move(bounds)),
+      _counts(new std::atomic<std::uint64_t>[_bounds.size() + 1]) {
+    for (std::size_t i = 0; i <= _bounds.size(); ++i) {
+        _counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observe(double v) {
+    std::size_t i = 0;
+    while (i < _bounds.size() && v > _bounds[i]) {
+        ++i;
+    }
+    _counts[i].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+
+    double sum = _sum.load(std::memory_order_relaxed);
+    while (!_sum.compare_exchange_weak(sum, sum + v, std::memory_order_relaxed)) {
+    }
+}
+
+// --- MetricsRegistry implementation ---
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& entry = _counters[name];
+    if (!entry.metric) {
+        entry.help = help;
+        entry.metric.reset(new Counter);
+    }
+    return *entry.metric;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& entry = _gauges[name];
+    if (!entry.metric) {
+        entry.help = help;
+        entry.metric.reset(new Gauge);
+    }
+    return *entry.metric;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      const std::vector<double>& bounds) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& entry = _histograms[name];
+    if (!entry.metric) {
+        entry.help = help;
+        entry.metric.reset(new Histogram(bounds));
+    }
+    return *entry.metric;
+}
+
+void MetricsRegistry::write(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& c : _counters) {
+        out << "# HELP " << c.first << ' ' << c.second.help << '\n'
+            << "# TYPE " << c.first << " counter\n"
+            << c.first << ' ' << c.second.metric->value() << '\n';
+    }
+    for (const auto& g : _gauges) {
+        out << "# HELP " << g.first << ' ' << g.second.help << '\n'
+            << "# TYPE " << g.first << " gauge\n"
+            << g.first << ' ' << g.second.metric->value() << '\n';
+    }
+    for (const auto& h : _histograms) {
+        const Histogram& hist = *h.second.metric;
+        out << "# HELP " << h.first << ' ' << h.second.help << '\n'
+            << "# TYPE " << h.first << " histogram\n";
+        std::uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < hist.bounds().size(); ++i) {
+            cumulative += hist.bucketCount(i);
+            out << h.first << "_bucket{le=\"" << hist.bounds()[i] << "\"} " << cumulative << '\n';
+        }
+        cumulative += hist.bucketCount(hist.bounds().size());
+        out << h.first << "_bucket{le=\"+Inf\"} " << cumulative << '\n'
+            << h.first << "_sum " << hist.sum() << '\n'
+            << h.first << "_count " << hist.count() << '\n';
+    }
+}
+
+const std::vector<double>& latencyBucketsMs() {
+    static const std::vector<double> buckets = {
+        0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000
+    };
+    return buckets;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Process-wide counters, gauges and histograms, rendered in the Prometheus
+// text format by MetricsHandler. Metrics are created once and never
+// removed, so the references handed out stay valid for the process
+// lifetime and updating them is a single atomic operation.
+
+class Counter {
+public:
+    void inc(std::uint64_t n = 1) { _value.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> _value{0};
+};
+
+class Gauge {
+public:
+    void set(std::int64_t v) { _value.store(v, std::memory_order_relaxed); }
+    void add(std::int64_t n) { _value.fetch_add(n, std::memory_order_relaxed); }
+    std::int64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> _value{0};
+};
+
+class Histogram {
+public:
+    // bounds are the inclusive upper bounds of each bucket, ascending.
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double v);
+
+    const std::vector<double>& bounds() const { return _bounds; }
+    std::uint64_t bucketCount(std::size_t i) const { return _counts[i].load(std::memory_order_relaxed); }
+    std::uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+    double sum() const { return _sum.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<double> _bounds;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> _counts;
+    std::atomic<std::uint64_t> _count{0};
+    std::atomic<double> _sum{0.0};
+};
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // Returns the metric with the given name, creating it on first use.
+    Counter& counter(const std::string& name, const std::string& help);
+    Gauge& gauge(const std::string& name, const std::string& help);
+    Histogram& histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds);
+
+    void write(std::ostream& out) const;
+
+private:
+    template <typename T>
+    struct Entry {
+        std::string help;
+        std::unique_ptr<T> metric;
+    };
+
+    mutable std::mutex _mutex;
+    std::map<std::string, Entry<Counter>> _counters;
+    std::map<std::string, Entry<Gauge>> _gauges;
+    std::map<std::string, Entry<Histogram>> _histograms;
+};
+
+// Bucket bounds in milliseconds suitable for request and query latencies.
+const std::vector<double>& latencyBucketsMs();
@@ -0,0 +1,14 @@
+#include "MetricsHandler.hpp"
+#include "Metrics.hpp"
+#include <sstream>
+
+void MetricsHandler::handleRequest(Poco::Net::HTTPServerRequest&, Poco::Net::HTTPServerResponse& response) {
+    std::ostringstream oss;
+    MetricsRegistry::instance().write(oss);
+    const std::string body = oss.str();
+
+    response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+    response.setContentType("text/plain; version=0.0.4");
+    response.setContentLength(body.length());
+    response.send() << body;
+}
@@ -0,0 +1,130 @@
+#include "NameFilter.hpp"
+#include "Logger.hpp"
+#include "NameKey.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string_view>
+
+namespace {
+
+// Second, independent hash derived from the first (splitmix64 finalizer).
+std::uint64_t mix(std::uint64_t h) {
+    h += 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+}
+
+// --- NameFilter::Bloom implementation ---
+NameFilter::Bloom::Bloom(const std::vector<std::string>& keys, double bitsPerKey)
+    : _keys(keys.size()) {
+    const std::uint64_t words = std::max<std::uint64_t>(1,
+        static_cast<std::uint64_t>(std::ceil(keys.size() * bitsPerKey / 64.0)));
+    _bits.assign(static_cast<std::size_t>(words), 0);
+    _bitCount = words * 64;
+    // k = ln 2 * m / n minimises the false-positive rate
+    _hashes = static_cast<unsigned>(std::min(16.0, std::max(1.0, std::round(bitsPerKey * 0.6931))));
+
+    std::string normalized;
+    for (const auto& key : keys) {
+        nameKey(key, normalized);
+        const std::uint64_t h1 = std::hash<std::string_view>()(normalized);
+        const std::uint64_t h2 = mix(h1) | 1;
+        for (unsigned i = 0; i < _hashes; ++i) {
+            const std::uint64_t bit = (h1 + i * h2) % _bitCount;
+            _bits[bit >> 6] |= std::uint64_t(1) << (bit & 63);
+        }
+    }
+}
+
+bool NameFilter::Bloom::mightContain(std::string_view key) const {
+    // Kept per thread so a probe does not allocate once it has grown
+    thread_local std::string normalized;
+    nameKey(key, normalized);
+    const std::uint64_t h1 = std::hash<std::string_view>()(normalized);
+    const std::uint64_t h2 = mix(h1) | 1;
+    for (unsigned i = 0; i < _hashes; ++i) {
+        const std::uint64_t bit = (h1 + i * h2) % _bitCount;
+        if ((_bits[bit >> 6] & (std::uint64_t(1) << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double NameFilter::Bloom::expectedFalsePositiveRate() const {
+    return std::pow(1.0 - std::exp(-static_cast<double>(_hashes) * _keys / _bitCount), _hashes);
+}
+
+// --- NameFilter implementation ---
+NameFilter::NameFilter(ShardRouter& router,
+                       std::chrono::seconds refreshInterval,
+                       double bitsPerKey)
+    : _router(router),
+      _refreshInterval(refreshInterval),
+      _bitsPerKey(bitsPerKey),
+      _stopping(false),
+      _entries(MetricsRegistry::instance().gauge("name_filter_entries", "Names in the Bloom filter")),
+      _bytes(MetricsRegistry::instance().gauge("name_filter_bytes", "Memory used by the Bloom filter's bit array")),
+      _expectedFpPpm(MetricsRegistry::instance().gauge("name_filter_expected_false_positive_ppm", "Expected Bloom filter false-positive rate, per million lookups")),
+      _definiteMisses(MetricsRegistry::instance().counter("name_filter_definite_misses_total", "Lookups answered as not found by the Bloom filter")),
+      _falsePositives(MetricsRegistry::instance().counter("name_filter_false_positives_total", "Names passed by the Bloom filter but not found in the database")),
+      _refreshErrors(MetricsRegistry::instance().counter("name_filter_refresh_errors_total", "Failed Bloom filter rebuilds")) {
+}
+
+NameFilter::~NameFilter() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    if (_refresher.joinable()) {
+        _refresher.join();
+    }
+}
+
+void NameFilter::start() {
+    rebuild();
+    _refresher = std::thread(&NameFilter::refreshLoop, this);
+}
+
+bool NameFilter::mightContain(std::string_view firstName) const {
+    const std::shared_ptr<const Bloom> bloom = std::atomic_load(&_bloom);
+    if (bloom && !bloom->mightContain(firstName)) {
+        _definiteMisses.inc();
+        return false;
+    }
+    return true;
+}
+
+void NameFilter::refreshLoop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_wake.wait_for(lock, _refreshInterval, [&] { return _stopping; })) {
+                return;
+            }
+        }
+        try {
+            rebuild();
+        } catch (const std::exception& ex) {
+            // Keep the last good filter and try again next interval
+            _refreshErrors.inc();
+            logError("Name filter rebuild failed: {}", ex.what());
+        }
+    }
+}
+
+void NameFilter::rebuild() {
+    const std::vector<std::string> names = _router.loadFirstNames();
+
+    std::shared_ptr<const Bloom> next = std::make_shared<const Bloom>(names, _bitsPerKey);
+    std::atomic_store(&_bloom, next);
+
+    _entries.set(static_cast<std::int64_t>(next->keys()));
+    _bytes.set(static_cast<std::int64_t>(next->bytes()));
+    _expectedFpPpm.set(static_cast<std::int64_t>(next->expectedFalsePositiveRate() * 1e6));
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "DatabaseService.hpp"
+#include "Metrics.hpp"
+#include "ShardRouter.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Bloom filter over every USER_FNAME, checked before the database so that
+// names which are certainly not in [dbo].[USER] are answered without a
+// round trip.
+//
+// The filter is rebuilt from every shard every refresh interval on a
+// background thread and swapped in atomically. A name added after the
+// last rebuild reads as a definite miss until the next one, so the
+// interval bounds how stale a "not found" can be. The expected
+// false-positive rate and the filter's size are exported as metrics,
+// along with the false positives actually observed (names the filter let
+// through that the database then did not find).
+class NameFilter {
+public:
+    // Immutable Bloom filter using double hashing. Keys are hashed in
+    // their nameKey() form, so names the database treats as equal share
+    // their bits.
+    class Bloom {
+    public:
+        Bloom(const std::vector<std::string>& keys, double bitsPerKey);
+
+        bool mightContain(std::string_view key) const;
+
+        std::size_t keys() const { return _keys; }
+        std::size_t bytes() const { return _bits.size() * sizeof(std::uint64_t); }
+
+        // Probability that an absent key is reported present.
+        double expectedFalsePositiveRate() const;
+
+    private:
+        std::vector<std::uint64_t> _bits;
+        std::uint64_t _bitCount;
+        unsigned _hashes;
+        std::size_t _keys;
+    };
+
+    NameFilter(ShardRouter& router,
+               std::chrono::seconds refreshInterval,
+               double bitsPerKey = 10.0);
+    ~NameFilter();
+
+    NameFilter(const NameFilter&) = delete;
+    NameFilter& operator=(const NameFilter&) = delete;
+
+    // Builds the filter and starts the background rebuild. Throws if the
+    // first build fails.
+    void start();
+
+    // False only if firstName is certainly not in the table.
+    bool mightContain(std::string_view firstName) const;
+
+    // Called when a name the filter let through was not in the database.
+    void falsePositive() { _falsePositives.inc(); }
+
+private:
+    void refreshLoop();
+    void rebuild();
+
+    ShardRouter& _router;
+    const std::chrono::seconds _refreshInterval;
+    const double _bitsPerKey;
+    std::shared_ptr<const Bloom> _bloom;    // read and replaced atomically
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stopping;
+    std::thread _refresher;
+
+    Gauge& _entries;
+    Gauge& _bytes;
+    Gauge& _expectedFpPpm;
+    Counter& _definiteMisses;
+    Counter& _falsePositives;
+    Counter& _refreshErrors;
+};
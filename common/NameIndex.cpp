@@ -0,0 +1,152 @@
+#include "NameIndex.hpp"
+#include "Logger.hpp"
+#include "NameKey.hpp"
+#include <Poco/Exception.h>
+#include <functional>
+#include <string_view>
+
+namespace {
+
+const std::uint64_t USED_BIT = std::uint64_t(1) << 63;
+
+std::uint64_t slotHash(std::string_view key) {
+    return static_cast<std::uint64_t>(std::hash<std::string_view>()(key)) | USED_BIT;
+}
+
+}
+
+// --- NameIndex::Table implementation ---
+NameIndex::Table::Table(const std::unordered_map<std::string, std::string>& names)
+    : _size(names.size()) {
+    // Power of two, at most half full, so probe sequences stay short
+    std::size_t capacity = 16;
+    while (capacity < names.size() * 2) {
+        capacity *= 2;
+    }
+    _slots.assign(capacity, Slot{ 0, 0, 0, 0 });
+    _mask = capacity - 1;
+
+    std::size_t arenaSize = 0;
+    for (const auto& entry : names) {
+        arenaSize += entry.first.size() + entry.second.size();
+    }
+    if (arenaSize > UINT32_MAX) {
+        throw Poco::RangeException("Name index exceeds 4 GB");
+    }
+    _arena.reserve(arenaSize);
+
+    for (const auto& entry : names) {
+        const std::uint64_t hash = slotHash(entry.first);
+        std::size_t i = static_cast<std::size_t>(hash) & _mask;
+        while (_slots[i].hash != 0) {
+            i = (i + 1) & _mask;
+        }
+        _slots[i] = Slot{ hash,
+                          static_cast<std::uint32_t>(_arena.size()),
+                          static_cast<std::uint32_t>(entry.first.size()),
+                          static_cast<std::uint32_t>(entry.second.size()) };
+        _arena.append(entry.first);
+        _arena.append(entry.second);
+    }
+}
+
+NameIndex::Answer NameIndex::Table::find(std::string_view firstName, std::string& lastName) const {
+    // Kept per thread so a lookup does not allocate once it has grown
+    thread_local std::string key;
+    const bool exact = foldName(firstName, key);
+    const std::uint64_t hash = slotHash(key);
+    for (std::size_t i = static_cast<std::size_t>(hash) & _mask; _slots[i].hash != 0; i = (i + 1) & _mask) {
+        const Slot& slot = _slots[i];
+        if (slot.hash == hash
+            && slot.keyLength == key.size()
+            && _arena.compare(slot.offset, slot.keyLength, key) == 0) {
+            lastName.assign(_arena, slot.offset + slot.keyLength, slot.valueLength);
+            return FOUND;
+        }
+    }
+    return exact ? NOT_FOUND : UNSURE;
+}
+
+// --- NameIndex implementation ---
+NameIndex::NameIndex(ShardRouter& router,
+                     std::chrono::seconds refreshInterval,
+                     int fullReloadEvery)
+    : _router(router),
+      _refreshInterval(refreshInterval),
+      _fullReloadEvery(fullReloadEvery),
+      _stopping(false),
+      _entries(MetricsRegistry::instance().gauge("name_index_entries", "Names held by the in-memory name index")),
+      _refreshErrors(MetricsRegistry::instance().counter("name_index_refresh_errors_total", "Failed name index refreshes")),
+      _refreshLatency(MetricsRegistry::instance().histogram("name_index_refresh_ms", "Time taken by each name index refresh", latencyBucketsMs())) {
+}
+
+NameIndex::~NameIndex() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    if (_refresher.joinable()) {
+        _refresher.join();
+    }
+}
+
+void NameIndex::start() {
+    refresh(true);
+    _refresher = std::thread(&NameIndex::refreshLoop, this);
+}
+
+NameIndex::Answer NameIndex::lookup(std::string_view firstName, std::string& lastName) const {
+    const std::shared_ptr<const Table> current = table();
+    return current ? current->find(firstName, lastName) : UNSURE;
+}
+
+std::shared_ptr<const NameIndex::Table> NameIndex::table() const {
+    return std::atomic_load(&_table);
+}
+
+void NameIndex::refreshLoop() {
+    int refreshes = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_wake.wait_for(lock, _refreshInterval, [&] { return _stopping; })) {
+                return;
+            }
+        }
+        try {
+            refresh(++refreshes % _fullReloadEvery == 0);
+        } catch (const std::exception& ex) {
+            // Keep serving the last good table and try again next interval
+            _refreshErrors.inc();
+            logError("Name index refresh failed: {}", ex.what());
+        }
+    }
+}
+
+void NameIndex::refresh(bool full) {
+    const auto start = std::chrono::steady_clock::now();
+
+    if (full) {
+        _watermarks.clear();
+    }
+    std::vector<NameRow> rows = _router.loadNames(_watermarks);
+
+    if (full) {
+        _names.clear();
+    } else if (rows.empty()) {
+        return;
+    }
+    std::string key;
+    for (auto& row : rows) {
+        // Rows come oldest change first, so the newest version wins
+        foldName(row.firstName, key);
+        _names[key] = std::move(row.lastName);
+    }
+
+    std::shared_ptr<const Table> next = std::make_shared<const Table>(_names);
+    std::atomic_store(&_table, next);
+
+    _entries.set(static_cast<std::int64_t>(_names.size()));
+    _refreshLatency.observe(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "DatabaseService.hpp"
+#include "Metrics.hpp"
+#include "ShardRouter.hpp"
+#include <Poco/Types.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// In-memory copy of [dbo].[USER] (USER_FNAME -> USER_LNAME) that answers
+// GetName without touching the database.
+//
+// Lookups read an immutable Table: an open-addressing hash whose slots sit
+// in one array and whose strings sit in one arena, so a probe touches a
+// couple of cache lines and takes no lock. A background thread fetches,
+// from every shard, the rows whose ROW_VERSION is above that shard's
+// watermark, builds a new
+// Table and publishes it with an atomic pointer swap; readers still on the
+// old Table keep it alive until they are done (RCU style). rowversion does
+// not reveal deletes or the old name of a renamed row, so every
+// fullReloadEvery-th refresh reloads the whole table.
+//
+// Names are keyed in their foldName() form, so "john" and "John " find
+// John as the database would. A name with non-ASCII bytes that is not
+// there may still match one under the collation, so its miss is UNSURE
+// and the caller asks the database.
+class NameIndex {
+public:
+    enum Answer {
+        FOUND,
+        NOT_FOUND,      // the database has no such name either
+        UNSURE          // not indexed, but the database may match it
+    };
+
+    class Table {
+    public:
+        // names is keyed by foldName()
+        explicit Table(const std::unordered_map<std::string, std::string>& names);
+
+        Answer find(std::string_view firstName, std::string& lastName) const;
+
+        std::size_t size() const { return _size; }
+
+    private:
+        // The last name is stored right after the first name in the arena.
+        // hash is never 0 for a used slot.
+        struct Slot {
+            std::uint64_t hash;
+            std::uint32_t offset;
+            std::uint32_t keyLength;
+            std::uint32_t valueLength;
+        };
+
+        std::vector<Slot> _slots;
+        std::string _arena;
+        std::size_t _mask;
+        std::size_t _size;
+    };
+
+    NameIndex(ShardRouter& router,
+              std::chrono::seconds refreshInterval,
+              int fullReloadEvery = 60);
+    ~NameIndex();
+
+    NameIndex(const NameIndex&) = delete;
+    NameIndex& operator=(const NameIndex&) = delete;
+
+    // Loads the whole table and starts the background refresh. Throws if
+    // the initial load fails.
+    void start();
+
+    // Sets lastName if firstName is in the index. UNSURE before the
+    // first load as well.
+    Answer lookup(std::string_view firstName, std::string& lastName) const;
+
+    std::shared_ptr<const Table> table() const;
+
+private:
+    void refreshLoop();
+    void refresh(bool full);
+
+    ShardRouter& _router;
+    const std::chrono::seconds _refreshInterval;
+    const int _fullReloadEvery;
+
+    std::unordered_map<std::string, std::string> _names;   // master copy, by foldName()
+    std::vector<Poco::Int64> _watermarks;                  // per shard
+    std::shared_ptr<const Table> _table;    // read and replaced atomically
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stopping;
+    std::thread _refresher;
+
+    Gauge& _entries;
+    Counter& _refreshErrors;
+    Histogram& _refreshLatency;
+};
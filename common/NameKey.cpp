@@ -0,0 +1,44 @@
+#include "NameKey.hpp"
+
+namespace {
+
+std::size_t withoutTrailingSpaces(std::string_view key) {
+    std::size_t end = key.size();
+    while (end > 0 && key[end - 1] == ' ') {
+        --end;
+    }
+    return end;
+}
+
+char foldAscii(unsigned char ch) {
+    return static_cast<char>(ch >= 'A' && ch <= 'Z' ? ch + ('a' - 'A') : ch);
+}
+
+}
+
+bool foldName(std::string_view key, std::string& out) {
+    const std::size_t end = withoutTrailingSpaces(key);
+    bool exact = true;
+    out.clear();
+    for (std::size_t i = 0; i < end; ++i) {
+        const unsigned char ch = static_cast<unsigned char>(key[i]);
+        exact = exact && ch < 0x80;
+        out += foldAscii(ch);
+    }
+    return exact;
+}
+
+void nameKey(std::string_view key, std::string& out) {
+    const std::size_t end = withoutTrailingSpaces(key);
+    out.clear();
+    for (std::size_t i = 0; i < end; ++i) {
+        const unsigned char ch = static_cast<unsigned char>(key[i]);
+        if (ch >= 0x80) {
+            if (out.empty() || static_cast<unsigned char>(out.back()) != 0x80) {
+                out += static_cast<char>(0x80);
+            }
+        } else {
+            out += foldAscii(ch);
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// SQL Server matches USER_FNAME under the column's collation, which
+// ignores trailing spaces and, by default, case. Everything that keys on
+// a first name outside the database (the name index, the Bloom filter,
+// the shard a name lives on) goes through these, so names the database
+// treats as equal are treated as equal there too.
+
+// Replaces out with key without its trailing spaces and with ASCII
+// letters lower-cased. Returns false if key has non-ASCII bytes, whose
+// case cannot be folded without the collation: two such names may be
+// equal in the database and still differ here.
+bool foldName(std::string_view key, std::string& out);
+
+// Like foldName, but with every run of non-ASCII bytes reduced to one
+// 0x80, so names equal under the collation always come out the same. It
+// only ever makes different names alike, so it suits hashing and
+// placement, not equality.
+void nameKey(std::string_view key, std::string& out);
@@ -0,0 +1,369 @@
+#include "NameSearchIndex.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <unordered_set>
+
+namespace {
+
+const std::uint32_t NO_NODE = 0xFFFFFFFF;
+
+std::string toLower(const std::string& s) {
+    std::string out(s);
+    for (char& c : out) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+unsigned levenshtein(const std::string& a, const std::string& b) {
+    std::vector<unsigned> row(b.size() + 1);
+    for (std::size_t j = 0; j <= b.size(); ++j) {
+        row[j] = static_cast<unsigned>(j);
+    }
+    for (std::size_t i = 1; i <= a.size(); ++i) {
+        unsigned diagonal = row[0];
+        row[0] = static_cast<unsigned>(i);
+        for (std::size_t j = 1; j <= b.size(); ++j) {
+            const unsigned above = row[j];
+            row[j] = std::min({ row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0u : 1u) });
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+// Levenshtein distance from one fixed query to many words, using Hyyro's
+// bit-parallel algorithm: O(word length) per word for queries of up to 64
+// bytes, which BK-tree searches compare against thousands of words.
+class QueryDistance {
+public:
+    explicit QueryDistance(const std::string& query)
+        : _query(query), _bitParallel(!query.empty() && query.size() <= 64) {
+        if (_bitParallel) {
+            std::fill(std::begin(_peq), std::end(_peq), 0);
+            for (std::size_t i = 0; i < query.size(); ++i) {
+                _peq[static_cast<unsigned char>(query[i])] |= std::uint64_t(1) << i;
+            }
+        }
+    }
+
+    unsigned operator()(const std::string& word) const {
+        if (!_bitParallel) {
+            return levenshtein(_query, word);
+        }
+        std::uint64_t pv = ~std::uint64_t(0);
+        std::uint64_t mv = 0;
+        const std::uint64_t last = std::uint64_t(1) << (_query.size() - 1);
+        unsigned score = static_cast<unsigned>(_query.size());
+        for (char c : word) {
+            const std::uint64_t eq = _peq[static_cast<unsigned char>(c)];
+            const std::uint64_t xv = eq | mv;
+            const std::uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            std::uint64_t ph = mv | ~(xh | pv);
+            std::uint64_t mh = pv & xh;
+            if (ph & last) {
+                ++score;
+            } else if (mh & last) {
+                --score;
+            }
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+        }
+        return score;
+    }
+
+private:
+    const std::string& _query;
+    const bool _bitParallel;
+    std::uint64_t _peq[256];
+};
+
+}
+
+// --- NameSearchIndex::RadixTrie implementation ---
+NameSearchIndex::RadixTrie::RadixTrie()
+    : _nodes(1) {
+}
+
+std::uint32_t NameSearchIndex::RadixTrie::findChild(std::uint32_t node, char c) const {
+    const auto& children = _nodes[node].children;
+    auto it = std::lower_bound(children.begin(), children.end(), c,
+        [&](std::uint32_t child, char ch) { return _nodes[child].label[0] < ch; });
+    return (it != children.end() && _nodes[*it].label[0] == c) ? *it : NO_NODE;
+}
+
+void NameSearchIndex::RadixTrie::insert(const std::string& key, std::uint32_t id) {
+    std::uint32_t node = 0;
+    std::size_t pos = 0;
+    while (pos < key.size()) {
+        const std::uint32_t child = findChild(node, key[pos]);
+        if (child == NO_NODE) {
+            // New leaf for the rest of the key
+            const std::uint32_t leaf = static_cast<std::uint32_t>(_nodes.size());
+            _nodes.push_back(Node{ key.substr(pos), {}, { id } });
+            auto& children = _nodes[node].children;
+            children.insert(std::lower_bound(children.begin(), children.end(), key[pos],
+                [&](std::uint32_t c, char ch) { return _nodes[c].label[0] < ch; }), leaf);
+            return;
+        }
+
+        const std::string& label = _nodes[child].label;
+        std::size_t common = 0;
+        while (common < label.size() && pos + common < key.size() && label[common] == key[pos + common]) {
+            ++common;
+        }
+        if (common < label.size()) {
+            // Split the edge: child keeps the tail, a new node takes the head
+            const std::uint32_t head = static_cast<std::uint32_t>(_nodes.size());
+            _nodes.push_back(Node{ label.substr(0, common), { child }, {} });
+            _nodes[child].label.erase(0, common);
+            std::replace(_nodes[node].children.begin(), _nodes[node].children.end(), child, head);
+            node = head;
+        } else {
+            node = child;
+        }
+        pos += common;
+    }
+    _nodes[node].ids.push_back(id);
+}
+
+void NameSearchIndex::RadixTrie::visitPrefix(const std::string& prefix,
+                                             const std::function<bool(std::uint32_t)>& fn) const {
+    std::uint32_t node = 0;
+    std::size_t pos = 0;
+    while (pos < prefix.size()) {
+        node = findChild(node, prefix[pos]);
+        if (node == NO_NODE) {
+            return;
+        }
+        const std::string& label = _nodes[node].label;
+        const std::size_t n = std::min(label.size(), prefix.size() - pos);
+        if (label.compare(0, n, prefix, pos, n) != 0) {
+            return;
+        }
+        pos += n;
+    }
+
+    // Depth-first, children in order, so keys come out sorted
+    std::vector<std::uint32_t> stack(1, node);
+    while (!stack.empty()) {
+        const Node& current = _nodes[stack.back()];
+        stack.pop_back();
+        for (std::uint32_t id : current.ids) {
+            if (!fn(id)) {
+                return;
+            }
+        }
+        stack.insert(stack.end(), current.children.rbegin(), current.children.rend());
+    }
+}
+
+// --- NameSearchIndex::BkTree implementation ---
+void NameSearchIndex::BkTree::insert(const std::string& word, std::uint32_t id) {
+    if (_nodes.empty()) {
+        _nodes.push_back(Node{ word, id, {} });
+        return;
+    }
+    std::uint32_t node = 0;
+    for (;;) {
+        const unsigned d = levenshtein(word, _nodes[node].word);
+        if (d == 0) {
+            return;
+        }
+        auto& children = _nodes[node].children;
+        auto it = std::find_if(children.begin(), children.end(),
+            [d](const std::pair<unsigned, std::uint32_t>& c) { return c.first == d; });
+        if (it == children.end()) {
+            children.emplace_back(d, static_cast<std::uint32_t>(_nodes.size()));
+            _nodes.push_back(Node{ word, id, {} });
+            return;
+        }
+        node = it->second;
+    }
+}
+
+void NameSearchIndex::BkTree::search(const std::string& query, unsigned maxDistance,
+                                     std::vector<std::pair<unsigned, std::uint32_t>>& out) const {
+    if (_nodes.empty()) {
+        return;
+    }
+    const QueryDistance distance(query);
+    std::vector<std::uint32_t> stack(1, 0);
+    while (!stack.empty()) {
+        const Node& node = _nodes[stack.back()];
+        stack.pop_back();
+        const unsigned d = distance(node.word);
+        if (d <= maxDistance) {
+            out.emplace_back(d, node.id);
+        }
+        // Only subtrees at distance d +/- maxDistance can hold matches
+        for (const auto& child : node.children) {
+            if (child.first + maxDistance >= d && child.first <= d + maxDistance) {
+                stack.push_back(child.second);
+            }
+        }
+    }
+}
+
+// --- NameSearchIndex::Snapshot implementation ---
+NameSearchIndex::Snapshot::Snapshot(const std::vector<NameRow>& rows) {
+    // Words come from the row's own columns, not from splitting the full
+    // name at a space: first names may contain spaces themselves.
+    std::vector<std::pair<std::string, const NameRow*>> named;
+    named.reserve(rows.size());
+    for (const auto& row : rows) {
+        named.emplace_back(row.firstName + " " + row.lastName, &row);
+    }
+    std::sort(named.begin(), named.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first < b.first : a.second->firstName < b.second->firstName;
+    });
+
+    std::map<std::string, std::uint32_t> words;
+    for (std::size_t i = 0; i < named.size(); ++i) {
+        const std::string& fullName = named[i].first;
+        const NameRow& row = *named[i].second;
+        const bool newName = _names.empty() || _names.back() != fullName;
+        if (!newName && named[i - 1].second->firstName == row.firstName) {
+            continue;   // the same row twice
+        }
+        if (newName) {
+            _names.push_back(fullName);
+        }
+        const std::uint32_t id = static_cast<std::uint32_t>(_names.size() - 1);
+        const std::string first = toLower(row.firstName);
+        const std::string last = toLower(row.lastName);
+
+        if (newName) {
+            _trie.insert(toLower(fullName), id);
+        }
+        if (!last.empty()) {
+            _trie.insert(last, id);
+        }
+        for (const std::string& word : { first, last }) {
+            if (word.empty()) continue;
+            auto inserted = words.emplace(word, static_cast<std::uint32_t>(_wordNames.size()));
+            if (inserted.second) {
+                _wordNames.emplace_back();
+            }
+            std::vector<std::uint32_t>& ids = _wordNames[inserted.first->second];
+            if (ids.empty() || ids.back() != id) {
+                ids.push_back(id);
+            }
+        }
+    }
+    for (const auto& word : words) {
+        _words.insert(word.first, word.second);
+    }
+}
+
+std::vector<std::string> NameSearchIndex::Snapshot::prefix(const std::string& query, std::size_t maxResults) const {
+    std::vector<std::string> results;
+    std::unordered_set<std::uint32_t> seen;
+    _trie.visitPrefix(toLower(query), [&](std::uint32_t id) {
+        if (seen.insert(id).second) {
+            results.push_back(_names[id]);
+        }
+        return results.size() < maxResults;
+    });
+    return results;
+}
+
+std::vector<std::string> NameSearchIndex::Snapshot::fuzzy(const std::string& query, unsigned maxDistance,
+                                                          std::size_t maxResults) const {
+    std::vector<std::pair<unsigned, std::uint32_t>> matches;
+    _words.search(toLower(query), maxDistance, matches);
+
+    // Closest first; a name matched by both its words counts once, at its
+    // best. A word's name ids are ascending, so only its first maxResults
+    // can make the cut.
+    std::vector<std::pair<unsigned, std::uint32_t>> names;
+    for (const auto& match : matches) {
+        const auto& ids = _wordNames[match.second];
+        const std::size_t n = std::min(ids.size(), maxResults);
+        for (std::size_t i = 0; i < n; ++i) {
+            names.emplace_back(match.first, ids[i]);
+        }
+    }
+    std::sort(names.begin(), names.end());
+
+    std::vector<std::string> results;
+    std::unordered_set<std::uint32_t> seen;
+    for (const auto& name : names) {
+        if (results.size() == maxResults) break;
+        if (seen.insert(name.second).second) {
+            results.push_back(_names[name.second]);
+        }
+    }
+    return results;
+}
+
+// --- NameSearchIndex implementation ---
+NameSearchIndex::NameSearchIndex(ShardRouter& router, std::chrono::seconds refreshInterval)
+    : _router(router),
+      _refreshInterval(refreshInterval),
+      _stopping(false),
+      _entries(MetricsRegistry::instance().gauge("name_search_entries", "Names in the search index")),
+      _refreshErrors(MetricsRegistry::instance().counter("name_search_refresh_errors_total", "Failed search index rebuilds")),
+      _searchLatency(MetricsRegistry::instance().histogram("name_search_ms", "Time taken by each SearchNames lookup", latencyBucketsMs())) {
+}
+
+NameSearchIndex::~NameSearchIndex() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    if (_refresher.joinable()) {
+        _refresher.join();
+    }
+}
+
+void NameSearchIndex::start() {
+    rebuild();
+    _refresher = std::thread(&NameSearchIndex::refreshLoop, this);
+}
+
+std::vector<std::string> NameSearchIndex::search(const std::string& query, Mode mode,
+                                                 std::size_t maxResults, unsigned maxDistance) const {
+    const auto start = std::chrono::steady_clock::now();
+    const std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&_snapshot);
+    std::vector<std::string> results;
+    if (snapshot && maxResults > 0) {
+        results = mode == PREFIX
+            ? snapshot->prefix(query, maxResults)
+            : snapshot->fuzzy(query, maxDistance, maxResults);
+    }
+    _searchLatency.observe(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return results;
+}
+
+void NameSearchIndex::refreshLoop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_wake.wait_for(lock, _refreshInterval, [&] { return _stopping; })) {
+                return;
+            }
+        }
+        try {
+            rebuild();
+        } catch (const std::exception& ex) {
+            // Keep the last good index and try again next interval
+            _refreshErrors.inc();
+            logError("Name search index rebuild failed: {}", ex.what());
+        }
+    }
+}
+
+void NameSearchIndex::rebuild() {
+    std::vector<Poco::Int64> watermarks;
+    const std::vector<NameRow> rows = _router.loadNames(watermarks);
+
+    std::shared_ptr<const Snapshot> next = std::make_shared<const Snapshot>(rows);
+    std::atomic_store(&_snapshot, next);
+    _entries.set(static_cast<std::int64_t>(next->size()));
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "DatabaseService.hpp"
+#include "Metrics.hpp"
+#include "ShardRouter.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// In-process index over [dbo].[USER] names for the SearchNames operation:
+// type-ahead prefix search and misspelling-tolerant (edit distance) search.
+//
+// Prefix search walks a radix trie keyed by first name, last name and full
+// name, lower-cased; results come back in key order. Fuzzy search queries
+// a BK-tree over the distinct first and last names, which uses the
+// triangle inequality to skip most of the tree, and ranks by distance.
+// The whole index is rebuilt from every shard every refresh interval and
+// swapped in atomically, as NameIndex does.
+class NameSearchIndex {
+public:
+    enum Mode {
+        PREFIX,
+        FUZZY
+    };
+
+    // Compressed (radix) trie mapping keys to ids.
+    class RadixTrie {
+    public:
+        RadixTrie();
+
+        void insert(const std::string& key, std::uint32_t id);
+
+        // Calls fn with the id of every key starting with prefix, in key
+        // order, until fn returns false.
+        void visitPrefix(const std::string& prefix, const std::function<bool(std::uint32_t)>& fn) const;
+
+    private:
+        struct Node {
+            std::string label;
+            std::vector<std::uint32_t> children;    // sorted by first label byte
+            std::vector<std::uint32_t> ids;
+        };
+
+        std::uint32_t findChild(std::uint32_t node, char c) const;
+
+        std::vector<Node> _nodes;
+    };
+
+    // Burkhard-Keller tree over words, by Levenshtein distance.
+    class BkTree {
+    public:
+        void insert(const std::string& word, std::uint32_t id);
+
+        // Appends (distance, id) for every word within maxDistance of query.
+        void search(const std::string& query, unsigned maxDistance,
+                    std::vector<std::pair<unsigned, std::uint32_t>>& out) const;
+
+    private:
+        struct Node {
+            std::string word;
+            std::uint32_t id;
+            std::vector<std::pair<unsigned, std::uint32_t>> children;   // (distance, node)
+        };
+
+        std::vector<Node> _nodes;
+    };
+
+    // One immutable build of the index.
+    class Snapshot {
+    public:
+        explicit Snapshot(const std::vector<NameRow>& rows);
+
+        std::vector<std::string> prefix(const std::string& query, std::size_t maxResults) const;
+        std::vector<std::string> fuzzy(const std::string& query, unsigned maxDistance, std::size_t maxResults) const;
+
+        std::size_t size() const { return _names.size(); }
+
+    private:
+        std::vector<std::string> _names;                    // "First Last", sorted
+        std::vector<std::vector<std::uint32_t>> _wordNames; // word id -> name ids
+        RadixTrie _trie;
+        BkTree _words;
+    };
+
+    NameSearchIndex(ShardRouter& router, std::chrono::seconds refreshInterval);
+    ~NameSearchIndex();
+
+    NameSearchIndex(const NameSearchIndex&) = delete;
+    NameSearchIndex& operator=(const NameSearchIndex&) = delete;
+
+    // Builds the index and starts the background refresh. Throws if the
+    // first build fails.
+    void start();
+
+    // Returns up to maxResults full names matching query.
+    std::vector<std::string> search(const std::string& query, Mode mode,
+                                    std::size_t maxResults, unsigned maxDistance = 2) const;
+
+private:
+    void refreshLoop();
+    void rebuild();
+
+    ShardRouter& _router;
+    const std::chrono::seconds _refreshInterval;
+    std::shared_ptr<const Snapshot> _snapshot;  // read and replaced atomically
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stopping;
+    std::thread _refresher;
+
+    Gauge& _entries;
+    Counter& _refreshErrors;
+    Histogram& _searchLatency;
+};
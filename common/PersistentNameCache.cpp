@@ -0,0 +1,242 @@
+#include "PersistentNameCache.hpp"
+#include "Logger.hpp"
+#include <Poco/Checksum.h>
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <cstring>
+#include <ctime>
+#include <string_view>
+
+namespace {
+
+const char MAGIC[8] = { 'P', 'N', 'C', 'A', 'C', 'H', 'E', '\0' };
+
+// Bump when the slot layout or keyHash changes; older files are then
+// recreated. Version 2: FNV-1a instead of std::hash.
+const std::uint32_t FORMAT_VERSION = 2;
+
+// Stored in the file, so it must give the same value in every build and
+// process sharing it; std::hash may differ between standard libraries.
+// FNV-1a with a final mix, as the shard ring uses.
+std::uint64_t keyHash(std::string_view key) {
+    std::uint64_t h = 0xCBF29CE484222325ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 0x100000001B3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    // 0 marks an empty slot
+    return h | 1;
+}
+
+std::int64_t unixNow() {
+    return static_cast<std::int64_t>(std::time(nullptr));
+}
+
+}
+
+struct PersistentNameCache::Header {
+    char magic[8];
+    std::uint32_t formatVersion;
+    std::uint32_t slotSize;
+    std::uint64_t slotCount;
+    char reserved[40];
+};
+
+struct PersistentNameCache::Slot {
+    std::atomic<std::uint32_t> sequence;    // odd while being written
+    std::uint32_t crc;                      // over everything below
+    std::uint64_t hash;
+    std::int64_t expiresAt;                 // Unix time, seconds
+    std::uint16_t keyLength;
+    std::uint16_t valueLength;
+    char data[SLOT_SIZE - 28];              // key then value
+
+    std::uint32_t checksum() const {
+        Poco::Checksum crc32(Poco::Checksum::TYPE_CRC32);
+        crc32.update(reinterpret_cast<const char*>(&hash),
+                     static_cast<unsigned>(offsetof(Slot, data) - offsetof(Slot, hash) + keyLength + valueLength));
+        return crc32.checksum();
+    }
+};
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == 4, "slot layout needs a 4-byte lock-free sequence");
+
+// --- PersistentNameCache implementation ---
+PersistentNameCache::PersistentNameCache(const std::string& path,
+                                         std::size_t slotCount,
+                                         std::chrono::seconds ttl,
+                                         Mode mode)
+    : _ttl(ttl),
+      _mode(mode),
+      _pSlots(nullptr),
+      _bucketMask(0),
+      _hits(MetricsRegistry::instance().counter("name_cache_hits_total", "Name lookups answered by the persistent cache")),
+      _misses(MetricsRegistry::instance().counter("name_cache_misses_total", "Name lookups not found in the persistent cache")),
+      _corrupt(MetricsRegistry::instance().counter("name_cache_corrupt_total", "Persistent cache entries rejected by their checksum")) {
+    static_assert(sizeof(Header) == 64, "cache header layout");
+    static_assert(sizeof(Slot) == SLOT_SIZE, "cache slot layout");
+
+    // Whole buckets, and a power of two of them
+    std::size_t buckets = 1;
+    while (buckets * BUCKET_SLOTS < slotCount) {
+        buckets *= 2;
+    }
+    try {
+        if (open(path, buckets * BUCKET_SLOTS)) {
+            _bucketMask = buckets - 1;
+        }
+    } catch (const Poco::Exception& ex) {
+        logWarning("Name cache disabled: {}", ex.displayText());
+        _pMemory.reset();
+        _pSlots = nullptr;
+    }
+}
+
+bool PersistentNameCache::open(const std::string& path, std::size_t slotCount) {
+    const std::size_t fileSize = sizeof(Header) + slotCount * sizeof(Slot);
+    Poco::File file(path);
+
+    Header expected;
+    std::memset(&expected, 0, sizeof(expected));
+    std::memcpy(expected.magic, MAGIC, sizeof(MAGIC));
+    expected.formatVersion = FORMAT_VERSION;
+    expected.slotSize = static_cast<std::uint32_t>(sizeof(Slot));
+    expected.slotCount = slotCount;
+
+    if (_mode == READ_ONLY) {
+        if (!file.exists() || file.getSize() != fileSize) {
+            logWarning("Name cache disabled: {} is missing or has another layout", path);
+            return false;
+        }
+        _pMemory.reset(new Poco::SharedMemory(file, Poco::SharedMemory::AM_READ));
+        const Header* pHeader = reinterpret_cast<const Header*>(_pMemory->begin());
+        if (std::memcmp(pHeader, &expected, sizeof(Header)) != 0) {
+            logWarning("Name cache disabled: {} has another format version", path);
+            _pMemory.reset();
+            return false;
+        }
+        _pSlots = reinterpret_cast<Slot*>(_pMemory->begin() + sizeof(Header));
+        return true;
+    }
+
+    bool fresh = false;
+    if (!file.exists() || file.getSize() != fileSize) {
+        // New, resized or unreadable: start over from an all-zero (empty) file
+        file.createFile();
+        file.setSize(0);
+        file.setSize(fileSize);
+        fresh = true;
+    }
+    _pMemory.reset(new Poco::SharedMemory(file, Poco::SharedMemory::AM_WRITE));
+    Header* pHeader = reinterpret_cast<Header*>(_pMemory->begin());
+    if (!fresh && std::memcmp(pHeader, &expected, sizeof(Header)) != 0) {
+        std::memset(_pMemory->begin(), 0, fileSize);
+        fresh = true;
+    }
+    _pSlots = reinterpret_cast<Slot*>(_pMemory->begin() + sizeof(Header));
+    if (fresh) {
+        std::memcpy(pHeader, &expected, sizeof(Header));
+    } else {
+        // We are the only writer, so a slot still locked was being written
+        // when the previous process died: unlock it and drop its entry
+        for (std::size_t i = 0; i < slotCount; ++i) {
+            const std::uint32_t sequence = _pSlots[i].sequence.load(std::memory_order_relaxed);
+            if (sequence & 1) {
+                _pSlots[i].hash = 0;
+                _pSlots[i].sequence.store(sequence + 1, std::memory_order_release);
+            }
+        }
+    }
+    return true;
+}
+
+PersistentNameCache::Slot* PersistentNameCache::bucket(std::uint64_t hash) const {
+    return _pSlots + ((hash >> 8) & _bucketMask) * BUCKET_SLOTS;
+}
+
+bool PersistentNameCache::lookup(std::string_view key, std::string& value) const {
+    if (!_pSlots) {
+        return false;
+    }
+    const std::uint64_t hash = keyHash(key);
+    const std::int64_t now = unixNow();
+    Slot* pBucket = bucket(hash);
+
+    for (std::size_t i = 0; i < BUCKET_SLOTS; ++i) {
+        Slot& slot = pBucket[i];
+        const std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if ((before & 1) || slot.hash != hash) {
+            continue;
+        }
+
+        // Copy, then make sure no writer got in while we did
+        Slot copy;
+        std::memcpy(reinterpret_cast<char*>(&copy) + offsetof(Slot, crc),
+                    reinterpret_cast<const char*>(&slot) + offsetof(Slot, crc),
+                    sizeof(Slot) - offsetof(Slot, crc));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) {
+            continue;
+        }
+
+        if (copy.keyLength + copy.valueLength > sizeof(copy.data) || copy.crc != copy.checksum()) {
+            _corrupt.inc();
+            continue;
+        }
+        if (copy.hash != hash || copy.expiresAt <= now
+            || copy.keyLength != key.size() || std::memcmp(copy.data, key.data(), key.size()) != 0) {
+            continue;
+        }
+        value.assign(copy.data + copy.keyLength, copy.valueLength);
+        _hits.inc();
+        return true;
+    }
+    _misses.inc();
+    return false;
+}
+
+void PersistentNameCache::store(const std::string& key, const std::string& value) {
+    if (!_pSlots || _mode == READ_ONLY || key.size() + value.size() > sizeof(Slot::data)) {
+        return;
+    }
+    const std::uint64_t hash = keyHash(key);
+    const std::int64_t now = unixNow();
+    Slot* pBucket = bucket(hash);
+
+    // Same key, else an empty or expired slot, else the one expiring first
+    Slot* pVictim = nullptr;
+    std::int64_t victimExpiry = 0;
+    for (std::size_t i = 0; i < BUCKET_SLOTS; ++i) {
+        Slot& slot = pBucket[i];
+        if (slot.hash == hash && slot.keyLength == key.size()
+            && std::memcmp(slot.data, key.data(), key.size()) == 0) {
+            pVictim = &slot;
+            break;
+        }
+        const std::int64_t expiry = (slot.hash == 0 || slot.expiresAt <= now) ? 0 : slot.expiresAt;
+        if (!pVictim || expiry < victimExpiry) {
+            pVictim = &slot;
+            victimExpiry = expiry;
+        }
+    }
+
+    std::uint32_t sequence = pVictim->sequence.load(std::memory_order_relaxed);
+    if ((sequence & 1)
+        || !pVictim->sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+        return;   // another thread is writing this slot
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    pVictim->hash = hash;
+    pVictim->expiresAt = now + _ttl.count();
+    pVictim->keyLength = static_cast<std::uint16_t>(key.size());
+    pVictim->valueLength = static_cast<std::uint16_t>(value.size());
+    std::memcpy(pVictim->data, key.data(), key.size());
+    std::memcpy(pVictim->data + key.size(), value.data(), value.size());
+    pVictim->crc = pVictim->checksum();
+
+    pVictim->sequence.store(sequence + 2, std::memory_order_release);
+}
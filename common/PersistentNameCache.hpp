@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Metrics.hpp"
+#include <Poco/SharedMemory.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Name lookup cache kept in a memory-mapped file, so it is warm again as
+// soon as soap_service restarts.
+//
+// The file is a header followed by a fixed number of fixed-size slots,
+// grouped into buckets of BUCKET_SLOTS. Each slot holds one key/value pair
+// with an expiry time and a CRC-32; a lookup rejects entries that are
+// expired or fail their checksum, which also covers slots left half
+// written by a crash. Slots are guarded by a sequence lock, so any number
+// of processes can map the file read-only and read it while the one
+// read-write process updates it. A file whose header does not match the
+// current format version or geometry is recreated by the writer and
+// ignored by readers.
+class PersistentNameCache {
+public:
+    enum Mode {
+        READ_WRITE,     // owns the file: creates, validates and updates it
+        READ_ONLY       // maps an existing file for lookups only
+    };
+
+    PersistentNameCache(const std::string& path,
+                        std::size_t slotCount = 64 * 1024,
+                        std::chrono::seconds ttl = std::chrono::hours(1),
+                        Mode mode = READ_WRITE);
+
+    PersistentNameCache(const PersistentNameCache&) = delete;
+    PersistentNameCache& operator=(const PersistentNameCache&) = delete;
+
+    // False if the file could not be mapped; the cache then always misses.
+    bool isOpen() const { return _pSlots != nullptr; }
+
+    bool lookup(std::string_view key, std::string& value) const;
+
+    // Stores the pair unless it does not fit a slot, the cache is
+    // read-only, or another thread is writing the same slot.
+    void store(const std::string& key, const std::string& value);
+
+    static const std::size_t BUCKET_SLOTS = 4;
+    static const std::size_t SLOT_SIZE = 256;
+
+private:
+    struct Slot;
+    struct Header;
+
+    bool open(const std::string& path, std::size_t slotCount);
+    Slot* bucket(std::uint64_t hash) const;
+
+    const std::chrono::seconds _ttl;
+    const Mode _mode;
+    std::unique_ptr<Poco::SharedMemory> _pMemory;
+    Slot* _pSlots;
+    std::size_t _bucketMask;
+
+    Counter& _hits;
+    Counter& _misses;
+    Counter& _corrupt;
+};
@@ -0,0 +1,185 @@
+#include "RateLimiter.hpp"
+#include <Poco/Exception.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace {
+
+// Bucket state: time of last update in milliseconds since the limiter was
+// created in the high 40 bits, tokens in 1/256ths in the low 24 bits.
+const unsigned TOKEN_BITS = 24;
+const std::uint64_t TOKEN_MASK = (std::uint64_t(1) << TOKEN_BITS) - 1;
+const double TOKEN_SCALE = 256.0;
+
+// How many slots a key may probe before the limiter gives up on it.
+const std::size_t MAX_PROBE = 8;
+
+inline std::uint64_t packState(std::uint64_t timeMs, std::uint64_t tokenUnits) {
+    return (timeMs << TOKEN_BITS) | tokenUnits;
+}
+
+inline std::uint64_t stateTime(std::uint64_t state) {
+    return state >> TOKEN_BITS;
+}
+
+inline std::uint64_t stateTokens(std::uint64_t state) {
+    return state & TOKEN_MASK;
+}
+
+// Spreads std::hash output, which is the identity for integers on some
+// standard libraries, across all 64 bits (splitmix64 finalizer).
+inline std::uint64_t mix(std::uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+}
+
+// --- RateLimiter implementation ---
+RateLimiter::RateLimiter(double ratePerSecond, double burst, std::chrono::seconds idleExpiry,
+                         std::size_t shards, std::size_t slotsPerShard)
+    : _tokensPerMs(ratePerSecond / 1000.0),
+      _burstUnits(std::min<std::uint64_t>(static_cast<std::uint64_t>(burst * TOKEN_SCALE), TOKEN_MASK)),
+      _idleExpiryMs(static_cast<std::uint64_t>(idleExpiry.count()) * 1000),
+      _shards(shards),
+      _slotsPerShard(slotsPerShard),
+      _epoch(Clock::now()),
+      _slots(new Slot[shards * slotsPerShard]),
+      _allowed(MetricsRegistry::instance().counter("ratelimit_allowed_total", "Requests within their client's rate limit")),
+      _limited(MetricsRegistry::instance().counter("ratelimit_limited_total", "Requests rejected by the rate limiter")),
+      _evicted(MetricsRegistry::instance().counter("ratelimit_evicted_total", "Live buckets given to a new client because no slot was free")) {
+    if (!(ratePerSecond > 0.0)) {
+        throw Poco::InvalidArgumentException("RateLimiter needs a positive rate");
+    }
+    if (!(burst >= 1.0)) {
+        throw Poco::InvalidArgumentException("RateLimiter needs a burst of at least one request");
+    }
+}
+
+void RateLimiter::setApiKeys(const std::vector<std::string>& apiKeys) {
+    _apiKeys.clear();
+    for (const std::string& apiKey : apiKeys) {
+        if (!apiKey.empty()) {
+            _apiKeys.insert(apiKey);
+        }
+    }
+}
+
+std::string RateLimiter::clientKey(const Poco::Net::HTTPServerRequest& request) const {
+    const std::string& apiKey = request.get("X-API-Key", "");
+    if (!apiKey.empty() && _apiKeys.count(apiKey) != 0) {
+        return "key:" + apiKey;
+    }
+    return "ip:" + request.clientAddress().host().toString();
+}
+
+bool RateLimiter::tryAcquire(const std::string& clientKey, int& retryAfterSeconds) {
+    const std::uint64_t hash = mix(std::hash<std::string>()(clientKey)) | 1;  // 0 marks an empty slot
+    const std::uint64_t now = nowMs();
+
+    Slot* slot = findSlot(hash, now);
+    if (!slot) {
+        // Lost the race for every slot in the window: fail closed
+        retryAfterSeconds = 1;
+        _limited.inc();
+        return false;
+    }
+
+    const std::uint64_t one = static_cast<std::uint64_t>(TOKEN_SCALE);
+    std::uint64_t state = slot->state.load(std::memory_order_acquire);
+    for (;;) {
+        // A zero state is a fresh slot: a full bucket.
+        std::uint64_t tokens = _burstUnits;
+        if (state != 0) {
+            const std::uint64_t elapsed = now > stateTime(state) ? now - stateTime(state) : 0;
+            const double refill = static_cast<double>(elapsed) * _tokensPerMs * TOKEN_SCALE;
+            tokens = std::min<std::uint64_t>(_burstUnits,
+                stateTokens(state) + static_cast<std::uint64_t>(std::min(refill, static_cast<double>(TOKEN_MASK))));
+        }
+
+        if (tokens < one) {
+            const double missing = static_cast<double>(one - tokens) / TOKEN_SCALE;
+            retryAfterSeconds = std::max(1, static_cast<int>(std::ceil(missing / (_tokensPerMs * 1000.0))));
+            _limited.inc();
+            return false;
+        }
+
+        if (slot->state.compare_exchange_weak(state, packState(now, tokens - one),
+                                              std::memory_order_acq_rel, std::memory_order_acquire)) {
+            _allowed.inc();
+            return true;
+        }
+    }
+}
+
+std::uint64_t RateLimiter::nowMs() const {
+    // Start at 1 so no live bucket ever has the all-zero "fresh" state.
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - _epoch).count()) + 1;
+}
+
+RateLimiter::Slot* RateLimiter::findSlot(std::uint64_t hash, std::uint64_t now) {
+    Slot* shard = _slots.get() + (hash >> 48) % _shards * _slotsPerShard;
+    const std::size_t start = static_cast<std::size_t>(hash % _slotsPerShard);
+
+    for (std::size_t i = 0; i < MAX_PROBE; ++i) {
+        Slot& slot = shard[(start + i) % _slotsPerShard];
+        std::uint64_t key = slot.key.load(std::memory_order_acquire);
+        if (key == hash) {
+            return &slot;
+        }
+        if (key == 0) {
+            if (slot.key.compare_exchange_strong(key, hash, std::memory_order_acq_rel)) {
+                return &slot;
+            }
+            if (key == hash) {
+                return &slot;
+            }
+            continue;
+        }
+
+        // Reuse a slot whose bucket has sat idle past the expiry. A freshly
+        // claimed slot still has a zero state; leave it to its owner.
+        const std::uint64_t state = slot.state.load(std::memory_order_acquire);
+        if (state != 0 && now - std::min(now, stateTime(state)) > _idleExpiryMs
+            && slot.key.compare_exchange_strong(key, hash, std::memory_order_acq_rel)) {
+            slot.state.store(0, std::memory_order_release);
+            return &slot;
+        }
+    }
+    return evictOldest(shard, start, hash);
+}
+
+RateLimiter::Slot* RateLimiter::evictOldest(Slot* shard, std::size_t start, std::uint64_t hash) {
+    Slot* oldest = nullptr;
+    std::uint64_t oldestKey = 0;
+    std::uint64_t oldestTime = 0;
+    for (std::size_t i = 0; i < MAX_PROBE; ++i) {
+        Slot& slot = shard[(start + i) % _slotsPerShard];
+        const std::uint64_t key = slot.key.load(std::memory_order_acquire);
+        const std::uint64_t state = slot.state.load(std::memory_order_acquire);
+        if (key == hash) {
+            return &slot;
+        }
+        // A zero state was claimed a moment ago; leave it to its owner
+        if (state != 0 && (!oldest || stateTime(state) < oldestTime)) {
+            oldest = &slot;
+            oldestKey = key;
+            oldestTime = stateTime(state);
+        }
+    }
+    if (!oldest) {
+        return nullptr;
+    }
+    if (oldest->key.compare_exchange_strong(oldestKey, hash, std::memory_order_acq_rel)) {
+        oldest->state.store(0, std::memory_order_release);
+        _evicted.inc();
+        return oldest;
+    }
+    return oldestKey == hash ? oldest : nullptr;
+}
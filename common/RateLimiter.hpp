@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Metrics.hpp"
+#include <Poco/Net/HTTPServerRequest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Per-client token-bucket rate limiter.
+//
+// Buckets live in a fixed-size table split into shards. Each slot holds a
+// 64-bit hash of the client key and the bucket state packed into a single
+// 64-bit word (token count and time of last update), so taking a token is
+// one compare-and-swap and no lock is ever held. Tokens are refilled
+// lazily from the elapsed time when a client next shows up, and slots
+// whose bucket has been idle longer than the expiry are reused for new
+// clients as they probe past them.
+//
+// Two keys whose hashes collide share a bucket, and a slot reused while
+// its previous owner is mid-update may briefly mix their counts; both are
+// rare enough to accept in exchange for lock-freedom. When a new client's
+// probe window is full of live buckets, the least recently used of them is
+// given to it; a client evicted that way comes back with a full bucket.
+class RateLimiter {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // Throws Poco::InvalidArgumentException unless ratePerSecond is
+    // positive and burst is at least one request.
+    RateLimiter(double ratePerSecond, double burst,
+                std::chrono::seconds idleExpiry = std::chrono::seconds(300),
+                std::size_t shards = 16, std::size_t slotsPerShard = 4096);
+
+    // API keys that identify a client. Call before the server starts.
+    void setApiKeys(const std::vector<std::string>& apiKeys);
+
+    // The bucket key for a request: its X-API-Key if that is one of the
+    // configured keys, else its address. Unknown keys are ignored, so a
+    // client cannot get a fresh bucket by making one up.
+    std::string clientKey(const Poco::Net::HTTPServerRequest& request) const;
+
+    // Takes one token from the client's bucket. Returns false if the
+    // bucket is empty; retryAfterSeconds is then set to when the next
+    // token will be available.
+    bool tryAcquire(const std::string& clientKey, int& retryAfterSeconds);
+
+private:
+    struct alignas(16) Slot {
+        std::atomic<std::uint64_t> key{0};
+        std::atomic<std::uint64_t> state{0};
+    };
+
+    std::uint64_t nowMs() const;
+    Slot* findSlot(std::uint64_t hash, std::uint64_t now);
+    Slot* evictOldest(Slot* shard, std::size_t start, std::uint64_t hash);
+
+    const double _tokensPerMs;
+    const std::uint64_t _burstUnits;
+    const std::uint64_t _idleExpiryMs;
+    const std::size_t _shards;
+    const std::size_t _slotsPerShard;
+    const Clock::time_point _epoch;
+    std::unique_ptr<Slot[]> _slots;
+    std::unordered_set<std::string> _apiKeys;
+
+    Counter& _allowed;
+    Counter& _limited;
+    Counter& _evicted;
+};
@@ -0,0 +1,149 @@
+#include "ReplicaSet.hpp"
+#include <Poco/Data/ODBC/Connector.h>
+#include <Poco/Exception.h>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+const int SESSION_IDLE_SECONDS = 60;
+
+// EWMA weight of each new latency sample
+const double EWMA_ALPHA = 0.2;
+
+// A failed read counts as at least this slow, so the replica is avoided
+// until its successes bring the average back down
+const double FAILURE_PENALTY_MS = 1000.0;
+
+// The hedge delay is the p95 of the last LATENCY_WINDOW reads, recomputed
+// every RECOMPUTE_EVERY reads and kept within these bounds
+const std::size_t LATENCY_WINDOW = 512;
+const std::size_t RECOMPUTE_EVERY = 32;
+const double INITIAL_HEDGE_DELAY_MS = 50.0;
+const double MIN_HEDGE_DELAY_MS = 1.0;
+const double MAX_HEDGE_DELAY_MS = 1000.0;
+
+long long toMicroseconds(double ms) {
+    return static_cast<long long>(ms * 1000.0);
+}
+
+std::mt19937& randomEngine() {
+    thread_local std::mt19937 engine{ std::random_device{}() };
+    return engine;
+}
+
+}
+
+// --- ReplicaSet implementation ---
+ReplicaSet::ReplicaSet(const std::vector<Replica>& replicas, int sessionsPerReplica, bool hedging)
+    : _hedging(hedging),
+      _recentNext(0),
+      _sinceRecompute(0),
+      _hedgeDelayUs(toMicroseconds(INITIAL_HEDGE_DELAY_MS)),
+      _readLatency(MetricsRegistry::instance().histogram("db_replica_read_ms", "Latency of reads on a replica", latencyBucketsMs())),
+      _hedged(MetricsRegistry::instance().counter("db_hedged_reads_total", "Reads sent to a second replica")),
+      _hedgeWins(MetricsRegistry::instance().counter("db_hedge_wins_total", "Hedged reads answered first by the second replica")),
+      _hedgeDelayGauge(MetricsRegistry::instance().gauge("db_hedge_delay_us", "Current hedge delay")),
+      _workers("replica-reads", std::max(1, sessionsPerReplica * static_cast<int>(replicas.size()))) {
+    if (replicas.empty()) {
+        throw Poco::InvalidArgumentException("ReplicaSet needs at least one replica");
+    }
+    Poco::Data::ODBC::Connector::registerConnector();
+
+    _recentMs.reserve(LATENCY_WINDOW);
+    for (const auto& replica : replicas) {
+        std::unique_ptr<ReplicaState> state(new ReplicaState);
+        state->pool.reset(new Poco::Data::SessionPool(replica.connector, replica.connectionString, 1,
+                                                      sessionsPerReplica, SESSION_IDLE_SECONDS));
+        state->injectedLatency = replica.injectedLatency;
+        state->ewmaMs.store(0.0);
+        state->inFlight.store(0);
+        _replicas.push_back(std::move(state));
+    }
+    _hedgeDelayGauge.set(_hedgeDelayUs.load());
+}
+
+std::chrono::microseconds ReplicaSet::hedgeDelay() const {
+    return std::chrono::microseconds(_hedgeDelayUs.load(std::memory_order_relaxed));
+}
+
+std::size_t ReplicaSet::pick(std::size_t exclude) {
+    const std::size_t n = _replicas.size();
+    if (n == 1) {
+        return 0;
+    }
+
+    // Two distinct candidates, neither of them the excluded replica
+    std::vector<std::size_t> candidates;
+    candidates.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i != exclude) {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.size() == 1) {
+        return candidates[0];
+    }
+    std::uniform_int_distribution<std::size_t> dist(0, candidates.size() - 1);
+    const std::size_t a = dist(randomEngine());
+    std::size_t b = dist(randomEngine());
+    while (b == a) {
+        b = dist(randomEngine());
+    }
+
+    // Untried replicas have an EWMA of 0 and so get tried first
+    auto cost = [this](std::size_t i) {
+        const ReplicaState& r = *_replicas[i];
+        return r.ewmaMs.load(std::memory_order_relaxed) * (r.inFlight.load(std::memory_order_relaxed) + 1);
+    };
+    return cost(candidates[a]) <= cost(candidates[b]) ? candidates[a] : candidates[b];
+}
+
+DatabaseService ReplicaSet::open(std::size_t replica) {
+    ReplicaState& r = *_replicas[replica];
+    if (r.injectedLatency) {
+        std::this_thread::sleep_for(r.injectedLatency());
+    }
+    DatabaseService db(r.pool->get(), DatabaseService::READ_ONLY);
+    db.connect();
+    return db;
+}
+
+void ReplicaSet::begin(std::size_t replica) {
+    _replicas[replica]->inFlight.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ReplicaSet::finish(std::size_t replica, std::chrono::steady_clock::time_point start, bool ok) {
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ReplicaState& r = *_replicas[replica];
+    r.inFlight.fetch_sub(1, std::memory_order_relaxed);
+
+    // Concurrent updates may lose a sample; the average does not need to be exact
+    const double sample = ok ? ms : std::max(ms, FAILURE_PENALTY_MS);
+    const double old = r.ewmaMs.load(std::memory_order_relaxed);
+    r.ewmaMs.store(old == 0.0 ? sample : old + EWMA_ALPHA * (sample - old), std::memory_order_relaxed);
+
+    if (!ok) {
+        return;
+    }
+    _readLatency.observe(ms);
+
+    std::lock_guard<std::mutex> lock(_latencyMutex);
+    if (_recentMs.size() < LATENCY_WINDOW) {
+        _recentMs.push_back(ms);
+    } else {
+        _recentMs[_recentNext] = ms;
+    }
+    _recentNext = (_recentNext + 1) % LATENCY_WINDOW;
+    if (++_sinceRecompute < RECOMPUTE_EVERY) {
+        return;
+    }
+    _sinceRecompute = 0;
+
+    std::vector<double> sorted(_recentMs);
+    auto p95 = sorted.begin() + static_cast<std::ptrdiff_t>(sorted.size() * 95 / 100);
+    std::nth_element(sorted.begin(), p95, sorted.end());
+    const double delayMs = std::min(std::max(*p95, MIN_HEDGE_DELAY_MS), MAX_HEDGE_DELAY_MS);
+    _hedgeDelayUs.store(toMicroseconds(delayMs), std::memory_order_relaxed);
+    _hedgeDelayGauge.set(toMicroseconds(delayMs));
+}
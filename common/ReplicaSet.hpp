@@ -0,0 +1,183 @@
+#pragma once
+
+#include "DatabaseService.hpp"
+#include "Metrics.hpp"
+#include "WorkerPool.hpp"
+#include <Poco/Data/SessionPool.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// One read replica of a database.
+struct Replica {
+    std::string connectionString;
+    std::string connector = "ODBC";
+
+    // Test hook: extra latency added to every query on this replica, so
+    // stand-ins (e.g. SQLite in-memory databases) can act like slow or
+    // stalling servers.
+    std::function<std::chrono::microseconds()> injectedLatency;
+};
+
+// Spreads read queries over a set of replicas.
+//
+// Each read goes to the less loaded of two randomly picked replicas, with
+// load measured as the replica's latency EWMA times its queries in flight;
+// a stalled replica quickly stops being picked. With hedging on, a read
+// still running after the recent p95 latency is sent to a second replica
+// too, and whichever answers first wins. A read that fails before then is
+// hedged straight away. Attempts run on a worker pool bounded by the
+// replicas' sessions; the loser finishes in the background and its
+// session returns to its pool. When no worker is free the read runs on
+// the caller's thread without a hedge, and a hedge is skipped.
+class ReplicaSet {
+public:
+    ReplicaSet(const std::vector<Replica>& replicas, int sessionsPerReplica = 8, bool hedging = true);
+
+    ReplicaSet(const ReplicaSet&) = delete;
+    ReplicaSet& operator=(const ReplicaSet&) = delete;
+
+    std::size_t size() const { return _replicas.size(); }
+
+    // Runs query(DatabaseService&) on a READ_ONLY service and returns its
+    // result. Rethrows the query's exception if every attempt failed. The
+    // query is copied and a losing copy may outlive the call, so it must
+    // capture its arguments by value.
+    template <typename Query>
+    auto read(Query query) -> decltype(query(std::declval<DatabaseService&>()));
+
+    // Current hedge delay, derived from the recent p95 read latency.
+    std::chrono::microseconds hedgeDelay() const;
+
+private:
+    struct ReplicaState {
+        std::unique_ptr<Poco::Data::SessionPool> pool;
+        std::function<std::chrono::microseconds()> injectedLatency;
+        std::atomic<double> ewmaMs;
+        std::atomic<int> inFlight;
+    };
+
+    template <typename T>
+    struct Race {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::unique_ptr<T> result;
+        std::exception_ptr error;
+        std::size_t winner = 0;
+        int launched = 0;
+        int failed = 0;
+    };
+
+    static const std::size_t NO_REPLICA = static_cast<std::size_t>(-1);
+
+    std::size_t pick(std::size_t exclude);
+    DatabaseService open(std::size_t replica);
+    void begin(std::size_t replica);
+    void finish(std::size_t replica, std::chrono::steady_clock::time_point start, bool ok);
+
+    template <typename T, typename Query>
+    T attempt(std::size_t replica, Query& query);
+
+    std::vector<std::unique_ptr<ReplicaState>> _replicas;
+    const bool _hedging;
+
+    mutable std::mutex _latencyMutex;
+    std::vector<double> _recentMs;        // ring buffer of recent read latencies
+    std::size_t _recentNext;
+    std::size_t _sinceRecompute;
+    std::atomic<long long> _hedgeDelayUs;
+
+    Histogram& _readLatency;
+    Counter& _hedged;
+    Counter& _hedgeWins;
+    Gauge& _hedgeDelayGauge;
+
+    // Last, so it is destroyed first: waits for losing attempts that are
+    // still using the pools
+    WorkerPool _workers;
+};
+
+// --- ReplicaSet template implementation ---
+template <typename T, typename Query>
+T ReplicaSet::attempt(std::size_t replica, Query& query) {
+    const auto start = std::chrono::steady_clock::now();
+    begin(replica);
+    try {
+        DatabaseService db = open(replica);
+        T result = query(db);
+        finish(replica, start, true);
+        return result;
+    } catch (...) {
+        finish(replica, start, false);
+        throw;
+    }
+}
+
+template <typename Query>
+auto ReplicaSet::read(Query query) -> decltype(query(std::declval<DatabaseService&>())) {
+    using T = decltype(query(std::declval<DatabaseService&>()));
+
+    const std::size_t first = pick(NO_REPLICA);
+    if (!_hedging || _replicas.size() < 2) {
+        return attempt<T>(first, query);
+    }
+
+    auto race = std::make_shared<Race<T>>();
+    auto launch = [this, race, query](std::size_t replica) mutable {
+        const bool started = _workers.tryRun([this, race, query, replica]() mutable {
+            std::unique_ptr<T> result;
+            std::exception_ptr error;
+            try {
+                result.reset(new T(attempt<T>(replica, query)));
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(race->mutex);
+            if (result && !race->result) {
+                race->result = std::move(result);
+                race->winner = replica;
+            } else if (!result) {
+                ++race->failed;
+                if (!race->error) {
+                    race->error = error;
+                }
+            }
+            race->done.notify_all();
+        });
+        if (started) {
+            ++race->launched;
+        }
+        return started;
+    };
+
+    std::unique_lock<std::mutex> lock(race->mutex);
+    if (!launch(first)) {
+        lock.unlock();
+        return attempt<T>(first, query);
+    }
+    auto settled = [&race] { return race->result || race->failed == race->launched; };
+    if (!race->done.wait_for(lock, hedgeDelay(), settled) || !race->result) {
+        const std::size_t second = pick(first);
+        if (launch(second)) {
+            _hedged.inc();
+        }
+    }
+    race->done.wait(lock, settled);
+
+    if (!race->result) {
+        std::rethrow_exception(race->error);
+    }
+    if (race->winner != first) {
+        _hedgeWins.inc();
+    }
+    return std::move(*race->result);
+}
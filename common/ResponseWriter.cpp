@@ -0,0 +1,144 @@
+#include "ResponseWriter.hpp"
+#include "AccessLog.hpp"
+#include <Poco/Net/HTTPServerRequestImpl.h>
+#include <Poco/Net/Socket.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+const std::string_view CRLF = "\r\n";
+const std::string_view LAST_CHUNK = "0\r\n\r\n";
+
+// Reused per thread, so steady-state responses do not allocate here
+std::string& headerBuffer() {
+    thread_local std::string buffer;
+    return buffer;
+}
+
+Poco::Net::SocketBufVec& socketBuffers() {
+    thread_local Poco::Net::SocketBufVec buffers;
+    return buffers;
+}
+
+}
+
+// --- ResponseWriter implementation ---
+ResponseWriter::ResponseWriter(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+    : _response(response),
+      _pSocket(nullptr),
+      _pOut(nullptr),
+      _headOnly(request.getMethod() == Poco::Net::HTTPRequest::HTTP_HEAD),
+      _sent(false) {
+    // A TLS socket would take the bytes unencrypted
+    Poco::Net::HTTPServerRequestImpl* pImpl = dynamic_cast<Poco::Net::HTTPServerRequestImpl*>(&request);
+    if (pImpl && !pImpl->socket().secure()) {
+        _pSocket = &pImpl->socket();
+    }
+}
+
+void ResponseWriter::send(std::string_view body) {
+    _response.setChunkedTransferEncoding(false);
+    _response.setContentLength(body.size());
+    _sent = true;
+    AccessLog::noteResponseBytes(body.size());
+    if (!_pSocket) {
+        _response.sendBuffer(body.data(), body.size());
+        return;
+    }
+
+    std::string& headers = headerBuffer();
+    headers.clear();
+    appendHeaders(headers);
+    write(headers, _headOnly ? std::string_view() : body);
+}
+
+void ResponseWriter::sendChunk(std::string_view chunk) {
+    beginChunked();
+    AccessLog::noteResponseBytes(chunk.size());
+    std::string& headers = headerBuffer();
+    if (_pOut) {
+        _pOut->write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        _pOut->flush();
+        return;
+    }
+    if (chunk.empty() || _headOnly) {
+        write(headers);
+        return;
+    }
+
+    char sizeLine[24];
+    const int length = std::snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", chunk.size());
+    write(headers, std::string_view(sizeLine, static_cast<std::size_t>(length)), chunk, CRLF);
+}
+
+void ResponseWriter::finish() {
+    beginChunked();
+    if (_pOut) {
+        // The response's stream writes the last chunk when it is closed
+        _pOut->flush();
+        return;
+    }
+    write(headerBuffer(), _headOnly ? std::string_view() : LAST_CHUNK);
+}
+
+void ResponseWriter::beginChunked() {
+    // Leaves the header block in headerBuffer(), or nothing once sent
+    std::string& headers = headerBuffer();
+    headers.clear();
+    if (_sent) {
+        return;
+    }
+    _sent = true;
+    _response.setChunkedTransferEncoding(true);
+    if (_pSocket) {
+        appendHeaders(headers);
+    } else {
+        _pOut = &_response.send();
+    }
+}
+
+void ResponseWriter::appendHeaders(std::string& out) const {
+    // Same layout as HTTPResponse::write()
+    char status[16];
+    const int length = std::snprintf(status, sizeof(status), " %d ", static_cast<int>(_response.getStatus()));
+    out.append(_response.getVersion());
+    out.append(status, static_cast<std::size_t>(length));
+    out.append(_response.getReason()).append(CRLF);
+    for (auto it = _response.begin(); it != _response.end(); ++it) {
+        out.append(it->first).append(": ").append(it->second).append(CRLF);
+    }
+    out.append(CRLF);
+}
+
+void ResponseWriter::write(std::string_view a, std::string_view b, std::string_view c, std::string_view d) {
+    std::string_view pieces[] = { a, b, c, d };
+    Poco::Net::SocketBufVec& buffers = socketBuffers();
+    buffers.clear();
+    std::size_t total = 0;
+    for (const auto& piece : pieces) {
+        if (!piece.empty()) {
+            buffers.push_back(Poco::Net::Socket::makeBuffer(const_cast<char*>(piece.data()), piece.size()));
+            total += piece.size();
+        }
+    }
+    if (buffers.empty()) {
+        return;
+    }
+
+    std::size_t written = static_cast<std::size_t>(std::max(_pSocket->sendBytes(buffers), 0));
+    if (written == total) {
+        return;
+    }
+    // The socket took part of it; a blocking send of each remainder
+    // returns only once everything is out
+    for (auto& piece : pieces) {
+        if (written >= piece.size()) {
+            written -= piece.size();
+            continue;
+        }
+        piece.remove_prefix(written);
+        written = 0;
+        _pSocket->sendBytes(piece.data(), static_cast<int>(piece.size()));
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/StreamSocket.h>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Sends an HTTP response straight to the connection's socket, in place of
+// HTTPServerResponse::send() and its buffered stream.
+//
+// The status line and headers are serialized from the response (so the
+// usual setters still apply) and go out with the body, or with each
+// chunk's framing, in a single gathering write: writev, or WSASend on
+// Windows. Use one writer per response: either send() once, or
+// sendChunk() any number of times and then finish(). Nothing should be
+// written to the response by other means afterwards, and exceptions must
+// not escape the handler once the headers are out, since Poco does not
+// know they were sent. Requests not read from Poco's HTTPServer fall back
+// to the response's own stream.
+class ResponseWriter {
+public:
+    ResponseWriter(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+    ResponseWriter(const ResponseWriter&) = delete;
+    ResponseWriter& operator=(const ResponseWriter&) = delete;
+
+    // Sends the whole response, with a Content-Length body.
+    void send(std::string_view body);
+
+    // Sends the next part of a chunked body; the first call sends the
+    // headers too. Empty chunks are skipped, as one would end the body.
+    void sendChunk(std::string_view chunk);
+
+    // Ends a chunked body, sending the headers first if no chunk was.
+    void finish();
+
+    // Whether the headers have gone out.
+    bool sent() const { return _sent; }
+
+private:
+    void beginChunked();
+    void appendHeaders(std::string& out) const;
+
+    // Writes the pieces in order, with one system call unless the socket
+    // takes less than all of them.
+    void write(std::string_view a, std::string_view b = {}, std::string_view c = {}, std::string_view d = {});
+
+    Poco::Net::HTTPServerResponse& _response;
+    Poco::Net::StreamSocket* _pSocket;  // null when falling back to the stream
+    std::ostream* _pOut;                // the fallback's chunked stream
+    const bool _headOnly;
+    bool _sent;
+};
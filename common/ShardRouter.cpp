@@ -0,0 +1,321 @@
+#include "ShardRouter.hpp"
+#include "NameKey.hpp"
+#include <Poco/Data/DataException.h>
+#include <Poco/Data/ODBC/Connector.h>
+#include <Poco/Exception.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+POCO_IMPLEMENT_EXCEPTION(ShardUnavailableException, Poco::IOException, "Shard unavailable")
+
+namespace {
+
+const int SESSION_IDLE_SECONDS = 60;
+
+// FNV-1a with a final avalanche, so nearby virtual node names spread out.
+std::uint64_t ringHash(const std::string& s) {
+    std::uint64_t h = 0xCBF29CE484222325ULL;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001B3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+}
+
+// --- ShardRouter implementation ---
+ShardRouter::ShardRouter(const std::vector<std::string>& connectionStrings,
+                         int sessionsPerShard,
+                         int virtualNodes)
+    : _fanOutLatency(MetricsRegistry::instance().histogram("shard_fanout_ms", "Time taken by cross-shard batch lookups", latencyBucketsMs())),
+      _workers("shard-fanout", std::max(1, sessionsPerShard * static_cast<int>(connectionStrings.size()))) {
+    if (connectionStrings.empty()) {
+        throw Poco::InvalidArgumentException("ShardRouter needs at least one shard");
+    }
+    Poco::Data::ODBC::Connector::registerConnector();
+
+    for (std::size_t shard = 0; shard < connectionStrings.size(); ++shard) {
+        _pools.emplace_back(new Poco::Data::SessionPool("ODBC", connectionStrings[shard], 1,
+                                                        sessionsPerShard, SESSION_IDLE_SECONDS));
+        for (int v = 0; v < virtualNodes; ++v) {
+            _ring.emplace_back(ringHash("shard-" + std::to_string(shard) + "#" + std::to_string(v)),
+                               static_cast<std::uint32_t>(shard));
+        }
+    }
+    std::sort(_ring.begin(), _ring.end());
+    _replicas.resize(_pools.size());
+    for (std::size_t shard = 0; shard < _pools.size(); ++shard) {
+        _guards.emplace_back(new Guard);
+    }
+}
+
+void ShardRouter::setReplicas(std::size_t shard, const std::vector<Replica>& replicas,
+                              int sessionsPerReplica, bool hedging) {
+    _replicas.at(shard).reset(replicas.empty() ? nullptr : new ReplicaSet(replicas, sessionsPerReplica, hedging));
+}
+
+std::size_t ShardRouter::shardFor(const std::string& key) const {
+    // First point clockwise from the key, wrapping around
+    std::string normalized;
+    nameKey(key, normalized);
+    const std::uint64_t h = ringHash(normalized);
+    auto it = std::lower_bound(_ring.begin(), _ring.end(), std::make_pair(h, std::uint32_t(0)));
+    if (it == _ring.end()) {
+        it = _ring.begin();
+    }
+    return it->second;
+}
+
+DatabaseService ShardRouter::service(const std::string& key, DatabaseService::AccessMode mode) {
+    return shardService(shardFor(key), mode);
+}
+
+DatabaseService ShardRouter::shardService(std::size_t shard, DatabaseService::AccessMode mode) {
+    DatabaseService db(_pools.at(shard)->get(), mode);
+    db.connect();
+    return db;
+}
+
+void ShardRouter::admit(std::size_t shard) {
+    Guard& guard = *_guards[shard];
+    if (!guard.breaker.allow()) {
+        throw ShardUnavailableException("Circuit open for shard " + std::to_string(shard));
+    }
+    if (!guard.limiter.tryAcquire()) {
+        guard.breaker.onNeutral();
+        throw ShardUnavailableException("Concurrency limit reached for shard " + std::to_string(shard));
+    }
+}
+
+void ShardRouter::complete(std::size_t shard, std::chrono::steady_clock::time_point start, Outcome outcome) {
+    Guard& guard = *_guards[shard];
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    switch (outcome) {
+        case SUCCEEDED:
+            guard.breaker.onSuccess();
+            guard.limiter.release(ms, false);
+            break;
+        case FAILED:
+            guard.breaker.onFailure();
+            guard.limiter.release(ms, true);
+            break;
+        case NEUTRAL:
+            guard.breaker.onNeutral();
+            guard.limiter.releaseWithoutSample();
+            break;
+    }
+}
+
+void ShardRouter::exportUsers(const std::string& firstName, std::size_t rowsPerFetch,
+                              const DatabaseService::RowBatchHandler& onBatch) {
+    const std::size_t first = firstName.empty() ? 0 : shardFor(firstName);
+    const std::size_t last = firstName.empty() ? _pools.size() : first + 1;
+    for (std::size_t shard = first; shard < last; ++shard) {
+        admit(shard);
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            DatabaseService db = shardService(shard, DatabaseService::READ_ONLY);
+            db.exportUsers(firstName, rowsPerFetch, onBatch);
+            // How long an export takes depends on its size, not on the
+            // database's health; keep it out of the latency samples
+            complete(shard, start, NEUTRAL);
+        } catch (const Poco::Data::DataException&) {
+            complete(shard, start, FAILED);
+            throw;
+        } catch (...) {
+            // e.g. the client went away while we were writing to it
+            complete(shard, start, NEUTRAL);
+            throw;
+        }
+    }
+}
+
+void ShardRouter::scanShard(std::size_t shard, const std::function<void(DatabaseService&)>& scan) {
+    admit(shard);
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        DatabaseService db = shardService(shard, DatabaseService::READ_ONLY);
+        scan(db);
+        // Like an export, its duration follows the table's size
+        complete(shard, start, NEUTRAL);
+    } catch (const Poco::Data::SessionPoolExhaustedException&) {
+        complete(shard, start, NEUTRAL);
+        throw;
+    } catch (const Poco::Data::DataException&) {
+        complete(shard, start, FAILED);
+        throw;
+    } catch (...) {
+        complete(shard, start, NEUTRAL);
+        throw;
+    }
+}
+
+std::vector<NameRow> ShardRouter::listUsers(const NameRow* pAfter, std::size_t pageSize) {
+    const auto start = std::chrono::steady_clock::now();
+
+    // Keys order the same way on every shard, so each shard's first page
+    // after the cursor holds all of its candidates for the merged page
+    std::vector<std::size_t> shards;
+    for (std::size_t shard = 0; shard < _pools.size(); ++shard) {
+        shards.push_back(shard);
+    }
+    std::shared_ptr<const NameRow> after(pAfter ? new NameRow(*pAfter) : nullptr);
+    std::vector<std::vector<NameRow>> parts(_pools.size());
+    forEachShard(shards, [&](std::size_t shard) {
+        parts[shard] = readShard(shard, [after, pageSize](DatabaseService& db) {
+            return db.listUsers(after.get(), pageSize);
+        });
+    });
+
+    std::vector<NameRow> page;
+    for (auto& part : parts) {
+        page.insert(page.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    }
+    if (parts.size() > 1) {
+        std::sort(page.begin(), page.end(), [](const NameRow& a, const NameRow& b) { return keyBefore(a, b); });
+        if (page.size() > pageSize) {
+            page.resize(pageSize);
+        }
+        _fanOutLatency.observe(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return page;
+}
+
+std::map<std::string, std::string> ShardRouter::getFullNames(const std::vector<std::string>& firstNames,
+                                                             const Deadline* pDeadline) {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::vector<std::string>> byShard(_pools.size());
+    for (const auto& name : firstNames) {
+        byShard[shardFor(name)].push_back(name);
+    }
+
+    std::vector<std::size_t> shards;
+    for (std::size_t shard = 0; shard < byShard.size(); ++shard) {
+        if (!byShard[shard].empty()) {
+            shards.push_back(shard);
+        }
+    }
+
+    std::shared_ptr<const Deadline> deadline(pDeadline ? new Deadline(*pDeadline) : nullptr);
+    std::vector<std::map<std::string, std::string>> parts(_pools.size());
+    forEachShard(shards, [&](std::size_t shard) {
+        const std::vector<std::string>& names = byShard[shard];
+        parts[shard] = readShard(shard, [names, deadline](DatabaseService& db) {
+            if (deadline) {
+                deadline->check("querying the database");
+                db.setQueryTimeout(deadline->remaining());
+            }
+            return db.getFullNames(names);
+        });
+    });
+
+    std::map<std::string, std::string> fullNames;
+    for (const auto& part : parts) {
+        fullNames.insert(part.begin(), part.end());
+    }
+
+    _fanOutLatency.observe(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return fullNames;
+}
+
+std::vector<NameRow> ShardRouter::loadNames(std::vector<Poco::Int64>& watermarks) {
+    watermarks.resize(_pools.size(), 0);
+    std::vector<std::size_t> shards;
+    for (std::size_t shard = 0; shard < _pools.size(); ++shard) {
+        shards.push_back(shard);
+    }
+    std::vector<Poco::Int64> next(watermarks);
+    std::vector<std::vector<NameRow>> parts(_pools.size());
+    forEachShard(shards, [&](std::size_t shard) {
+        scanShard(shard, [&](DatabaseService& db) {
+            parts[shard] = db.loadNames(watermarks[shard], &next[shard]);
+        });
+    });
+
+    // A first name lives on one shard only, so the parts never overlap
+    std::vector<NameRow> rows;
+    for (auto& part : parts) {
+        rows.insert(rows.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    }
+    watermarks = std::move(next);
+    return rows;
+}
+
+std::vector<std::string> ShardRouter::loadFirstNames() {
+    std::vector<std::size_t> shards;
+    for (std::size_t shard = 0; shard < _pools.size(); ++shard) {
+        shards.push_back(shard);
+    }
+    std::vector<std::vector<std::string>> parts(_pools.size());
+    forEachShard(shards, [&](std::size_t shard) {
+        scanShard(shard, [&](DatabaseService& db) {
+            parts[shard] = db.loadFirstNames();
+        });
+    });
+
+    std::vector<std::string> names;
+    for (auto& part : parts) {
+        names.insert(names.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    }
+    return names;
+}
+
+void ShardRouter::forEachShard(const std::vector<std::size_t>& shards, const std::function<void(std::size_t)>& work) {
+    if (shards.empty()) {
+        return;
+    }
+    std::mutex mutex;
+    std::condition_variable done;
+    std::size_t running = 0;
+    std::exception_ptr error;
+    auto runShard = [&](std::size_t shard) {
+        try {
+            work(shard);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    // Every shard but the last goes to a worker; the caller takes the
+    // last, and any shard no worker was free for
+    std::vector<std::size_t> local;
+    for (std::size_t i = 0; i + 1 < shards.size(); ++i) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++running;
+        }
+        const bool started = _workers.tryRun([&, shard = shards[i]] {
+            runShard(shard);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--running == 0) {
+                done.notify_all();
+            }
+        });
+        if (!started) {
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            local.push_back(shards[i]);
+        }
+    }
+    local.push_back(shards.back());
+    for (std::size_t shard : local) {
+        runShard(shard);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return running == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "CircuitBreaker.hpp"
+#include "ConcurrencyLimiter.hpp"
+#include "DatabaseService.hpp"
+#include "Deadline.hpp"
+#include "Metrics.hpp"
+#include "ReplicaSet.hpp"
+#include "WorkerPool.hpp"
+#include <Poco/Data/SessionPool.h>
+#include <Poco/Exception.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Thrown when a shard turns a read away without trying it: its circuit
+// breaker is open or its concurrency limit is reached.
+POCO_DECLARE_EXCEPTION(, ShardUnavailableException, Poco::IOException)
+
+// Routes each USER key (the first name) to the database that holds it.
+//
+// Shards sit on a consistent-hash ring with virtualNodes points each, so
+// adding a shard at the end of the list moves only about 1/n of the keys.
+// The ring uses its own FNV-1a hash rather than std::hash, so every
+// process and build places a key on the same shard. Each shard has its
+// own session pool; services handed out are backed by a pooled session,
+// which returns to the pool when the service disconnects or is destroyed.
+// A shard may also have read replicas, which then serve its read().
+//
+// Reads are guarded per shard by a circuit breaker and an adaptive
+// concurrency limit: while a shard's database is failing or slowing down,
+// its reads fail fast with ShardUnavailableException instead of adding to
+// its load, and they are let back in gradually as it recovers.
+class ShardRouter {
+public:
+    ShardRouter(const std::vector<std::string>& connectionStrings,
+                int sessionsPerShard = 8,
+                int virtualNodes = 160);
+
+    ShardRouter(const ShardRouter&) = delete;
+    ShardRouter& operator=(const ShardRouter&) = delete;
+
+    std::size_t shardCount() const { return _pools.size(); }
+
+    // The shard holding key, placed by its nameKey() form: names the
+    // database treats as equal ("john", "John ") go to the same shard.
+    // Rows must be written to the shard this returns for their first name.
+    std::size_t shardFor(const std::string& key) const;
+
+    // A connected service on the shard holding key. Throws
+    // Poco::Data::SessionPoolExhaustedException if that shard's pool is
+    // exhausted.
+    DatabaseService service(const std::string& key, DatabaseService::AccessMode mode);
+    DatabaseService shardService(std::size_t shard, DatabaseService::AccessMode mode);
+
+    // Sends the shard's reads to these replicas instead of its primary.
+    // Call before serving requests.
+    void setReplicas(std::size_t shard, const std::vector<Replica>& replicas,
+                     int sessionsPerReplica = 8, bool hedging = true);
+
+    // Runs query(DatabaseService&) read-only on the shard holding key, on
+    // one of its replicas if it has any. See ReplicaSet::read(). Throws
+    // ShardUnavailableException if the shard is not taking reads.
+    template <typename Query>
+    auto read(const std::string& key, Query query) -> decltype(query(std::declval<DatabaseService&>()));
+
+    // Streams USER rows from the primaries, like DatabaseService::exportUsers:
+    // the rows for firstName from its shard, or every shard's rows one
+    // shard after the other if firstName is empty.
+    void exportUsers(const std::string& firstName, std::size_t rowsPerFetch,
+                     const DatabaseService::RowBatchHandler& onBatch);
+
+    // One page of USER rows in key order (first name, last name, row
+    // version), starting after the given key, or at the beginning without
+    // one. Every shard is asked for a page in parallel and the pages are
+    // merged.
+    std::vector<NameRow> listUsers(const NameRow* pAfter, std::size_t pageSize);
+
+    // Looks the names up on all the shards involved in parallel, one IN
+    // query per shard, and merges the results. With a deadline, each
+    // query is bounded by it.
+    std::map<std::string, std::string> getFullNames(const std::vector<std::string>& firstNames,
+                                                    const Deadline* pDeadline = nullptr);
+
+    // Every shard's USER rows changed since its watermark, read from the
+    // primaries in parallel; see DatabaseService::loadNames(). watermarks
+    // holds one ROW_VERSION per shard (rowversion is per database), 0 to
+    // read all of a shard's rows; it is resized to the shard count and
+    // only advanced once every shard has been read. Throws
+    // ShardUnavailableException if a shard is not taking reads.
+    std::vector<NameRow> loadNames(std::vector<Poco::Int64>& watermarks);
+
+    // Every distinct USER_FNAME on any shard. Throws
+    // ShardUnavailableException if a shard is not taking reads.
+    std::vector<std::string> loadFirstNames();
+
+private:
+    struct Guard {
+        CircuitBreaker breaker;
+        ConcurrencyLimiter limiter;
+    };
+
+    // Throws ShardUnavailableException unless the shard takes the read.
+    void admit(std::size_t shard);
+    // Records how an admitted read ended; neutral outcomes (the caller's
+    // deadline, our own pool) say nothing about the database.
+    enum Outcome { SUCCEEDED, FAILED, NEUTRAL };
+    void complete(std::size_t shard, std::chrono::steady_clock::time_point start, Outcome outcome);
+
+    template <typename Query>
+    auto readShard(std::size_t shard, Query query) -> decltype(query(std::declval<DatabaseService&>()));
+
+    // Runs a whole-table read on the shard's primary, admitted like any
+    // other read, so refreshes stay off a shard that is failing.
+    void scanShard(std::size_t shard, const std::function<void(DatabaseService&)>& scan);
+
+    // Runs work(shard) for each of the shards in parallel and waits for
+    // all of them; rethrows the first exception. Shards go to the worker
+    // pool while it has threads free and otherwise run on the caller's.
+    void forEachShard(const std::vector<std::size_t>& shards, const std::function<void(std::size_t)>& work);
+
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> _ring;    // (point, shard), sorted
+    std::vector<std::unique_ptr<Poco::Data::SessionPool>> _pools;
+    std::vector<std::unique_ptr<ReplicaSet>> _replicas;              // per shard, may be null
+    std::vector<std::unique_ptr<Guard>> _guards;
+
+    Histogram& _fanOutLatency;
+    WorkerPool _workers;
+};
+
+// --- ShardRouter template implementation ---
+template <typename Query>
+auto ShardRouter::read(const std::string& key, Query query) -> decltype(query(std::declval<DatabaseService&>())) {
+    return readShard(shardFor(key), std::move(query));
+}
+
+template <typename Query>
+auto ShardRouter::readShard(std::size_t shard, Query query) -> decltype(query(std::declval<DatabaseService&>())) {
+    admit(shard);
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        auto result = [&] {
+            if (_replicas[shard]) {
+                return _replicas[shard]->read(std::move(query));
+            }
+            DatabaseService db = shardService(shard, DatabaseService::READ_ONLY);
+            return query(db);
+        }();
+        complete(shard, start, SUCCEEDED);
+        return result;
+    } catch (const Poco::TimeoutException&) {
+        complete(shard, start, NEUTRAL);
+        throw;
+    } catch (const Poco::Data::SessionPoolExhaustedException&) {
+        complete(shard, start, NEUTRAL);
+        throw;
+    } catch (...) {
+        complete(shard, start, FAILED);
+        throw;
+    }
+}
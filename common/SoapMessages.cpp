@@ -0,0 +1,432 @@
+#include "SoapMessages.hpp"
+#include "AccessLog.hpp"
+#include "ResponseWriter.hpp"
+#include <Poco/AutoPtr.h>
+#include <Poco/DOM/DOMParser.h>
+#include <Poco/DOM/Document.h>
+#include <Poco/DOM/NodeList.h>
+
+namespace {
+
+const char* const GET_NAME_RESPONSE_PREFIX =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+    "<soap:Envelope xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+    "<soap:Body>"
+    "<GetNameResponse>"
+    "<Name>";
+const char* const GET_NAME_RESPONSE_SUFFIX =
+    "</Name>"
+    "</GetNameResponse>"
+    "</soap:Body>"
+    "</soap:Envelope>";
+const char* const SOAP_FAULT_PREFIX =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+    "<soap:Envelope xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+    "<soap:Body>"
+    "<soap:Fault>";
+const char* const SOAP_FAULT_SUFFIX =
+    "</soap:Fault>"
+    "</soap:Body>"
+    "</soap:Envelope>";
+
+bool isXmlSpace(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+bool isNameStart(char ch) {
+    return (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || ch == '_';
+}
+
+bool isNameChar(char ch) {
+    return isNameStart(ch) || (ch >= '0' && ch <= '9') || ch == '-' || ch == '.';
+}
+
+// True if data is UTF-8 the XML parser would take as character data as it
+// stands: only XML characters, no reference to expand and no "]]>".
+bool isPlainText(std::string_view data) {
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        const unsigned char ch = static_cast<unsigned char>(data[i]);
+        if (ch < 0x80) {
+            if ((ch < 0x20 && !isXmlSpace(static_cast<char>(ch))) || ch == '&' || ch == '<'
+                || (ch == '>' && i >= 2 && data[i - 1] == ']' && data[i - 2] == ']')) {
+                return false;
+            }
+            continue;
+        }
+        std::size_t extra;
+        unsigned long minimum;
+        if ((ch & 0xE0) == 0xC0) {
+            extra = 1;
+            minimum = 0x80;
+        } else if ((ch & 0xF0) == 0xE0) {
+            extra = 2;
+            minimum = 0x800;
+        } else if ((ch & 0xF8) == 0xF0) {
+            extra = 3;
+            minimum = 0x10000;
+        } else {
+            return false;
+        }
+        if (data.size() - i <= extra) {
+            return false;
+        }
+        unsigned long code = ch & (0x3F >> extra);
+        for (std::size_t k = 1; k <= extra; ++k) {
+            const unsigned char next = static_cast<unsigned char>(data[i + k]);
+            if ((next & 0xC0) != 0x80) {
+                return false;
+            }
+            code = (code << 6) | (next & 0x3F);
+        }
+        if (code < minimum || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF) || code == 0xFFFE || code == 0xFFFF) {
+            return false;
+        }
+        i += extra;
+    }
+    return true;
+}
+
+const std::size_t MAX_SCAN_DEPTH = 32;
+const std::size_t MAX_SCAN_PREFIXES = 16;
+const std::size_t MAX_SCAN_ATTRIBUTES = 16;
+
+// A single pass over a request body that accepts a strict subset of
+// XML: an optional UTF-8 declaration, then elements, attributes and
+// plain text only. Each check that fails gives up on the body, and the
+// caller leaves it to the DOM parser. Fixed-size state, so scanning
+// never allocates.
+class EnvelopeScan {
+public:
+    explicit EnvelopeScan(std::string_view xml): _xml(xml) {
+    }
+
+    // True if the whole body is in the subset and well-formed, with the
+    // first Name element (document order, as getElementsByTagName
+    // returns it) holding plain text only.
+    bool firstName(std::string_view& text) {
+        if (!declaration()) {
+            return false;
+        }
+        bool found = false;
+        bool rootSeen = false;
+        std::size_t nameDepth = 0;   // depth of the open first Name, or 0
+        std::size_t textStart = 0;
+        while (_pos < _xml.size()) {
+            const std::size_t lt = _xml.find('<', _pos);
+            const std::string_view data = _xml.substr(_pos, lt == std::string_view::npos ? std::string_view::npos : lt - _pos);
+            if (_depth == 0) {
+                for (char ch : data) {
+                    if (!isXmlSpace(ch)) {
+                        return false;   // text outside the root element
+                    }
+                }
+            } else if (!isPlainText(data)) {
+                return false;
+            }
+            if (lt == std::string_view::npos) {
+                break;
+            }
+            _pos = lt + 1;
+            if (_pos < _xml.size() && _xml[_pos] == '/') {
+                ++_pos;
+                if (!endTag()) {
+                    return false;
+                }
+                if (nameDepth != 0) {
+                    text = _xml.substr(textStart, lt - textStart);
+                    if (text.find('\r') != std::string_view::npos) {
+                        return false;   // the parser would normalize line ends
+                    }
+                    found = true;
+                    nameDepth = 0;
+                }
+                continue;
+            }
+            // Comments, CDATA, processing instructions and DOCTYPE all
+            // start with '!' or '?', which is not a name start
+            if (nameDepth != 0 || (rootSeen && _depth == 0)) {
+                return false;   // Name holds an element, or a second root
+            }
+            bool empty = false;
+            std::string_view name;
+            if (!startTag(name, empty)) {
+                return false;
+            }
+            rootSeen = true;
+            if (!found && name == "Name") {
+                if (empty) {
+                    text = std::string_view();
+                    found = true;
+                } else {
+                    nameDepth = _depth;
+                    textStart = _pos;
+                }
+            }
+        }
+        return found && rootSeen && _depth == 0;
+    }
+
+private:
+    // <?xml version="1.0" [encoding="UTF-8"] [standalone="yes"|"no"]?>,
+    // which may only come first.
+    bool declaration() {
+        if (_xml.compare(0, 5, "<?xml") != 0) {
+            return true;
+        }
+        _pos = 5;
+        std::string_view names[3] = { "version", "encoding", "standalone" };
+        std::size_t next = 0;
+        for (;;) {
+            const bool space = skipSpace();
+            if (_xml.compare(_pos, 2, "?>") == 0) {
+                _pos += 2;
+                return next > 0;
+            }
+            std::string_view name;
+            std::string_view value;
+            if (!space || !attribute(name, value)) {
+                return false;
+            }
+            while (next < 3 && names[next] != name) {
+                if (next == 0) {
+                    return false;   // version is required, and first
+                }
+                ++next;
+            }
+            if (next == 3
+                || (next == 0 && value != "1.0")
+                || (next == 1 && value != "UTF-8" && value != "utf-8")
+                || (next == 2 && value != "yes" && value != "no")) {
+                return false;
+            }
+            ++next;
+        }
+    }
+
+    bool skipSpace() {
+        const std::size_t start = _pos;
+        while (_pos < _xml.size() && isXmlSpace(_xml[_pos])) {
+            ++_pos;
+        }
+        return _pos != start;
+    }
+
+    // An ASCII name with at most one colon, neither leading nor trailing
+    bool qualifiedName(std::string_view& name) {
+        const std::size_t start = _pos;
+        if (_pos >= _xml.size() || !isNameStart(_xml[_pos])) {
+            return false;
+        }
+        bool colon = false;
+        for (++_pos; _pos < _xml.size() && (isNameChar(_xml[_pos]) || _xml[_pos] == ':'); ++_pos) {
+            if (_xml[_pos] == ':') {
+                if (colon || _pos + 1 >= _xml.size() || !isNameStart(_xml[_pos + 1])) {
+                    return false;
+                }
+                colon = true;
+            }
+        }
+        name = _xml.substr(start, _pos - start);
+        return true;
+    }
+
+    // name="value" or name='value'; quote-aware, so a '>' in the value
+    // does not end the tag
+    bool attribute(std::string_view& name, std::string_view& value) {
+        if (!qualifiedName(name)) {
+            return false;
+        }
+        skipSpace();
+        if (_pos >= _xml.size() || _xml[_pos] != '=') {
+            return false;
+        }
+        ++_pos;
+        skipSpace();
+        if (_pos >= _xml.size() || (_xml[_pos] != '"' && _xml[_pos] != '\'')) {
+            return false;
+        }
+        const std::size_t close = _xml.find(_xml[_pos], _pos + 1);
+        if (close == std::string_view::npos) {
+            return false;
+        }
+        value = _xml.substr(_pos + 1, close - _pos - 1);
+        _pos = close + 1;
+        return isPlainText(value);
+    }
+
+    bool prefixDeclared(std::string_view name) const {
+        const std::size_t colon = name.find(':');
+        if (colon == std::string_view::npos) {
+            return true;
+        }
+        const std::string_view prefix = name.substr(0, colon);
+        if (prefix == "xml") {
+            return true;
+        }
+        for (std::size_t i = 0; i < _prefixCount; ++i) {
+            if (_prefixes[i] == prefix) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Just past the '<' of a start tag
+    bool startTag(std::string_view& name, bool& empty) {
+        if (!qualifiedName(name) || _depth == MAX_SCAN_DEPTH) {
+            return false;
+        }
+        std::string_view attributes[MAX_SCAN_ATTRIBUTES];
+        std::size_t attributeCount = 0;
+        const std::size_t outerPrefixes = _prefixCount;
+        for (;;) {
+            const bool space = skipSpace();
+            if (_pos >= _xml.size()) {
+                return false;
+            }
+            if (_xml[_pos] == '>' || _xml.compare(_pos, 2, "/>") == 0) {
+                empty = _xml[_pos] == '/';
+                _pos += empty ? 2 : 1;
+                break;
+            }
+            std::string_view attributeName;
+            std::string_view value;
+            if (!space || !attribute(attributeName, value) || attributeCount == MAX_SCAN_ATTRIBUTES) {
+                return false;
+            }
+            // Prefixed names are compared by local part: two prefixes
+            // may stand for the same namespace
+            const std::string_view local = attributeName.substr(attributeName.find(':') + 1);
+            for (std::size_t i = 0; i < attributeCount; ++i) {
+                if (attributes[i] == attributeName || attributes[i].substr(attributes[i].find(':') + 1) == local) {
+                    return false;
+                }
+            }
+            attributes[attributeCount++] = attributeName;
+            if (attributeName.compare(0, 6, "xmlns:") == 0) {
+                if (value.empty() || local == "xml" || local == "xmlns" || _prefixCount == MAX_SCAN_PREFIXES) {
+                    return false;
+                }
+                _prefixes[_prefixCount++] = local;
+            }
+        }
+        // Declarations count for the whole tag, wherever they stand in it
+        if (!prefixDeclared(name)) {
+            return false;
+        }
+        for (std::size_t i = 0; i < attributeCount; ++i) {
+            if (attributes[i].compare(0, 6, "xmlns:") != 0 && !prefixDeclared(attributes[i])) {
+                return false;
+            }
+        }
+        if (empty) {
+            _prefixCount = outerPrefixes;
+        } else {
+            _open[_depth] = name;
+            _outerPrefixes[_depth] = outerPrefixes;
+            ++_depth;
+        }
+        return true;
+    }
+
+    // Just past the "</" of an end tag, which must close the innermost
+    // open element
+    bool endTag() {
+        std::string_view name;
+        if (_depth == 0 || !qualifiedName(name) || name != _open[_depth - 1]) {
+            return false;
+        }
+        skipSpace();
+        if (_pos >= _xml.size() || _xml[_pos] != '>') {
+            return false;
+        }
+        ++_pos;
+        --_depth;
+        _prefixCount = _outerPrefixes[_depth];
+        return true;
+    }
+
+    std::string_view _xml;
+    std::size_t _pos = 0;
+    std::string_view _open[MAX_SCAN_DEPTH];
+    std::size_t _outerPrefixes[MAX_SCAN_DEPTH] = {};
+    std::size_t _depth = 0;
+    std::string_view _prefixes[MAX_SCAN_PREFIXES];
+    std::size_t _prefixCount = 0;
+};
+
+}
+
+void appendEscapedXml(std::string& out, std::string_view data) {
+    for (char ch : data) {
+        switch (ch) {
+            case '&':  out.append("&amp;");   break;
+            case '<':  out.append("&lt;");    break;
+            case '>':  out.append("&gt;");    break;
+            case '\"': out.append("&quot;");  break;
+            case '\'': out.append("&apos;");  break;
+            default:   out.append(1, ch);    break;
+        }
+    }
+}
+
+std::string escapeXml(const std::string& data) {
+    std::string buffer;
+    buffer.reserve(data.size());
+    appendEscapedXml(buffer, data);
+    return buffer;
+}
+
+bool findNameElement(std::string_view xml, std::string_view& text) {
+    return EnvelopeScan(xml).firstName(text);
+}
+
+std::string parseFirstNameFromXML(const std::string& xml) {
+    Poco::XML::DOMParser parser;
+    Poco::AutoPtr<Poco::XML::Document> doc = parser.parseString(xml);
+
+    Poco::AutoPtr<Poco::XML::NodeList> nameNodes = doc->getElementsByTagName("Name");
+    if (nameNodes->length() > 0) {
+        Poco::XML::Node* nameNode = nameNodes->item(0);
+        if (nameNode && nameNode->firstChild()) {
+            return nameNode->firstChild()->nodeValue();
+        }
+    }
+    return ""; // Return empty string to signify name not found
+}
+
+void makeSoapResponse(std::string& out, std::string_view fullName) {
+    out.assign(GET_NAME_RESPONSE_PREFIX);
+    appendEscapedXml(out, fullName);
+    out.append(GET_NAME_RESPONSE_SUFFIX);
+}
+
+void makeSoapFault(std::string& out, std::string_view faultCode, std::string_view faultString) {
+    out.assign(SOAP_FAULT_PREFIX);
+    out.append("<faultcode>").append(faultCode).append("</faultcode>");
+    out.append("<faultstring>");
+    appendEscapedXml(out, faultString);
+    out.append("</faultstring>");
+    out.append(SOAP_FAULT_SUFFIX);
+}
+
+std::string makeCannedFault(const std::string& faultCode, const std::string& faultString) {
+    return SOAP_FAULT_PREFIX
+           + ("<faultcode>" + faultCode + "</faultcode>"
+              "<faultstring>" + faultString + "</faultstring>")
+           + SOAP_FAULT_SUFFIX;
+}
+
+void sendSoapFault(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+                   Poco::Net::HTTPResponse::HTTPStatus status,
+                   const std::string& faultCode,
+                   const std::string& faultString) {
+    thread_local std::string faultXml;
+    makeSoapFault(faultXml, faultCode, faultString);
+    AccessLog::noteFault(faultCode);
+
+    response.setStatusAndReason(status, faultString);
+    response.setContentType(CONTENT_TYPE_SOAP_XML);
+
+    ResponseWriter(request, response).send(faultXml);
+}
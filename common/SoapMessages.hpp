@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <string>
+#include <string_view>
+
+// SOAP envelopes of the name service: escaping, reading the GetName
+// request, and building responses and faults. Separate from the handlers
+// so the benchmarks can time them on their own.
+
+const std::string CONTENT_TYPE_SOAP_XML = "application/soap+xml";
+
+// Appends data with &, <, >, " and ' escaped.
+void appendEscapedXml(std::string& out, std::string_view data);
+std::string escapeXml(const std::string& data);
+
+// Finds the text of the first <Name> element without building a DOM.
+// The whole body is scanned, and only a strict subset of XML is read:
+// balanced tags, prefixes declared on the element or an ancestor, quoted
+// attribute values, plain UTF-8 text, and at most a UTF-8 declaration
+// before the root. Anything else (entities, comments, CDATA, DOCTYPE, a
+// Name holding elements, no Name element at all) returns false, and the
+// caller falls back to parseFirstNameFromXML, so a body read here is one
+// the DOM parser accepts and answers the same way.
+bool findNameElement(std::string_view xml, std::string_view& text);
+
+// The text of the first <Name> element, by way of the DOM; empty if there
+// is none. Throws Poco::XML::XMLException if xml is not well formed.
+std::string parseFirstNameFromXML(const std::string& xml);
+
+// Replaces out with the GetName response carrying fullName. Makes no
+// allocation once out has grown to fit.
+void makeSoapResponse(std::string& out, std::string_view fullName);
+
+// Replaces out with a fault envelope; faultString is escaped.
+void makeSoapFault(std::string& out, std::string_view faultCode, std::string_view faultString);
+
+// A fault envelope whose faultString is already escaped (or needs none),
+// for faults built once and sent as they are.
+std::string makeCannedFault(const std::string& faultCode, const std::string& faultString);
+
+// Answers with a fault built in a per-thread buffer, and notes its code
+// for the access log.
+void sendSoapFault(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response,
+                   Poco::Net::HTTPResponse::HTTPStatus status,
+                   const std::string& faultCode,
+                   const std::string& faultString);
@@ -0,0 +1,235 @@
+#include "TrafficCapture.hpp"
+#include "Logger.hpp"
+#include <Poco/Exception.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// How often the writer appends what is queued
+const std::chrono::milliseconds CAPTURE_WRITE_INTERVAL(100);
+
+// Records queued beyond this are dropped rather than held in memory
+const std::size_t CAPTURE_MAX_QUEUE_BYTES = 64 * 1024 * 1024;
+
+// Request headers the services act on; everything else is left out
+const char* const CAPTURED_HEADERS[] = { "Content-Type", "SOAPAction", "Accept", "X-Deadline-Ms" };
+
+std::uint64_t microsecondsSinceEpoch(std::chrono::system_clock::time_point time) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count());
+}
+
+std::uint16_t clampToUInt16(std::size_t value) {
+    return static_cast<std::uint16_t>(std::min<std::size_t>(value, 0xFFFF));
+}
+
+}
+
+// --- TrafficCapture implementation ---
+TrafficCapture::TrafficCapture(const std::string& path, std::size_t maxBytes, std::size_t maxBodyBytes)
+    : _path(path),
+      _maxBytes(maxBytes),
+      _maxBodyBytes(std::min<std::size_t>(maxBodyBytes, 0xFFFFFFFF)),
+      _startUs(microsecondsSinceEpoch(std::chrono::system_clock::now())),
+      _reserved(0),
+      _stopping(false),
+      _captured(MetricsRegistry::instance().counter("capture_requests_total", "Requests written to the traffic capture")),
+      _dropped(MetricsRegistry::instance().counter("capture_dropped_total", "Requests left out of the traffic capture because it was full")) {
+    try {
+        _pFile.reset(new Poco::FileOutputStream(_path, std::ios::out | std::ios::binary | std::ios::trunc));
+
+        CaptureFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+        header.formatVersion = CAPTURE_FORMAT_VERSION;
+        header.startUs = _startUs;
+        _pFile->write(reinterpret_cast<const char*>(&header), sizeof(header));
+        _pFile->flush();
+        _reserved = sizeof(header);
+    } catch (const Poco::Exception& ex) {
+        logWarning("Traffic capture disabled: {}", ex.displayText());
+        _pFile.reset();
+        return;
+    }
+    logInfo("Capturing traffic to {}", _path);
+    _writer = std::thread([this] { writeLoop(); });
+}
+
+TrafficCapture::~TrafficCapture() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    if (_writer.joinable()) {
+        _writer.join();
+    }
+}
+
+bool TrafficCapture::isOpen() const {
+    return _pFile != nullptr;
+}
+
+std::size_t TrafficCapture::maxBodyBytes() const {
+    return _maxBodyBytes;
+}
+
+void TrafficCapture::append(const Poco::Net::HTTPServerRequest& request, std::chrono::system_clock::time_point start,
+                            std::chrono::steady_clock::duration elapsed, int status, const std::string& body,
+                            bool truncated) {
+    if (!_pFile) {
+        return;
+    }
+
+    std::string headers;
+    for (const char* name : CAPTURED_HEADERS) {
+        if (request.has(name)) {
+            headers.append(name).append(": ").append(request.get(name)).append("\r\n");
+        }
+    }
+    const std::string& method = request.getMethod();
+    const std::string& uri = request.getURI();
+
+    CaptureRecordHeader header;
+    std::memset(&header, 0, sizeof(header));
+    const std::uint64_t startUs = microsecondsSinceEpoch(start);
+    header.offsetUs = startUs > _startUs ? startUs - _startUs : 0;
+    header.latencyUs = static_cast<std::uint32_t>(std::min<long long>(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), 0xFFFFFFFFLL));
+    header.bodyLength = static_cast<std::uint32_t>(std::min(body.size(), _maxBodyBytes));
+    header.status = static_cast<std::uint16_t>(status);
+    header.methodLength = clampToUInt16(method.size());
+    header.uriLength = clampToUInt16(uri.size());
+    header.headersLength = clampToUInt16(headers.size());
+    header.flags = truncated || body.size() > _maxBodyBytes ? CAPTURE_BODY_TRUNCATED : 0;
+
+    std::string record(sizeof(header), '\0');
+    record.reserve(sizeof(header) + capturePayloadLength(header));
+    record.append(method, 0, header.methodLength);
+    record.append(uri, 0, header.uriLength);
+    record.append(headers, 0, header.headersLength);
+    record.append(body, 0, header.bodyLength);
+    header.crc = captureRecordChecksum(header, record.data() + sizeof(header));
+    std::memcpy(&record[0], &header, sizeof(header));
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_reserved + record.size() > _maxBytes || _queue.size() + record.size() > CAPTURE_MAX_QUEUE_BYTES) {
+            _dropped.inc();
+            return;
+        }
+        _reserved += record.size();
+        _queue += record;
+    }
+    _captured.inc();
+}
+
+void TrafficCapture::writeLoop() {
+    std::string batch;
+    for (;;) {
+        bool stopping = false;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait_for(lock, CAPTURE_WRITE_INTERVAL, [this] { return _stopping; });
+            batch.swap(_queue);
+            stopping = _stopping;
+        }
+        if (!batch.empty()) {
+            _pFile->write(batch.data(), static_cast<std::streamsize>(batch.size()));
+            _pFile->flush();
+            if (!*_pFile) {
+                logError("Traffic capture stopped, cannot write {}", _path);
+                std::lock_guard<std::mutex> lock(_mutex);
+                _reserved = _maxBytes;
+            }
+            batch.clear();
+        }
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+// --- TrafficCaptureHandler implementation ---
+TrafficCaptureHandler::TrafficCaptureHandler(Poco::Net::HTTPRequestHandler* pHandler, TrafficCapture& capture)
+    : _pHandler(pHandler), _capture(capture) {
+}
+
+void TrafficCaptureHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) {
+    // The handler keeps reading request.stream(), now through the tee; the
+    // request object itself is untouched, so ResponseWriter still finds
+    // the connection's socket
+    std::istream& in = request.stream();
+    TeeBuf tee(in.rdbuf(), _capture.maxBodyBytes());
+    std::streambuf* pSource = in.rdbuf(&tee);
+
+    const auto start = std::chrono::system_clock::now();
+    const auto started = std::chrono::steady_clock::now();
+    try {
+        _pHandler->handleRequest(request, response);
+    } catch (...) {
+        in.rdbuf(pSource);
+        throw;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - started;
+    in.rdbuf(pSource);
+
+    // Handlers that answer without reading (bad method, say) leave the
+    // body behind; replay needs it all the same. Not for a shed request:
+    // waiting on its body would hold the thread shedding was meant to
+    // free, so its record is marked truncated unless the body was read.
+    const int status = response.getStatus();
+    bool complete = true;
+    if (status == Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS
+        || status == Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE) {
+        complete = !request.getChunkedTransferEncoding()
+            && (!request.hasContentLength()
+                || static_cast<Poco::Int64>(tee.copy().size()) >= request.getContentLength64());
+    } else {
+        try {
+            tee.drain();
+        } catch (const Poco::Exception&) {
+            // Client went away; keep what was read
+        }
+    }
+    _capture.append(request, start, elapsed, status, tee.copy(), tee.truncated() || !complete);
+}
+
+TrafficCaptureHandler::TeeBuf::TeeBuf(std::streambuf* pSource, std::size_t maxCopy)
+    : _pSource(pSource), _maxCopy(maxCopy), _truncated(false) {
+    setg(_buffer, _buffer, _buffer);
+}
+
+TrafficCaptureHandler::TeeBuf::int_type TrafficCaptureHandler::TeeBuf::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    // Waits for one byte at most, then takes only what has arrived: the
+    // handler may need the first part of the body before the client
+    // sends the rest
+    if (traits_type::eq_int_type(_pSource->sgetc(), traits_type::eof())) {
+        return traits_type::eof();
+    }
+    const std::streamsize available = std::min<std::streamsize>(
+        std::max<std::streamsize>(_pSource->in_avail(), 1), sizeof(_buffer));
+    const std::streamsize n = _pSource->sgetn(_buffer, available);
+    if (n <= 0) {
+        return traits_type::eof();
+    }
+    const std::size_t room = _maxCopy - std::min(_copy.size(), _maxCopy);
+    if (static_cast<std::size_t>(n) > room) {
+        _truncated = true;
+    }
+    _copy.append(_buffer, std::min(static_cast<std::size_t>(n), room));
+    setg(_buffer, _buffer, _buffer + n);
+    return traits_type::to_int_type(*gptr());
+}
+
+void TrafficCaptureHandler::TeeBuf::drain() {
+    // Whatever the handler left in the get area was copied already
+    setg(_buffer, _buffer, _buffer);
+    while (!_truncated && underflow() != traits_type::eof()) {
+        setg(_buffer, _buffer, _buffer);
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "TrafficCaptureFormat.hpp"
+#include "Metrics.hpp"
+#include <Poco/FileStream.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+// Opt-in capture of whole requests to a file, for the replay tool (see
+// TrafficCaptureFormat.hpp).
+//
+// Request threads only serialize their record and queue it; a writer
+// thread appends whatever is queued every CAPTURE_WRITE_INTERVAL. The
+// file is replaced when the capture starts and stops growing at maxBytes;
+// requests after that, or while the queue is over its limit, are counted
+// in capture_dropped_total and not recorded. Only the headers the
+// services act on are kept, and never X-API-Key or the client address,
+// so a replay cannot reproduce per-client rate limits. The unread body of
+// a request answered with 429 or 503 is not waited for; such a record is
+// marked truncated.
+class TrafficCapture {
+public:
+    explicit TrafficCapture(const std::string& path, std::size_t maxBytes = 1024 * 1024 * 1024,
+                            std::size_t maxBodyBytes = 1024 * 1024);
+
+    // Writes what is still queued, then stops the writer.
+    ~TrafficCapture();
+
+    TrafficCapture(const TrafficCapture&) = delete;
+    TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+    bool isOpen() const;
+    std::size_t maxBodyBytes() const;
+
+    void append(const Poco::Net::HTTPServerRequest& request, std::chrono::system_clock::time_point start,
+                std::chrono::steady_clock::duration elapsed, int status, const std::string& body, bool truncated);
+
+private:
+    void writeLoop();
+
+    const std::string _path;
+    const std::size_t _maxBytes;
+    const std::size_t _maxBodyBytes;
+    std::uint64_t _startUs;
+
+    std::unique_ptr<Poco::FileOutputStream> _pFile;
+    std::size_t _reserved;              // bytes written or queued
+
+    mutable std::mutex _mutex;
+    std::condition_variable _wake;
+    std::string _queue;
+    bool _stopping;
+    std::thread _writer;
+
+    Counter& _captured;
+    Counter& _dropped;
+};
+
+// Runs a request handler with the request body copied, as the handler
+// reads it, and appends the request to the capture once it has returned.
+class TrafficCaptureHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    // Takes ownership of pHandler.
+    TrafficCaptureHandler(Poco::Net::HTTPRequestHandler* pHandler, TrafficCapture& capture);
+
+    void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override;
+
+private:
+    // Passes reads through to the request's own buffer and keeps a copy
+    class TeeBuf : public std::streambuf {
+    public:
+        TeeBuf(std::streambuf* pSource, std::size_t maxCopy);
+
+        const std::string& copy() const { return _copy; }
+        bool truncated() const { return _truncated; }
+
+        // Reads and copies what the handler left unread, up to the limit
+        void drain();
+
+    protected:
+        int_type underflow() override;
+
+    private:
+        std::streambuf* _pSource;
+        const std::size_t _maxCopy;
+        std::string _copy;
+        bool _truncated;
+        char _buffer[8192];
+    };
+
+    std::unique_ptr<Poco::Net::HTTPRequestHandler> _pHandler;
+    TrafficCapture& _capture;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Poco/Checksum.h>
+#include <cstddef>
+#include <cstdint>
+
+// On-disk layout of a traffic capture, shared by the services that write
+// it and the replay tool that reads it.
+//
+// A capture file is a CaptureFileHeader followed by records, each a
+// CaptureRecordHeader and then its method, URI, header block and body,
+// unterminated, in that order. Records are in the order requests
+// finished, not the order they started; offsetUs gives the start. Numbers
+// are in host byte order (little-endian on every platform we build for).
+// A record whose CRC-32 does not match ends the file, which drops any
+// record a crash left half written.
+
+const char CAPTURE_MAGIC[8] = { 'T', 'R', 'A', 'F', 'F', 'C', 'A', 'P' };
+const std::uint32_t CAPTURE_FORMAT_VERSION = 1;
+
+struct CaptureFileHeader {
+    char magic[8];
+    std::uint32_t formatVersion;
+    std::uint32_t reserved1;
+    std::uint64_t startUs;          // capture start, microseconds since the epoch
+    char reserved2[8];
+};
+
+enum CaptureFlags : std::uint8_t {
+    CAPTURE_BODY_TRUNCATED = 1      // body cut at the capture's size limit
+};
+
+struct CaptureRecordHeader {
+    std::uint64_t offsetUs;         // request start, microseconds after the capture started
+    std::uint32_t latencyUs;        // handler start to response sent
+    std::uint32_t bodyLength;
+    std::uint16_t status;
+    std::uint16_t methodLength;
+    std::uint16_t uriLength;
+    std::uint16_t headersLength;    // "Name: value\r\n" lines
+    std::uint8_t flags;             // CaptureFlags
+    char reserved[3];
+    std::uint32_t crc;              // CRC-32 of everything above, then the payload
+};
+
+static_assert(sizeof(CaptureFileHeader) == 32, "CaptureFileHeader layout");
+static_assert(sizeof(CaptureRecordHeader) == 32, "CaptureRecordHeader layout");
+
+inline std::size_t capturePayloadLength(const CaptureRecordHeader& header) {
+    return static_cast<std::size_t>(header.methodLength) + header.uriLength + header.headersLength + header.bodyLength;
+}
+
+inline std::uint32_t captureRecordChecksum(const CaptureRecordHeader& header, const char* payload) {
+    Poco::Checksum crc32(Poco::Checksum::TYPE_CRC32);
+    crc32.update(reinterpret_cast<const char*>(&header), static_cast<unsigned>(offsetof(CaptureRecordHeader, crc)));
+    crc32.update(payload, static_cast<unsigned>(capturePayloadLength(header)));
+    return crc32.checksum();
+}
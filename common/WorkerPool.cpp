@@ -0,0 +1,59 @@
+#include "WorkerPool.hpp"
+#include "Logger.hpp"
+#include <Poco/Exception.h>
+#include <Poco/Runnable.h>
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace {
+
+// Threads kept alive while idle, and how long an idle one is kept
+const int MIN_IDLE_THREADS = 2;
+const int IDLE_SECONDS = 60;
+
+// Owns one work item and deletes itself once it has run.
+class Task : public Poco::Runnable {
+public:
+    explicit Task(std::function<void()> work)
+        : _work(std::move(work)) {
+    }
+
+    void run() override {
+        try {
+            _work();
+        } catch (const std::exception& ex) {
+            logError("Worker task failed: {}", ex.what());
+        } catch (...) {
+            logError("Worker task failed");
+        }
+        delete this;
+    }
+
+private:
+    std::function<void()> _work;
+};
+
+}
+
+// --- WorkerPool implementation ---
+WorkerPool::WorkerPool(const std::string& name, int maxThreads)
+    : _pool(name, std::min(MIN_IDLE_THREADS, maxThreads), maxThreads, IDLE_SECONDS),
+      _busy(MetricsRegistry::instance().counter("worker_pool_busy_total", "Work refused because every pool thread was busy")) {
+}
+
+WorkerPool::~WorkerPool() {
+    _pool.joinAll();
+}
+
+bool WorkerPool::tryRun(std::function<void()> work) {
+    Task* pTask = new Task(std::move(work));
+    try {
+        _pool.start(*pTask);
+        return true;
+    } catch (const Poco::NoThreadAvailableException&) {
+        delete pTask;
+        _busy.inc();
+        return false;
+    }
+}
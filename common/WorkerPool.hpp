@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Metrics.hpp"
+#include <Poco/ThreadPool.h>
+#include <functional>
+#include <string>
+
+// A bounded set of threads for short pieces of request work (parallel
+// shard queries, hedged reads), so that a burst of requests cannot start
+// a thread each. When every thread is busy, tryRun() refuses the work and
+// the caller runs it itself or does without.
+class WorkerPool {
+public:
+    WorkerPool(const std::string& name, int maxThreads);
+    // Waits for work still running.
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Starts work on an idle thread. Returns false, without running it,
+    // if all maxThreads are busy. Exceptions thrown by work are logged and
+    // dropped.
+    bool tryRun(std::function<void()> work);
+
+private:
+    Poco::ThreadPool _pool;
+    Counter& _busy;
+};
@@ -0,0 +1,118 @@
+#include "BenchHttp.hpp"
+#include "Deadline.hpp"
+#include "NameService.hpp"
+#include "PersistentNameCache.hpp"
+#include "ShardRouter.hpp"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/TemporaryFile.h"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// NameRequestHandler::handleRequest as the server runs it: keep-alive
+// POSTs over loopback to an in-process HTTPServer, answered from the
+// persistent cache, so no database is needed. The target defines
+// SOAP_ALLOCATION_CHECK, so a steady-state lookup that allocates aborts
+// the run with "GetName hot path allocated".
+
+const int CACHED_NAMES = 256;
+
+std::string cachedFirstName(int i) {
+    return "first" + std::to_string(i);
+}
+
+// Never queried: every name asked for is in the cache. Its session pool
+// opens no connection until a session is taken.
+ShardRouter& router() {
+    static ShardRouter instance({ "DSN=getname_bench_unused" }, 1);
+    return instance;
+}
+
+// Filled once with every name the benchmarks ask for
+PersistentNameCache& cache() {
+    static Poco::TemporaryFile file;
+    static std::unique_ptr<PersistentNameCache> pCache;
+    if (!pCache) {
+        pCache.reset(new PersistentNameCache(file.path()));
+        for (int i = 0; i < CACHED_NAMES; ++i) {
+            pCache->store(cachedFirstName(i), cachedFirstName(i) + " last" + std::to_string(i));
+        }
+    }
+    return *pCache;
+}
+
+class GetNameHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+    Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest&) override {
+        return new NameRequestHandler(router(), Deadline(std::chrono::seconds(5)), nullptr, &cache());
+    }
+};
+
+// One server on an ephemeral port for the whole run
+Poco::UInt16 getNameServerPort() {
+    static std::unique_ptr<Poco::Net::HTTPServer> pServer;
+    if (!pServer) {
+        cache();
+        Poco::Net::ServerSocket socket(Poco::Net::SocketAddress("127.0.0.1", 0));
+        Poco::Net::HTTPServerParams* params = new Poco::Net::HTTPServerParams;
+        params->setKeepAlive(true);
+        params->setMaxKeepAliveRequests(0);
+        pServer.reset(new Poco::Net::HTTPServer(new GetNameHandlerFactory, socket, params));
+        pServer->start();
+    }
+    return pServer->port();
+}
+
+// A GetName request for name. With a comment in the envelope the scan
+// gives up and the handler falls back to the DOM parser.
+std::string makeRequest(const std::string& name, bool withComment) {
+    const std::string body =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<soap:Envelope xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+        + std::string(withComment ? "<!-- bench -->" : "")
+        + "<soap:Body><GetName><Name>" + name + "</Name></GetName></soap:Body></soap:Envelope>";
+    return "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/soap+xml\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// range(0) is 0 for envelopes the scan reads, 1 for ones that need the DOM
+// parser (which allocates, and so is not checked).
+void BM_GetNameFromCache(benchmark::State& state) {
+    const bool withComment = state.range(0) != 0;
+    std::vector<std::string> requests;
+    for (int i = 0; i < CACHED_NAMES; ++i) {
+        requests.push_back(makeRequest(cachedFirstName(i), withComment));
+    }
+    Poco::Net::StreamSocket socket(Poco::Net::SocketAddress("127.0.0.1", getNameServerPort()));
+    socket.setNoDelay(true);
+    std::string reply;
+
+    std::size_t next = 0;
+    for (auto _ : state) {
+        const std::string& request = requests[next];
+        socket.sendBytes(request.data(), static_cast<int>(request.size()));
+        if (!readResponse(socket, reply)) {
+            state.SkipWithError("Server closed the connection");
+            return;
+        }
+        if (reply.compare(0, 12, "HTTP/1.1 200") != 0) {
+            state.SkipWithError("GetName did not answer 200");
+            return;
+        }
+        next = (next + 1) % requests.size();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+} // namespace
+
+BENCHMARK(BM_GetNameFromCache)->Arg(0)->Arg(1)->ArgName("dom")->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -1,299 +1,726 @@
-Based on the provided `NameService.hpp` and `NameService.cpp` code, you want to integrate a database connection and `SELECT` query into your SOAP service. Here's a revised `NameService.cpp` that incorporates a new database-related class, `DatabaseService`, and uses it to fetch a full name based on a given first name from the SOAP request.
-
------
-
-### `NameService.cpp` (Revised)
-
-This code introduces a `DatabaseService` class to encapsulate the database logic, keeping your `NameRequestHandler` clean. The `NameRequestHandler::processNameFromXML` method will now use this service to query the database.
-
-```cpp
 #include "NameService.hpp"
+#include "AccessLog.hpp"
+#include "AdmissionControl.hpp"
+#include "AllocationCounter.hpp"
+#include "MetricsHandler.hpp"
+#include "RateLimiter.hpp"
+#include "ResponseWriter.hpp"
+#include "ShardRouter.hpp"
+#include "SoapMessages.hpp"
+#include "DatabaseService.hpp"
+#include "LookupBatcher.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "NameFilter.hpp"
+#include "NameIndex.hpp"
+#include "NameSearchIndex.hpp"
+#include "PersistentNameCache.hpp"
+#include "TrafficCapture.hpp"
+#include <Poco/Data/DataException.h>
 #include <Poco/DOM/DOMParser.h>
 #include <Poco/DOM/Document.h>
 #include <Poco/DOM/NodeList.h>
 #include <Poco/XML/XMLWriter.h>
+#include <Poco/Net/HTTPServerRequestImpl.h>
 #include <Poco/Net/NetException.h>
-#include <Poco/Data/Session.h>
-#include <Poco/Data/ODBC/Connector.h>
-#include <Poco/Data/Statement.h>
-#include <Poco/Data/RecordSet.h>
-#include <Poco/Data/DataException.h>
+#include <Poco/Base64Decoder.h>
+#include <Poco/Base64Encoder.h>
+#include <Poco/NumberParser.h>
+#include <Poco/Bugcheck.h>
+#include <Poco/StreamCopier.h>
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
+#include <string_view>
 
 using namespace std;
 using namespace Poco;
 using namespace Poco::Net;
 using namespace Poco::XML;
-using namespace Poco::Data;
 
-// --- DatabaseService Class ---
-// Encapsulates all database-related logic to keep the HTTP handler clean.
-class DatabaseService {
-public:
-    DatabaseService() {
-        Poco::Data::ODBC::Connector::registerConnector();
-    }
-    
-    // Connects to the database
-    bool connect() {
-        try {
-            const string connectionString =
-                "DRIVER={ODBC Driver 17 for SQL Server};"
-                "SERVER=PR-BACHLITZANA;"
-                "DATABASE=FIDUCIAM_PROD;"
-                "UID=db2admin;"
-                "PWD=db2admin1;";
-            
-            _session = new Poco::Data::Session("ODBC", connectionString);
-            _session->setFeature("autoCommit", false); 
-            return true;
-        } catch (...) {
-            cerr << "Database connection error: \n" ;
-            return false;
-        }
-    }
+// --- Constants for common strings ---
+const string METHOD_NOT_ALLOWED_MSG = "Only POST method is supported";
+const string NAME_NOT_FOUND_MSG = "Name not found in request";
+const string ERROR_PROCESSING_NAME_MSG = "Error processing name: ";
+const string DB_CONNECTION_FAILED_MSG = "Failed to connect to the database.";
+const string DB_QUERY_FAILED_MSG = "Database query failed.";
+const string DB_UNAVAILABLE_MSG = "Database temporarily unavailable, retry later.";
+const string OVERLOADED_MSG = "Server is overloaded, retry later.";
+const string RATE_LIMITED_MSG = "Rate limit exceeded, retry later.";
+const string SEARCH_QUERY_MISSING_MSG = "Query not found in request";
+const string SEARCH_UNAVAILABLE_MSG = "Name search is not enabled on this server.";
+const string DEADLINE_EXCEEDED_MSG = "Deadline exceeded";
 
-    bool BeginTransaction() {
-    if (m_session && m_session->isConnected()) {
-        try {
-            // Poco's autocommit=false handles the transaction beginning implicitly.
-            // You can, however, use a specific SQL command if needed.
-            // For most use cases, just performing the first database operation will start it.
-            std::cout << "Transaction began." << std::endl;
-            return true;
-        } catch (const Poco::Exception& ex) {
-            m_errorMessage = "ERR_BEGIN_TRANSACTION: " + ex.message();
-            std::cerr << m_errorMessage << std::endl;
-            return false;
-        }
-    }
-    return false;
+// --- ExportUsers ---
+// Rows fetched per ODBC row array, and so written per chunk
+const size_t EXPORT_ROWS_PER_FETCH = 1000;
+
+// --- ListUsers limits ---
+const size_t LIST_DEFAULT_PAGE_SIZE = 50;
+const size_t LIST_MAX_PAGE_SIZE = 500;
+const string INVALID_CURSOR_MSG = "Cursor is not valid";
+
+// --- SearchNames limits ---
+const size_t SEARCH_DEFAULT_RESULTS = 10;
+const size_t SEARCH_MAX_RESULTS = 100;
+const unsigned SEARCH_DEFAULT_DISTANCE = 2;
+const unsigned SEARCH_MAX_DISTANCE = 3;
+
+// Request bodies are read this much at a time
+const size_t BODY_READ_CHUNK = 1024;
+
+// --- GetName hot path helpers ---
+// Per-thread buffers for GetName. Handlers run on the server's pooled
+// threads, so once a thread's buffers have grown to fit, a lookup served
+// from memory makes no heap allocations of its own.
+struct GetNameBuffers {
+    string body;
+    string firstName;
+    string lastName;
+    string fullName;
+    string message;
+    string response;
+    bool warm = false;
+
+    GetNameBuffers() {
+        body.reserve(4 * BODY_READ_CHUNK);
+        firstName.reserve(128);
+        lastName.reserve(128);
+        fullName.reserve(256);
+        message.reserve(256);
+        response.reserve(1024);
     }
 
-    bool CommitTransaction() {
-    if (m_session && m_session->isConnected()) {
-        try {
-            // Commit the transaction and save all changes
-            m_session->commit();
-            std::cout << "Transaction committed successfully!" << std::endl;
-            return true;
-        } catch (const Poco::Exception& ex) {
-            m_errorMessage = "ERR_COMMIT_TRANSACTION: " + ex.message();
-            std::cerr << m_errorMessage << std::endl;
-            return false;
-        }
+    size_t capacity() const {
+        return body.capacity() + firstName.capacity() + lastName.capacity()
+            + fullName.capacity() + message.capacity() + response.capacity();
     }
-    return false;
+};
+
+GetNameBuffers& getNameBuffers() {
+    thread_local GetNameBuffers buffers;
+    return buffers;
+}
+
+// Reads the whole body into the reused buffer.
+void readBody(istream& in, string& body) {
+    body.clear();
+    while (in) {
+        const size_t used = body.size();
+        body.resize(used + BODY_READ_CHUNK);
+        in.read(&body[used], static_cast<streamsize>(BODY_READ_CHUNK));
+        body.resize(used + static_cast<size_t>(in.gcount()));
     }
+}
 
-    bool RollbackTransaction() {
-    if (m_session && m_session->isConnected()) {
-        try {
-            // Rollback the transaction and undo all changes
-            m_session->rollback();
-            std::cout << "Transaction rolled back!" << std::endl;
-            return true;
-        } catch (const Poco::Exception& ex) {
-            m_errorMessage = "ERR_ROLLBACK_TRANSACTION: " + ex.message();
-            std::cerr << m_errorMessage << std::endl;
-            return false;
+// Bounds reads from the request's socket by a deadline, and puts the
+// connection's own receive timeout back however the read ends, so a
+// kept-alive connection does not inherit one request's deadline.
+class ReceiveTimeoutGuard {
+public:
+    ReceiveTimeoutGuard(HTTPServerRequest& request, const Deadline& deadline)
+        : _pImpl(dynamic_cast<HTTPServerRequestImpl*>(&request)) {
+        if (_pImpl) {
+            _previous = _pImpl->socket().getReceiveTimeout();
+            _pImpl->socket().setReceiveTimeout(Timespan(std::max<Timespan::TimeDiff>(deadline.remaining().count(), 1) * 1000));
         }
     }
-    return false;
-    }
 
-    
-    // Fetches the full name for a given first name
-    string getFullName(const string& firstName) {
-        if (!_session) {
-            throw runtime_error("Database session is not connected.");
-        }
-        
-        try {
-            string fullName;
-            string userLName;
-            
-            Statement select(*_session);
-            select << "SELECT USER_LNAME FROM [dbo].[USER] WHERE USER_FNAME = ?",
-                Keywords::into(userLName),
-                Keywords::use(firstName),
-                Keywords::limit(1); // Ensure only one result is returned
-
-            select.execute();
-            
-            RecordSet rs(select);
-            if (!rs.empty()) {
-                fullName = firstName + " " + userLName;
-                return fullName;
-            } else {
-                return ""; // Not found
+    ~ReceiveTimeoutGuard() {
+        if (_pImpl) {
+            try {
+                _pImpl->socket().setReceiveTimeout(_previous);
+            } catch (const Exception&) {
+                // The connection is gone; nothing left to restore
             }
-        } catch (const DataException& e) {
-            cerr << "Query execution error: " << e.displayText() << endl;
-            throw; // Re-throw to be caught by the main handler
         }
     }
-    
-    // Disconnects from the database
-    void disconnect() {
-        _session = nullptr;
-    }
+
+    ReceiveTimeoutGuard(const ReceiveTimeoutGuard&) = delete;
+    ReceiveTimeoutGuard& operator=(const ReceiveTimeoutGuard&) = delete;
 
 private:
-    AutoPtr<Poco::Data::Session> _session;
+    HTTPServerRequestImpl* _pImpl;
+    Timespan _previous;
 };
 
-// --- Constants for common strings ---
-const string METHOD_NOT_ALLOWED_MSG = "Only POST method is supported";
-const string CONTENT_TYPE_SOAP_XML = "application/soap+xml";
-const string NAME_NOT_FOUND_MSG = "Name not found in request";
-const string ERROR_PROCESSING_NAME_MSG = "Error processing name: ";
-const string DB_CONNECTION_FAILED_MSG = "Failed to connect to the database.";
-const string DB_QUERY_FAILED_MSG = "Database query failed.";
-
-// --- Helper function for XML escaping (simple, for illustration) ---
-string escapeXml(const string& data) {
-    string buffer;
-    buffer.reserve(data.size());
-    for (char ch : data) {
-        switch (ch) {
-            case '&':  buffer.append("&amp;");   break;
-            case '<':  buffer.append("&lt;");    break;
-            case '>':  buffer.append("&gt;");    break;
-            case '\"': buffer.append("&quot;");  break;
-            case '\'': buffer.append("&apos;");  break;
-            default:   buffer.append(1, ch);    break;
-        }
+// With SOAP_ALLOCATION_CHECK, a steady-state lookup served from memory
+// that allocated is a bug: count it and fail the request loudly.
+void checkNoAllocations(uint64_t before) {
+    if (!AllocationCounter::enabled()) {
+        return;
+    }
+    const uint64_t allocations = AllocationCounter::thisThread() - before;
+    if (allocations != 0) {
+        static Counter& counter = MetricsRegistry::instance().counter(
+            "getname_hot_path_allocations_total", "Heap allocations made by steady-state GetName lookups served from memory");
+        counter.inc(allocations);
+        poco_bugcheck_msg("GetName hot path allocated");
     }
-    return buffer;
+}
+
+Counter& deadlineExceededCounter() {
+    static Counter& counter = MetricsRegistry::instance().counter(
+        "deadline_exceeded_total", "Requests abandoned because their deadline passed");
+    return counter;
 }
 
 // --- NameRequestHandler implementation ---
+NameRequestHandler::NameRequestHandler(ShardRouter& router, const Deadline& deadline, const NameIndex* pIndex,
+                                       PersistentNameCache* pCache, NameFilter* pFilter, LookupBatcher* pBatcher)
+    : _router(router), _deadline(deadline), _pIndex(pIndex), _pCache(pCache), _pFilter(pFilter),
+      _pBatcher(pBatcher) {
+}
+
 void NameRequestHandler::handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) {
     if (request.getMethod() != HTTPRequest::HTTP_POST) {
-        sendSoapFault(response, HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "Client.InvalidMethod", METHOD_NOT_ALLOWED_MSG);
+        sendSoapFault(request, response, HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "Client.InvalidMethod", METHOD_NOT_ALLOWED_MSG);
         return;
     }
 
-    string requestBody;
+    GetNameBuffers& buffers = getNameBuffers();
+    const bool warm = buffers.warm;
+    const size_t capacity = buffers.capacity();
+    const uint64_t allocationsBefore = AllocationCounter::thisThread();
+
     try {
-        request.stream() >> requestBody;
-        if (requestBody.empty()) {
-            sendSoapFault(response, HTTPResponse::HTTP_BAD_REQUEST, "Client.EmptyRequest", "Request body is empty.");
+        _deadline.check("reading the request");
+
+        // A slow client may not hold the request past its deadline
+        {
+            ReceiveTimeoutGuard receiveTimeout(request, _deadline);
+            readBody(request.stream(), buffers.body);
+        }
+        if (buffers.body.empty()) {
+            sendSoapFault(request, response, HTTPResponse::HTTP_BAD_REQUEST, "Client.EmptyRequest", "Request body is empty.");
             return;
         }
+    } catch (const TimeoutException& e) {
+        sendDeadlineFault(request, response, e.message());
+        return;
     } catch (const NetException& e) {
-        sendSoapFault(response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.ReadError", "Failed to read request body: " + string(e.what()));
+        sendSoapFault(request, response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.ReadError", "Failed to read request body: " + string(e.what()));
         return;
     } catch (const exception& e) {
-        sendSoapFault(response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.ReadError", "An unexpected error occurred while reading request body: " + string(e.what()));
+        sendSoapFault(request, response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.ReadError", "An unexpected error occurred while reading request body: " + string(e.what()));
         return;
     }
-    
-    string firstName;
+
+    // Points into buffers.body, or buffers.firstName if the DOM parser
+    // had to be used. Only the scan and the in-memory lookups are steady
+    // state; the DOM parse and a database round trip allocate.
+    string_view firstName;
+    bool fromMemory = true;
     try {
-        firstName = parseFirstNameFromXML(requestBody);
+        _deadline.check("parsing the request");
+        if (!findNameElement(buffers.body, firstName)) {
+            fromMemory = false;
+            buffers.firstName = parseFirstNameFromXML(buffers.body);
+            firstName = buffers.firstName;
+        }
+    } catch (const TimeoutException& e) {
+        sendDeadlineFault(request, response, e.message());
+        return;
     } catch (const XML::XMLException& e) {
-        sendSoapFault(response, HTTPResponse::HTTP_BAD_REQUEST, "Client.InvalidXML", "Invalid XML format: " + string(e.what()));
+        sendSoapFault(request, response, HTTPResponse::HTTP_BAD_REQUEST, "Client.InvalidXML", "Invalid XML format: " + string(e.what()));
         return;
     } catch (const exception& e) {
-        sendSoapFault(response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.ProcessingError", ERROR_PROCESSING_NAME_MSG + string(e.what()));
+        sendSoapFault(request, response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.ProcessingError", ERROR_PROCESSING_NAME_MSG + string(e.what()));
         return;
     }
 
     if (firstName.empty()) {
-        sendSoapFault(response, HTTPResponse::HTTP_BAD_REQUEST, "Client.NameNotFound", NAME_NOT_FOUND_MSG);
+        sendSoapFault(request, response, HTTPResponse::HTTP_BAD_REQUEST, "Client.NameNotFound", NAME_NOT_FOUND_MSG);
         return;
     }
 
-    string fullName;
-    DatabaseService dbService;
-    if (!dbService.connect()) {
-        sendSoapFault(response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.DatabaseError", DB_CONNECTION_FAILED_MSG);
-        return;
-    }
+    string& fullName = buffers.fullName;
+    fullName.clear();
+    // Served from memory, no database round trip, unless the index cannot
+    // tell (see NameIndex)
+    const NameIndex::Answer indexed = _pIndex ? _pIndex->lookup(firstName, buffers.lastName) : NameIndex::UNSURE;
+    if (indexed == NameIndex::FOUND) {
+        fullName.append(firstName).append(1, ' ').append(buffers.lastName);
+    } else if (indexed == NameIndex::NOT_FOUND) {
+        // Certainly not in the table
+    } else if (_pFilter && !_pFilter->mightContain(firstName)) {
+        // Certainly not in the table; no need to ask the database
+    } else if (_pCache && _pCache->lookup(firstName, fullName)) {
+        // Cache hit, possibly left by a previous run
+    } else {
+        // A lookup is a single autocommitted SELECT on the name's shard (or
+        // one of its replicas), over a pooled session; nothing to commit.
+        // The driver cancels it when the deadline passes. With the batcher,
+        // concurrent lookups share one IN query instead.
+        fromMemory = false;
+        const string key(firstName);
+        const Deadline deadline = _deadline;
+        try {
+            if (_pBatcher) {
+                fullName = _pBatcher->getFullName(key, deadline);
+            } else {
+                fullName = _router.read(key, [key, deadline](DatabaseService& db) {
+                    deadline.check("querying the database");
+                    db.setQueryTimeout(deadline.remaining());
+                    return db.getFullName(key);
+                });
+            }
+        } catch (const TimeoutException& e) {
+            sendDeadlineFault(request, response, e.message());
+            return;
+        } catch (const ShardUnavailableException&) {
+            // Failing fast while the database recovers
+            response.set("Retry-After", "1");
+            sendSoapFault(request, response, HTTPResponse::HTTP_SERVICE_UNAVAILABLE, "Server.DatabaseError", DB_UNAVAILABLE_MSG);
+            return;
+        } catch (const Poco::Data::SessionPoolExhaustedException&) {
+            sendSoapFault(request, response, HTTPResponse::HTTP_SERVICE_UNAVAILABLE, "Server.DatabaseError", DB_CONNECTION_FAILED_MSG);
+            return;
+        } catch (const exception& e) {
+            if (_deadline.expired()) {
+                // Most likely the query timeout we set
+                sendDeadlineFault(request, response, DEADLINE_EXCEEDED_MSG + " during the database query");
+                return;
+            }
+            sendSoapFault(request, response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.DatabaseError", DB_QUERY_FAILED_MSG);
+            return;
+        }
 
-    try {
-        fullName = dbService.getFullName(firstName);
-    } catch (const exception& e) {
-        dbService.disconnect();
-        sendSoapFault(response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.DatabaseError", DB_QUERY_FAILED_MSG);
-        return;
-    }
-    
-    if (!CommitTransaction()){
-           auto Rollback =  RollbackTransaction();
+        if (_pCache && !fullName.empty()) {
+            _pCache->store(key, fullName);
+        }
+        if (_pFilter && fullName.empty()) {
+            _pFilter->falsePositive();
+        }
     }
-    dbService.disconnect();
 
     if (fullName.empty()) {
-        sendSoapFault(response, HTTPResponse::HTTP_NOT_FOUND, "Client.NameNotFoundInDB", "The name '" + firstName + "' was not found in the database.");
+        string& message = buffers.message;
+        message.assign("The name '").append(firstName).append("' was not found in the database.");
+        sendSoapFault(request, response, HTTPResponse::HTTP_NOT_FOUND, "Client.NameNotFoundInDB", message);
         return;
     }
-    
-    string responseXml = makeSoapResponse(escapeXml(fullName));
-    
+
+    string& responseXml = buffers.response;
+    makeSoapResponse(responseXml, fullName);
+
+    // Poco's response headers allocate on their own, so they are set here
+    // and left out of the count; send() only rewrites them in place. The
+    // rest, up to the bytes on the socket, is ours. The buffers being warm
+    // and big enough is steady state.
+    buffers.warm = true;
+    const uint64_t allocationsBeforeHeaders = AllocationCounter::thisThread();
     response.setStatus(HTTPResponse::HTTP_OK);
     response.setContentType(CONTENT_TYPE_SOAP_XML);
-    response.setContentLength(responseXml.length());
-    
-    ostream& out = response.send();
-    out << responseXml;
+    response.setContentLength(responseXml.size());
+    const uint64_t headerAllocations = AllocationCounter::thisThread() - allocationsBeforeHeaders;
+
+    ResponseWriter(request, response).send(responseXml);
+    if (fromMemory && warm && buffers.capacity() == capacity) {
+        checkNoAllocations(allocationsBefore + headerAllocations);
+    }
 }
 
-string NameRequestHandler::parseFirstNameFromXML(const string& xml) {
-    XML::DOMParser parser;
-    AutoPtr<XML::Document> doc = parser.parseString(xml);
-    
-    AutoPtr<XML::NodeList> nameNodes = doc->getElementsByTagName("Name");
-    if (nameNodes->length() > 0) {
-        XML::Node* nameNode = nameNodes->item(0);
-        if (nameNode && nameNode->firstChild()) {
-            return nameNode->firstChild()->nodeValue();
-        }
+void NameRequestHandler::sendDeadlineFault(HTTPServerRequest& request, HTTPServerResponse& response, const string& message) {
+    deadlineExceededCounter().inc();
+    sendSoapFault(request, response, HTTPResponse::HTTP_GATEWAY_TIMEOUT, "Server.DeadlineExceeded", message);
+}
+
+// --- OverloadFaultHandler implementation ---
+// Built once: rejecting has to stay cheap when the server is already behind.
+const string OVERLOADED_FAULT_XML = makeCannedFault("Server.Overloaded", OVERLOADED_MSG);
+const string RATE_LIMITED_FAULT_XML = makeCannedFault("Client.RateLimited", RATE_LIMITED_MSG);
+
+OverloadFaultHandler::OverloadFaultHandler(HTTPResponse::HTTPStatus status, int retryAfterSeconds)
+    : _status(status), _retryAfterSeconds(retryAfterSeconds) {
+}
+
+void OverloadFaultHandler::handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) {
+    const bool rateLimited = _status == HTTPResponse::HTTP_TOO_MANY_REQUESTS;
+    const string& faultXml = rateLimited ? RATE_LIMITED_FAULT_XML : OVERLOADED_FAULT_XML;
+    AccessLog::noteFault(rateLimited ? "Client.RateLimited" : "Server.Overloaded");
+
+    response.setStatusAndReason(_status, rateLimited ? RATE_LIMITED_MSG : OVERLOADED_MSG);
+    response.set("Retry-After", to_string(_retryAfterSeconds));
+    // The body is left unread, so the connection cannot be reused.
+    response.setKeepAlive(false);
+    response.setContentType(CONTENT_TYPE_SOAP_XML);
+
+    ResponseWriter(request, response).send(faultXml);
+}
+
+// --- SearchNamesHandler implementation ---
+// Text of the first element called tag, or "" if there is none.
+string elementText(XML::Document* doc, const string& tag) {
+    AutoPtr<XML::NodeList> nodes = doc->getElementsByTagName(tag);
+    if (nodes->length() > 0 && nodes->item(0)->firstChild()) {
+        return nodes->item(0)->firstChild()->nodeValue();
     }
-    return ""; // Return empty string to signify name not found
+    return "";
+}
+
+SearchNamesHandler::SearchNamesHandler(const NameSearchIndex* pIndex)
+    : _pIndex(pIndex) {
 }
 
-string NameRequestHandler::makeSoapResponse(const string& name) {
+void SearchNamesHandler::handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) {
+    if (request.getMethod() != HTTPRequest::HTTP_POST) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "Client.InvalidMethod", METHOD_NOT_ALLOWED_MSG);
+        return;
+    }
+    if (!_pIndex) {
+        // The body is left unread, so the connection cannot be reused.
+        response.setKeepAlive(false);
+        sendSoapFault(request, response, HTTPResponse::HTTP_SERVICE_UNAVAILABLE, "Server.SearchUnavailable", SEARCH_UNAVAILABLE_MSG);
+        return;
+    }
+
+    // <SearchNames><Query/><Mode>prefix|fuzzy</Mode><MaxResults/><MaxDistance/></SearchNames>
+    string query;
+    NameSearchIndex::Mode mode = NameSearchIndex::PREFIX;
+    size_t maxResults = SEARCH_DEFAULT_RESULTS;
+    unsigned maxDistance = SEARCH_DEFAULT_DISTANCE;
+    try {
+        string requestBody;
+        StreamCopier::copyToString(request.stream(), requestBody);
+        XML::DOMParser parser;
+        AutoPtr<XML::Document> doc = parser.parseString(requestBody);
+
+        query = elementText(doc, "Query");
+        const string modeText = elementText(doc, "Mode");
+        if (modeText == "fuzzy") {
+            mode = NameSearchIndex::FUZZY;
+        } else if (!modeText.empty() && modeText != "prefix") {
+            sendSoapFault(request, response, HTTPResponse::HTTP_BAD_REQUEST, "Client.InvalidMode", "Mode must be 'prefix' or 'fuzzy'");
+            return;
+        }
+        unsigned value = 0;
+        if (NumberParser::tryParseUnsigned(elementText(doc, "MaxResults"), value)) {
+            maxResults = min<size_t>(value, SEARCH_MAX_RESULTS);
+        }
+        if (NumberParser::tryParseUnsigned(elementText(doc, "MaxDistance"), value)) {
+            maxDistance = min(value, SEARCH_MAX_DISTANCE);
+        }
+    } catch (const XML::XMLException& e) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_BAD_REQUEST, "Client.InvalidXML", "Invalid XML format: " + string(e.what()));
+        return;
+    } catch (const exception& e) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.ReadError", "Failed to read request body: " + string(e.what()));
+        return;
+    }
+
+    if (query.empty()) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_BAD_REQUEST, "Client.QueryNotFound", SEARCH_QUERY_MISSING_MSG);
+        return;
+    }
+
+    const vector<string> names = _pIndex->search(query, mode, maxResults, maxDistance);
+
     ostringstream oss;
     oss << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
         << "<soap:Envelope xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\">"
         << "<soap:Body>"
-        << "<GetNameResponse>"
-        << "<Name>" << name << "</Name>"
-        << "</GetNameResponse>"
+        << "<SearchNamesResponse>";
+    for (const auto& name : names) {
+        oss << "<Name>" << escapeXml(name) << "</Name>";
+    }
+    oss << "</SearchNamesResponse>"
         << "</soap:Body>"
         << "</soap:Envelope>";
+
+    const string responseXml = oss.str();
+    response.setStatus(HTTPResponse::HTTP_OK);
+    response.setContentType(CONTENT_TYPE_SOAP_XML);
+
+    ResponseWriter(request, response).send(responseXml);
+}
+
+// --- ExportUsersHandler implementation ---
+ExportUsersHandler::ExportUsersHandler(ShardRouter& router)
+    : _router(router) {
+}
+
+void ExportUsersHandler::handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) {
+    if (request.getMethod() != HTTPRequest::HTTP_POST) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "Client.InvalidMethod", METHOD_NOT_ALLOWED_MSG);
+        return;
+    }
+
+    // <ExportUsers><FirstName/></ExportUsers>, FirstName optional
+    string firstName;
+    try {
+        string requestBody;
+        StreamCopier::copyToString(request.stream(), requestBody);
+        XML::DOMParser parser;
+        AutoPtr<XML::Document> doc = parser.parseString(requestBody);
+        firstName = elementText(doc, "FirstName");
+    } catch (const XML::XMLException& e) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_BAD_REQUEST, "Client.InvalidXML", "Invalid XML format: " + string(e.what()));
+        return;
+    } catch (const exception& e) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.ReadError", "Failed to read request body: " + string(e.what()));
+        return;
+    }
+
+    // Nothing is sent until the first batch arrives, so a query that
+    // fails outright still gets a proper fault. Each batch is one chunk,
+    // written together with its framing.
+    ResponseWriter writer(request, response);
+    string chunk;
+    auto writeBatch = [&](const vector<string>& firstNames, const vector<string>& lastNames, size_t rows) {
+        chunk.clear();
+        if (!writer.sent()) {
+            response.setStatus(HTTPResponse::HTTP_OK);
+            response.setContentType(CONTENT_TYPE_SOAP_XML);
+            chunk += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                     "<soap:Envelope xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+                     "<soap:Body>"
+                     "<ExportUsersResponse>";
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            chunk += "<User><FirstName>";
+            appendEscapedXml(chunk, firstNames[i]);
+            chunk += "</FirstName><LastName>";
+            appendEscapedXml(chunk, lastNames[i]);
+            chunk += "</LastName></User>";
+        }
+        writer.sendChunk(chunk);
+    };
+
+    try {
+        _router.exportUsers(firstName, EXPORT_ROWS_PER_FETCH, writeBatch);
+    } catch (const exception& e) {
+        if (!writer.sent()) {
+            const bool unavailable = dynamic_cast<const ShardUnavailableException*>(&e) != nullptr;
+            sendSoapFault(request, response,
+                          unavailable ? HTTPResponse::HTTP_SERVICE_UNAVAILABLE : HTTPResponse::HTTP_INTERNAL_SERVER_ERROR,
+                          "Server.DatabaseError", unavailable ? DB_UNAVAILABLE_MSG : DB_QUERY_FAILED_MSG);
+            return;
+        }
+        // Too late for a fault: stop without the last chunk, so the client
+        // sees a truncated response, and drop the connection
+        logError("ExportUsers aborted: {}", e.what());
+        response.setKeepAlive(false);
+        return;
+    }
+
+    if (!writer.sent()) {
+        // No rows at all
+        writeBatch(vector<string>(), vector<string>(), 0);
+    }
+    writer.sendChunk("</ExportUsersResponse>"
+                     "</soap:Body>"
+                     "</soap:Envelope>");
+    writer.finish();
+}
+
+// --- ListUsersHandler implementation ---
+// A cursor is the last key of a page: a format byte, the two names with
+// 16-bit length prefixes and the row version, base64url encoded. Clients
+// must treat it as opaque.
+const char CURSOR_FORMAT = 1;
+
+void appendCursorString(string& out, const string& s) {
+    const size_t length = min<size_t>(s.size(), 0xFFFF);
+    out += static_cast<char>(length & 0xFF);
+    out += static_cast<char>(length >> 8);
+    out.append(s, 0, length);
+}
+
+bool readCursorString(const string& in, size_t& pos, string& s) {
+    if (pos + 2 > in.size()) {
+        return false;
+    }
+    const size_t length = static_cast<unsigned char>(in[pos]) | (static_cast<unsigned char>(in[pos + 1]) << 8);
+    pos += 2;
+    if (pos + length > in.size()) {
+        return false;
+    }
+    s.assign(in, pos, length);
+    pos += length;
+    return true;
+}
+
+string encodeCursor(const NameRow& key) {
+    string raw(1, CURSOR_FORMAT);
+    appendCursorString(raw, key.firstName);
+    appendCursorString(raw, key.lastName);
+    const Poco::UInt64 version = static_cast<Poco::UInt64>(key.version);
+    for (int i = 0; i < 8; ++i) {
+        raw += static_cast<char>((version >> (8 * i)) & 0xFF);
+    }
+
+    ostringstream oss;
+    Poco::Base64Encoder encoder(oss, Poco::BASE64_URL_ENCODING | Poco::BASE64_NO_PADDING);
+    encoder << raw;
+    encoder.close();
     return oss.str();
 }
 
-void NameRequestHandler::sendSoapFault(HTTPServerResponse& response, HTTPResponse::HTTPStatus status, 
-                                       const string& faultCode, const string& faultString) {
+bool decodeCursor(const string& token, NameRow& key) {
+    string raw;
+    try {
+        istringstream iss(token);
+        Poco::Base64Decoder decoder(iss, Poco::BASE64_URL_ENCODING | Poco::BASE64_NO_PADDING);
+        StreamCopier::copyToString(decoder, raw);
+    } catch (const Poco::DataFormatException&) {
+        return false;
+    }
+
+    size_t pos = 1;
+    if (raw.empty() || raw[0] != CURSOR_FORMAT
+        || !readCursorString(raw, pos, key.firstName) || !readCursorString(raw, pos, key.lastName)
+        || pos + 8 != raw.size()) {
+        return false;
+    }
+    Poco::UInt64 version = 0;
+    for (int i = 0; i < 8; ++i) {
+        version |= static_cast<Poco::UInt64>(static_cast<unsigned char>(raw[pos + i])) << (8 * i);
+    }
+    key.version = static_cast<Poco::Int64>(version);
+    return true;
+}
+
+ListUsersHandler::ListUsersHandler(ShardRouter& router)
+    : _router(router) {
+}
+
+void ListUsersHandler::handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) {
+    if (request.getMethod() != HTTPRequest::HTTP_POST) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "Client.InvalidMethod", METHOD_NOT_ALLOWED_MSG);
+        return;
+    }
+
+    // <ListUsers><PageSize/><Cursor/></ListUsers>, both optional
+    size_t pageSize = LIST_DEFAULT_PAGE_SIZE;
+    NameRow after;
+    bool hasCursor = false;
+    try {
+        string requestBody;
+        StreamCopier::copyToString(request.stream(), requestBody);
+        XML::DOMParser parser;
+        AutoPtr<XML::Document> doc = parser.parseString(requestBody);
+
+        unsigned value = 0;
+        if (NumberParser::tryParseUnsigned(elementText(doc, "PageSize"), value) && value > 0) {
+            pageSize = min<size_t>(value, LIST_MAX_PAGE_SIZE);
+        }
+        const string cursor = elementText(doc, "Cursor");
+        if (!cursor.empty()) {
+            if (!decodeCursor(cursor, after)) {
+                sendSoapFault(request, response, HTTPResponse::HTTP_BAD_REQUEST, "Client.InvalidCursor", INVALID_CURSOR_MSG);
+                return;
+            }
+            hasCursor = true;
+        }
+    } catch (const XML::XMLException& e) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_BAD_REQUEST, "Client.InvalidXML", "Invalid XML format: " + string(e.what()));
+        return;
+    } catch (const exception& e) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.ReadError", "Failed to read request body: " + string(e.what()));
+        return;
+    }
+
+    vector<NameRow> rows;
+    try {
+        rows = _router.listUsers(hasCursor ? &after : nullptr, pageSize);
+    } catch (const ShardUnavailableException&) {
+        response.set("Retry-After", "1");
+        sendSoapFault(request, response, HTTPResponse::HTTP_SERVICE_UNAVAILABLE, "Server.DatabaseError", DB_UNAVAILABLE_MSG);
+        return;
+    } catch (const exception& e) {
+        sendSoapFault(request, response, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "Server.DatabaseError", DB_QUERY_FAILED_MSG);
+        return;
+    }
+
     ostringstream oss;
     oss << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
         << "<soap:Envelope xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\">"
         << "<soap:Body>"
-        << "<soap:Fault>"
-        << "<faultcode>" << faultCode << "</faultcode>"
-        << "<faultstring>" << escapeXml(faultString) << "</faultstring>"
-        << "</soap:Fault>"
+        << "<ListUsersResponse>";
+    for (const auto& row : rows) {
+        oss << "<User><FirstName>" << escapeXml(row.firstName) << "</FirstName>"
+            << "<LastName>" << escapeXml(row.lastName) << "</LastName></User>";
+    }
+    // A short page is the last one
+    if (rows.size() == pageSize) {
+        oss << "<NextCursor>" << encodeCursor(rows.back()) << "</NextCursor>";
+    }
+    oss << "</ListUsersResponse>"
         << "</soap:Body>"
         << "</soap:Envelope>";
 
-    string faultXml = oss.str();
-    response.setStatusAndReason(status, faultString);
+    const string responseXml = oss.str();
+    response.setStatus(HTTPResponse::HTTP_OK);
     response.setContentType(CONTENT_TYPE_SOAP_XML);
-    response.setContentLength(faultXml.length());
-    
-    ostream& out = response.send();
-    out << faultXml;
+
+    ResponseWriter(request, response).send(responseXml);
+}
+
+// SOAP 1.1 names the operation in SOAPAction, SOAP 1.2 in the
+// Content-Type's action parameter.
+bool isSoapAction(const HTTPServerRequest& request, const string& operation) {
+    return request.get("SOAPAction", "").find(operation) != string::npos
+        || request.getContentType().find(operation) != string::npos;
+}
+
+// The operation a request asks for; GetName unless it names another.
+const char* soapOperation(const HTTPServerRequest& request) {
+    for (const char* operation : { "SearchNames", "ExportUsers", "ListUsers" }) {
+        if (isSoapAction(request, operation)) {
+            return operation;
+        }
+    }
+    return "GetName";
 }
 
 // --- NameRequestHandlerFactory implementation ---
+NameRequestHandlerFactory::NameRequestHandlerFactory(AdmissionController& admission, RateLimiter& rateLimiter,
+                                                     ShardRouter& router, const DeadlinePolicy& deadlines,
+                                                     const NameIndex* pIndex, PersistentNameCache* pCache,
+                                                     NameFilter* pFilter, const NameSearchIndex* pSearch,
+                                                     LookupBatcher* pBatcher, AccessLog* pAccessLog,
+                                                     TrafficCapture* pCapture)
+    : _admission(admission), _rateLimiter(rateLimiter), _router(router), _deadlines(deadlines), _pIndex(pIndex), _pCache(pCache), _pFilter(pFilter),
+      _pSearch(pSearch), _pBatcher(pBatcher), _pAccessLog(pAccessLog), _pCapture(pCapture) {
+}
+
 HTTPRequestHandler* NameRequestHandlerFactory::createRequestHandler(
     const HTTPServerRequest& request) {
-    return new NameRequestHandler;
+    // Taken first, so no early answer leaves the stamp for a later request
+    const chrono::microseconds queued = _admission.takeQueueDelay(request.clientAddress());
+    if (request.getMethod() == HTTPRequest::HTTP_GET && request.getURI() == "/metrics") {
+        return new MetricsHandler;
+    }
+    const string operation = soapOperation(request);
+    HTTPRequestHandler* pHandler = createHandler(request, operation, queued);
+    if (_pCapture) {
+        pHandler = new TrafficCaptureHandler(pHandler, *_pCapture);
+    }
+    if (_pAccessLog) {
+        return new AccessLogHandler(pHandler, *_pAccessLog, SERVICE_SOAP, operation, queued);
+    }
+    return pHandler;
+}
+
+HTTPRequestHandler* NameRequestHandlerFactory::createHandler(const HTTPServerRequest& request, const string& operation,
+                                                             chrono::microseconds queued) {
+    int retryAfter = 0;
+    if (!_rateLimiter.tryAcquire(_rateLimiter.clientKey(request), retryAfter)) {
+        return new OverloadFaultHandler(HTTPResponse::HTTP_TOO_MANY_REQUESTS, retryAfter);
+    }
+    if (!_admission.admit(queued)) {
+        return new OverloadFaultHandler(HTTPResponse::HTTP_SERVICE_UNAVAILABLE, _admission.retryAfterSeconds());
+    }
+    if (operation == "SearchNames") {
+        return new SearchNamesHandler(_pSearch);
+    }
+    if (operation == "ExportUsers") {
+        return new ExportUsersHandler(_router);
+    }
+    if (operation == "ListUsers") {
+        return new ListUsersHandler(_router);
+    }
+    return new NameRequestHandler(_router, Deadline::fromRequest(request, _deadlines), _pIndex, _pCache, _pFilter,
+                                  _pBatcher);
 }
-```
\ No newline at end of file
@@ -1,43 +1,115 @@
 #pragma once
 
+#include "Deadline.hpp"
 #include <Poco/Net/HTTPServer.h>
 #include <Poco/Net/HTTPRequestHandler.h>
 #include <Poco/Net/HTTPRequestHandlerFactory.h>
 #include <Poco/Net/HTTPServerRequest.h>
 #include <Poco/Net/HTTPServerResponse.h>
-#include <Poco/Data/Session.h>
-#include <Poco/AutoPtr.h>
+#include <chrono>
 #include <string>
 
-// Forward declaration for DatabaseService to be used by NameRequestHandler
-class DatabaseService;
+class AccessLog;
+class AdmissionController;
+class LookupBatcher;
+class NameFilter;
+class NameIndex;
+class NameSearchIndex;
+class PersistentNameCache;
+class RateLimiter;
+class ShardRouter;
+class TrafficCapture;
 
 class NameRequestHandler : public Poco::Net::HTTPRequestHandler {
 public:
+    // With an index, names are looked up in memory instead of the database,
+    // unless the index cannot tell (NameIndex::UNSURE); otherwise the
+    // filter and then the cache, if any, are checked before
+    // the key's database shard, through the batcher if there is one. Once
+    // the deadline passes the request is abandoned with a
+    // Server.DeadlineExceeded fault.
+    NameRequestHandler(ShardRouter& router, const Deadline& deadline, const NameIndex* pIndex = nullptr,
+                       PersistentNameCache* pCache = nullptr, NameFilter* pFilter = nullptr,
+                       LookupBatcher* pBatcher = nullptr);
     void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override;
 private:
-    std::string parseFirstNameFromXML(const std::string& xml);
-    std::string makeSoapResponse(const std::string& name);
-    void sendSoapFault(Poco::Net::HTTPServerResponse& response,
-                       Poco::Net::HTTPResponse::HTTPStatus status,
-                       const std::string& faultCode,
-                       const std::string& faultString);
+    void sendDeadlineFault(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const std::string& message);
+
+    ShardRouter& _router;
+    const Deadline _deadline;
+    const NameIndex* _pIndex;
+    PersistentNameCache* _pCache;
+    NameFilter* _pFilter;
+    LookupBatcher* _pBatcher;
 };
 
-class NameRequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+// SearchNames: type-ahead (prefix) and misspelling-tolerant (fuzzy) name
+// search, answered from the in-memory search index. Without one, every
+// request gets a 503 Server.SearchUnavailable fault.
+class SearchNamesHandler : public Poco::Net::HTTPRequestHandler {
 public:
-    Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& request) override;
+    explicit SearchNamesHandler(const NameSearchIndex* pIndex);
+    void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override;
+private:
+    const NameSearchIndex* _pIndex;
 };
 
-// New: Declaration for the DatabaseService class
-class DatabaseService {
+// ExportUsers: every USER row with a given first name, or all of them.
+// The response is streamed with chunked transfer encoding as rows are
+// fetched, so it can be any size.
+class ExportUsersHandler : public Poco::Net::HTTPRequestHandler {
 public:
-    DatabaseService();
-    
-    bool connect();
-    std::string getFullName(const std::string& firstName);
-    void disconnect();
+    explicit ExportUsersHandler(ShardRouter& router);
+    void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override;
+private:
+    ShardRouter& _router;
+};
 
+// ListUsers: USER rows a page at a time, in key order. Each page ends
+// with an opaque cursor for the next one (keyset paging), so deep pages
+// cost the same as the first.
+class ListUsersHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    explicit ListUsersHandler(ShardRouter& router);
+    void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override;
 private:
-    Poco::AutoPtr<Poco::Data::Session> _session;
-};
\ No newline at end of file
+    ShardRouter& _router;
+};
+
+// Rejects a request with a canned fault and Retry-After, without reading
+// the request body: Server.Overloaded for 503, Client.RateLimited for 429.
+class OverloadFaultHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    OverloadFaultHandler(Poco::Net::HTTPResponse::HTTPStatus status, int retryAfterSeconds);
+    void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override;
+private:
+    Poco::Net::HTTPResponse::HTTPStatus _status;
+    int _retryAfterSeconds;
+};
+
+// With an access log, every request but /metrics gets a record there;
+// with a traffic capture, it is also captured for replay.
+class NameRequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+    NameRequestHandlerFactory(AdmissionController& admission, RateLimiter& rateLimiter, ShardRouter& router,
+                              const DeadlinePolicy& deadlines, const NameIndex* pIndex = nullptr, PersistentNameCache* pCache = nullptr,
+                              NameFilter* pFilter = nullptr, const NameSearchIndex* pSearch = nullptr,
+                              LookupBatcher* pBatcher = nullptr, AccessLog* pAccessLog = nullptr,
+                              TrafficCapture* pCapture = nullptr);
+    Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& request) override;
+private:
+    Poco::Net::HTTPRequestHandler* createHandler(const Poco::Net::HTTPServerRequest& request, const std::string& operation,
+                                                 std::chrono::microseconds queued);
+
+    AdmissionController& _admission;
+    RateLimiter& _rateLimiter;
+    ShardRouter& _router;
+    const DeadlinePolicy _deadlines;
+    const NameIndex* _pIndex;
+    PersistentNameCache* _pCache;
+    NameFilter* _pFilter;
+    const NameSearchIndex* _pSearch;
+    LookupBatcher* _pBatcher;
+    AccessLog* _pAccessLog;
+    TrafficCapture* _pCapture;
+};
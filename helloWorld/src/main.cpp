@@ -1,9 +1,105 @@
 #include "NameService.hpp"
+#include "AccessLog.hpp"
+#include "AdmissionControl.hpp"
+#include "Logger.hpp"
+#include "LookupBatcher.hpp"
+#include "NameFilter.hpp"
+#include "NameIndex.hpp"
+#include "NameSearchIndex.hpp"
+#include "PersistentNameCache.hpp"
+#include "RateLimiter.hpp"
+#include "ShardRouter.hpp"
+#include "TrafficCapture.hpp"
 #include <Poco/Net/HTTPServer.h>
 #include <Poco/Net/ServerSocket.h>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Connections that waited longer than this in the accept queue are shed.
+const int ADMISSION_TARGET_QUEUE_DELAY_MS = 100;
+const int ADMISSION_RETRY_AFTER_SECONDS = 1;
+
+// Per-client GetName budget.
+const double RATE_LIMIT_REQUESTS_PER_SECOND = 50.0;
+const double RATE_LIMIT_BURST = 100.0;
+
+// Clients sending one of these X-API-Keys get a budget per key; everyone
+// else, including clients sending any other key, gets one per address.
+const std::vector<std::string> RATE_LIMIT_API_KEYS = {};
+
+// Serve GetName from an in-memory copy of [dbo].[USER] instead of querying
+// per request; the copy picks up changes every refresh interval.
+const bool NAME_INDEX_ENABLED = false;
+const int NAME_INDEX_REFRESH_SECONDS = 5;
+const int NAME_INDEX_FULL_RELOAD_EVERY = 60;
+
+// Bloom filter over USER_FNAME so unknown names skip the database. At 10
+// bits per name about 1% of unknown names still get through.
+const bool NAME_FILTER_ENABLED = true;
+const int NAME_FILTER_REFRESH_SECONDS = 60;
+const double NAME_FILTER_BITS_PER_KEY = 10.0;
+
+// In-memory index behind the SearchNames operation, rebuilt this often.
+const bool NAME_SEARCH_ENABLED = true;
+const int NAME_SEARCH_REFRESH_SECONDS = 60;
+
+// Name lookups found in the database are cached in a memory-mapped file
+// that survives restarts. Other processes on the host can map the same
+// file with NAME_CACHE_READ_ONLY set; only one may write it.
+const char* NAME_CACHE_PATH = "soap_name_cache.bin";
+const std::size_t NAME_CACHE_SLOTS = 64 * 1024;
+const int NAME_CACHE_TTL_SECONDS = 3600;
+const bool NAME_CACHE_READ_ONLY = false;
+
+// [dbo].[USER] shards, keyed by first name on a consistent-hash ring. Add
+// new shards at the end: only about 1/n of the names move to them. Rows
+// must be placed on the shard ShardRouter::shardFor() picks for their
+// first name, which hashes it trimmed and case-folded (NameKey.hpp).
+const std::vector<std::string> DB_SHARDS = { DatabaseService::defaultConnectionString() };
+const int DB_SESSIONS_PER_SHARD = 8;
+
+// GetName deadline when the client sends no X-Deadline-Ms, and the most a
+// client may ask for. Requests still running at their deadline are
+// abandoned, including their database query.
+const int REQUEST_DEFAULT_DEADLINE_MS = 2000;
+const int REQUEST_MAX_DEADLINE_MS = 30000;
+
+// Read replicas per shard, in DB_SHARDS order; a shard without any reads
+// from its primary. With hedging, a read slower than the recent p95 is
+// also sent to a second replica and the first answer wins.
+const std::vector<std::vector<std::string>> DB_SHARD_REPLICAS = { {} };
+const bool DB_HEDGED_READS = true;
+
+// Concurrent GetName lookups that reach the database are merged into IN
+// queries of up to LOOKUP_BATCH_MAX names. A batch waits at most
+// LOOKUP_BATCH_MAX_WINDOW_US for more lookups, less when load is light.
+const bool LOOKUP_BATCHING_ENABLED = true;
+const std::size_t LOOKUP_BATCH_MAX = 256;
+const int LOOKUP_BATCH_MAX_WINDOW_US = 2000;
+
+// Log records below this level are dropped where they are logged.
+const LogLevel LOG_LEVEL = LogLevel::Info;
+
+// One binary record per request, for capacity planning; decode with the
+// accesslog tool. Each segment holds ACCESS_LOG_SEGMENT_RECORDS records
+// (80 bytes each) and only the newest ACCESS_LOG_MAX_SEGMENTS are kept.
+const bool ACCESS_LOG_ENABLED = true;
+const char* ACCESS_LOG_DIRECTORY = "soap_access_log";
+const std::size_t ACCESS_LOG_SEGMENT_RECORDS = 1024 * 1024;
+const std::size_t ACCESS_LOG_MAX_SEGMENTS = 16;
+
+// Records whole requests to CAPTURE_PATH for the replay tool, replacing
+// any earlier capture. Stops at CAPTURE_MAX_BYTES; bodies are cut at
+// CAPTURE_MAX_BODY_BYTES.
+const bool CAPTURE_ENABLED = false;
+const char* CAPTURE_PATH = "soap_capture.bin";
+const std::size_t CAPTURE_MAX_BYTES = 1024 * 1024 * 1024;
+const std::size_t CAPTURE_MAX_BODY_BYTES = 1024 * 1024;
 
 int main() {
+    Logger::instance().setLevel(LOG_LEVEL);
     try {
         // Create a server socket
         Poco::Net::ServerSocket socket(8080);
@@ -11,13 +107,104 @@ int main() {
         // Create HTTP server parameters
         Poco::Net::HTTPServerParams* params = new Poco::Net::HTTPServerParams;
     
+        // Shed requests that waited too long in the connection queue. Stamps
+        // of connections that never sent a request go after ten server
+        // timeouts, far beyond any wait still worth measuring.
+        AdmissionController admission(std::chrono::milliseconds(ADMISSION_TARGET_QUEUE_DELAY_MS),
+                                      ADMISSION_RETRY_AFTER_SECONDS,
+                                      std::chrono::seconds(10 * params->getTimeout().totalSeconds()));
+        
+        // Per-client token buckets, checked before any body is read
+        RateLimiter rateLimiter(RATE_LIMIT_REQUESTS_PER_SECOND, RATE_LIMIT_BURST);
+        rateLimiter.setApiKeys(RATE_LIMIT_API_KEYS);
+        
+        // Pooled sessions per shard, shared by all request handlers
+        ShardRouter router(DB_SHARDS, DB_SESSIONS_PER_SHARD);
+        for (std::size_t shard = 0; shard < DB_SHARD_REPLICAS.size() && shard < DB_SHARDS.size(); ++shard) {
+            std::vector<Replica> replicas;
+            for (const auto& connectionString : DB_SHARD_REPLICAS[shard]) {
+                Replica replica;
+                replica.connectionString = connectionString;
+                replicas.push_back(replica);
+            }
+            router.setReplicas(shard, replicas, DB_SESSIONS_PER_SHARD, DB_HEDGED_READS);
+        }
+        
+        // Optional in-memory name index, loaded from every shard before we
+        // accept requests
+        std::unique_ptr<NameIndex> nameIndex;
+        if (NAME_INDEX_ENABLED) {
+            nameIndex.reset(new NameIndex(router,
+                                          std::chrono::seconds(NAME_INDEX_REFRESH_SECONDS),
+                                          NAME_INDEX_FULL_RELOAD_EVERY));
+            nameIndex->start();
+        }
+        
+        // The filter only fronts the database, so it is not needed with the index
+        std::unique_ptr<NameFilter> nameFilter;
+        if (NAME_FILTER_ENABLED && !NAME_INDEX_ENABLED) {
+            nameFilter.reset(new NameFilter(router,
+                                            std::chrono::seconds(NAME_FILTER_REFRESH_SECONDS),
+                                            NAME_FILTER_BITS_PER_KEY));
+            try {
+                nameFilter->start();
+            } catch (const std::exception& e) {
+                // Serve without it rather than not at all
+                logWarning("Name filter disabled: {}", e.what());
+                nameFilter.reset();
+            }
+        }
+        
+        std::unique_ptr<NameSearchIndex> nameSearch;
+        if (NAME_SEARCH_ENABLED) {
+            nameSearch.reset(new NameSearchIndex(router,
+                                                 std::chrono::seconds(NAME_SEARCH_REFRESH_SECONDS)));
+            try {
+                nameSearch->start();
+            } catch (const std::exception& e) {
+                // GetName still works; SearchNames answers Server.SearchUnavailable
+                logWarning("SearchNames disabled: {}", e.what());
+                nameSearch.reset();
+            }
+        }
+        
+        std::unique_ptr<LookupBatcher> batcher;
+        if (LOOKUP_BATCHING_ENABLED) {
+            batcher.reset(new LookupBatcher(router, LOOKUP_BATCH_MAX,
+                                            std::chrono::microseconds(LOOKUP_BATCH_MAX_WINDOW_US)));
+        }
+        
+        PersistentNameCache nameCache(NAME_CACHE_PATH, NAME_CACHE_SLOTS,
+                                      std::chrono::seconds(NAME_CACHE_TTL_SECONDS),
+                                      NAME_CACHE_READ_ONLY ? PersistentNameCache::READ_ONLY : PersistentNameCache::READ_WRITE);
+        
+        std::unique_ptr<AccessLog> accessLog;
+        if (ACCESS_LOG_ENABLED) {
+            accessLog.reset(new AccessLog(ACCESS_LOG_DIRECTORY, ACCESS_LOG_SEGMENT_RECORDS, ACCESS_LOG_MAX_SEGMENTS));
+        }
+        
+        std::unique_ptr<TrafficCapture> capture;
+        if (CAPTURE_ENABLED) {
+            capture.reset(new TrafficCapture(CAPTURE_PATH, CAPTURE_MAX_BYTES, CAPTURE_MAX_BODY_BYTES));
+        }
+        
+        // Time budget of each GetName request
+        const DeadlinePolicy deadlines = { std::chrono::milliseconds(REQUEST_DEFAULT_DEADLINE_MS),
+                                           std::chrono::milliseconds(REQUEST_MAX_DEADLINE_MS) };
         
         // Create the HTTP server
-        Poco::Net::HTTPServer server(new NameRequestHandlerFactory, socket, params);
+        Poco::Net::HTTPServer server(new NameRequestHandlerFactory(admission, rateLimiter, router, deadlines,
+                                                                   nameIndex.get(), &nameCache, nameFilter.get(),
+                                                                   nameSearch.get(), batcher.get(), accessLog.get(),
+                                                                   capture.get()),
+                                     socket, params);
+        server.setConnectionFilter(new QueueTimingFilter(admission));
         
         // Start the server
         server.start();
-        std::cout << "SOAP Server started on port 8080" << std::endl;
+        logInfo("SOAP Server started on port {}", 8080);
+        // The prompt goes straight to the console; let the log catch up
+        Logger::instance().flush();
         std::cout << "Press Enter to stop the server..." << std::endl;
         
         std::cin.get();
@@ -27,7 +214,7 @@ int main() {
         
         return 0;
     } catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
+        logError("Error: {}", e.what());
         return 1;
     }
 }
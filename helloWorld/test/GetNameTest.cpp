@@ -0,0 +1,175 @@
+#include "BenchHttp.hpp"
+#include "Deadline.hpp"
+#include "Metrics.hpp"
+#include "NameService.hpp"
+#include "PersistentNameCache.hpp"
+#include "ShardRouter.hpp"
+#include "SoapMessages.hpp"
+#include "Poco/Exception.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/TemporaryFile.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// The envelope scan against the DOM parser, and GetName end to end over
+// loopback as getname_bench drives it. The target defines
+// SOAP_ALLOCATION_CHECK, so a steady-state lookup that allocates fails
+// its request.
+
+int failures = 0;
+
+void fail(const std::string& what) {
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+}
+
+const std::string ENVELOPE_START =
+    "<soap:Envelope xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\"><soap:Body>";
+const std::string ENVELOPE_END = "</soap:Body></soap:Envelope>";
+
+std::string envelope(const std::string& body) {
+    return ENVELOPE_START + body + ENVELOPE_END;
+}
+
+// The scan reads xml and gets expected, as the DOM parser does
+void expectScanned(const std::string& xml, const std::string& expected) {
+    std::string_view text;
+    if (!findNameElement(xml, text)) {
+        fail("scan gave up on " + xml);
+        return;
+    }
+    if (text != expected) {
+        fail("scan read '" + std::string(text) + "' from " + xml);
+    }
+    try {
+        const std::string dom = parseFirstNameFromXML(xml);
+        if (dom != expected) {
+            fail("DOM read '" + dom + "' from " + xml);
+        }
+    } catch (const Poco::Exception& ex) {
+        fail("DOM rejected " + xml + ": " + ex.displayText());
+    }
+}
+
+// The scan leaves xml to the DOM parser
+void expectLeftToDom(const std::string& xml) {
+    std::string_view text;
+    if (findNameElement(xml, text)) {
+        fail("scan read '" + std::string(text) + "' from " + xml);
+    }
+}
+
+void testEnvelopeScan() {
+    expectScanned("<?xml version=\"1.0\" encoding=\"UTF-8\"?>" + envelope("<GetName><Name>John</Name></GetName>"), "John");
+    expectScanned(envelope("<GetName>\r\n  <Name>John</Name>\r\n</GetName>") + "\n", "John");
+    expectScanned(envelope("<GetName><Name a=\">\">John</Name></GetName>"), "John");
+    expectScanned(envelope("<GetName><Name a='x' b=\"y\">John</Name></GetName>"), "John");
+    expectScanned(envelope("<GetName><Name/></GetName>"), "");
+    expectScanned(envelope("<GetName><Name></Name></GetName>"), "");
+    expectScanned(envelope("<GetName><Name>Jos\xC3\xA9</Name></GetName>"), "Jos\xC3\xA9");
+    expectScanned(envelope("<NameList/><GetName><Name>John</Name><Name>Jane</Name></GetName>"), "John");
+    expectScanned("<soap:Envelope xmlns:soap=\"urn:s\"><soap:Header><Name>Header</Name></soap:Header>"
+                  "<soap:Body><GetName><Name>John</Name></GetName></soap:Body></soap:Envelope>", "Header");
+    expectScanned(envelope("<m:GetName xmlns:m=\"urn:m\"><Name>John</Name></m:GetName>"), "John");
+
+    expectLeftToDom("<Envelope><Body><GetName><Name>John</Name></GetName></Body></Envelope><Trailing/>");
+    expectLeftToDom("<soap:Envelope><soap:Body><GetName><Name>John</Name></GetName></soap:Body></soap:Envelope>");
+    expectLeftToDom(envelope("<m:GetName><Name>John</Name></m:GetName>"));
+    expectLeftToDom(envelope("<GetName><Name>John</Name></GetNam>"));
+    expectLeftToDom(envelope("<GetName><Name>John</Name>"));
+    expectLeftToDom(envelope("<GetName><Name a=\"<\">John</Name></GetName>"));
+    expectLeftToDom(envelope("<GetName><Name a=\"1\" a=\"2\">John</Name></GetName>"));
+    expectLeftToDom(envelope("<GetName><Name>J&amp;ohn</Name></GetName>"));
+    expectLeftToDom(envelope("<GetName><Name><![CDATA[John]]></Name></GetName>"));
+    expectLeftToDom(envelope("<!-- c --><GetName><Name>John</Name></GetName>"));
+    expectLeftToDom(envelope("<GetName><Name><First>John</First></Name></GetName>"));
+    expectLeftToDom(envelope("<GetName><Name>Jo\r\nhn</Name></GetName>"));
+    expectLeftToDom(envelope("<GetName><Name>Jos\xE9</Name></GetName>"));
+    expectLeftToDom("<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>" + envelope("<GetName><Name>John</Name></GetName>"));
+    expectLeftToDom(envelope("<GetName></GetName>"));
+}
+
+ShardRouter& router() {
+    static ShardRouter instance({ "DSN=getname_test_unused" }, 1);
+    return instance;
+}
+
+PersistentNameCache& cache() {
+    static Poco::TemporaryFile file;
+    static PersistentNameCache instance(file.path());
+    return instance;
+}
+
+class GetNameHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+    Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest&) override {
+        return new NameRequestHandler(router(), Deadline(std::chrono::seconds(5)), nullptr, &cache());
+    }
+};
+
+std::string makeRequest(const std::string& body) {
+    return "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/soap+xml\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// Repeated cached lookups over one keep-alive connection, so the later
+// ones run warm and are checked for allocations
+void testCachedLookups() {
+    cache().store("John", "John Smith");
+    Poco::Net::ServerSocket serverSocket(Poco::Net::SocketAddress("127.0.0.1", 0));
+    Poco::Net::HTTPServerParams* params = new Poco::Net::HTTPServerParams;
+    params->setKeepAlive(true);
+    params->setMaxKeepAliveRequests(0);
+    Poco::Net::HTTPServer server(new GetNameHandlerFactory, serverSocket, params);
+    server.start();
+
+    Poco::Net::StreamSocket socket(Poco::Net::SocketAddress("127.0.0.1", server.port()));
+    const std::string scanned = makeRequest(envelope("<GetName><Name a=\">\">John</Name></GetName>"));
+    const std::string withComment = makeRequest(envelope("<!-- c --><GetName><Name>John</Name></GetName>"));
+    std::string reply;
+    for (int i = 0; i < 20; ++i) {
+        const std::string& request = i % 2 == 0 ? scanned : withComment;
+        socket.sendBytes(request.data(), static_cast<int>(request.size()));
+        if (!readResponse(socket, reply)) {
+            fail("server closed the connection on request " + std::to_string(i));
+            break;
+        }
+        if (reply.compare(0, 12, "HTTP/1.1 200") != 0 || reply.find("<Name>John Smith</Name>") == std::string::npos) {
+            fail("request " + std::to_string(i) + " was answered " + reply.substr(0, reply.find("\r\n")));
+        }
+    }
+
+    const std::string undeclared = makeRequest(
+        "<soap:Envelope><soap:Body><GetName><Name>John</Name></GetName></soap:Body></soap:Envelope>");
+    socket.sendBytes(undeclared.data(), static_cast<int>(undeclared.size()));
+    if (!readResponse(socket, reply) || reply.compare(0, 12, "HTTP/1.1 400") != 0) {
+        fail("an undeclared prefix was not answered 400");
+    }
+
+    const Counter& allocations = MetricsRegistry::instance().counter(
+        "getname_hot_path_allocations_total", "Heap allocations made by steady-state GetName lookups served from memory");
+    if (allocations.value() != 0) {
+        fail("cached lookups allocated " + std::to_string(allocations.value()) + " times");
+    }
+    socket.close();
+    server.stop();
+}
+
+} // namespace
+
+int main() {
+    testEnvelopeScan();
+    testCachedLookups();
+    if (failures != 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "getname_test passed" << std::endl;
+    return 0;
+}
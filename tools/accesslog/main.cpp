@@ -0,0 +1,339 @@
+// accesslog: decodes, filters and aggregates the binary access log that
+// soap_service and PocoRestApi write (see common/AccessLogFormat.hpp).
+//
+//   accesslog [options] <segment file or directory>...
+//
+// Without --stats every matching record is printed, one per line. With
+// --stats the matching records are grouped and summarized instead:
+// count, rate, share of 4xx/5xx answers, latency and queue percentiles
+// and mean sizes.
+#include "AccessLogFormat.hpp"
+#include <Poco/DateTime.h>
+#include <Poco/DateTimeFormat.h>
+#include <Poco/DateTimeFormatter.h>
+#include <Poco/DateTimeParser.h>
+#include <Poco/File.h>
+#include <Poco/NumberParser.h>
+#include <Poco/Path.h>
+#include <Poco/Timestamp.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::size_t RECORDS_PER_READ = 4096;
+
+const char* USAGE =
+    "usage: accesslog [options] <segment file or directory>...\n"
+    "\n"
+    "Output (default: one line per record)\n"
+    "  --csv                  records as CSV with a header row\n"
+    "  --stats                summary per group instead of records\n"
+    "  --group-by KEY         route (default), status, service, fault, minute or hour\n"
+    "\n"
+    "Filters\n"
+    "  --service soap|rest\n"
+    "  --route NAME           SOAP operation or REST path\n"
+    "  --status CODE          e.g. 404, or a class such as 5xx\n"
+    "  --fault CODE           SOAP fault code, or 'any' for every fault\n"
+    "  --since TIME           ISO 8601 (UTC unless stated) or seconds since the epoch\n"
+    "  --until TIME\n"
+    "  --min-latency-ms N\n";
+
+struct Options {
+    bool csv = false;
+    bool stats = false;
+    std::string groupBy = "route";
+    int service = 0;
+    std::string route;
+    std::string status;
+    std::string fault;
+    std::uint64_t sinceUs = 0;
+    std::uint64_t untilUs = UINT64_MAX;
+    std::uint64_t minLatencyUs = 0;
+    std::vector<std::string> inputs;
+};
+
+struct Group {
+    std::vector<std::uint32_t> latencyUs;
+    std::vector<std::uint32_t> queueUs;
+    std::uint64_t errors = 0;
+    std::uint64_t requestBytes = 0;
+    std::uint64_t responseBytes = 0;
+    std::uint64_t firstUs = UINT64_MAX;
+    std::uint64_t lastUs = 0;
+};
+
+bool parseTime(const std::string& text, std::uint64_t& us) {
+    Poco::UInt64 seconds = 0;
+    if (Poco::NumberParser::tryParseUnsigned64(text, seconds)) {
+        us = seconds * 1000000;
+        return true;
+    }
+    Poco::DateTime time;
+    int zone = 0;
+    if (!Poco::DateTimeParser::tryParse(text, time, zone)) {
+        return false;
+    }
+    time.makeUTC(zone);
+    us = static_cast<std::uint64_t>(time.timestamp().epochMicroseconds());
+    return true;
+}
+
+std::string formatTime(std::uint64_t us, const char* format) {
+    return Poco::DateTimeFormatter::format(Poco::Timestamp(static_cast<Poco::Timestamp::TimeVal>(us)), format);
+}
+
+const char* serviceName(std::uint8_t service) {
+    return service == SERVICE_SOAP ? "soap" : service == SERVICE_REST ? "rest" : "?";
+}
+
+const char* methodName(std::uint8_t method) {
+    switch (method) {
+        case METHOD_GET:    return "GET";
+        case METHOD_POST:   return "POST";
+        case METHOD_PUT:    return "PUT";
+        case METHOD_DELETE: return "DELETE";
+        case METHOD_HEAD:   return "HEAD";
+        default:            return "OTHER";
+    }
+}
+
+bool matches(const AccessRecord& record, const Options& options) {
+    if (record.startUs < options.sinceUs || record.startUs >= options.untilUs) {
+        return false;
+    }
+    if (options.service && record.service != options.service) {
+        return false;
+    }
+    if (record.latencyUs < options.minLatencyUs) {
+        return false;
+    }
+    if (!options.route.empty() && accessField(record.route, sizeof(record.route)) != options.route) {
+        return false;
+    }
+    if (!options.status.empty()) {
+        const std::string status = std::to_string(record.status);
+        if (options.status.size() == 3 && options.status.compare(1, 2, "xx") == 0) {
+            if (status[0] != options.status[0]) {
+                return false;
+            }
+        } else if (status != options.status) {
+            return false;
+        }
+    }
+    if (!options.fault.empty()) {
+        const std::string_view fault = accessField(record.faultCode, sizeof(record.faultCode));
+        if (options.fault == "any" ? fault.empty() : fault != options.fault) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string groupKey(const AccessRecord& record, const std::string& groupBy) {
+    if (groupBy == "status") {
+        return std::to_string(record.status);
+    }
+    if (groupBy == "service") {
+        return serviceName(record.service);
+    }
+    if (groupBy == "fault") {
+        const std::string_view fault = accessField(record.faultCode, sizeof(record.faultCode));
+        return fault.empty() ? "-" : std::string(fault);
+    }
+    if (groupBy == "minute") {
+        return formatTime(record.startUs, "%Y-%m-%dT%H:%M");
+    }
+    if (groupBy == "hour") {
+        return formatTime(record.startUs, "%Y-%m-%dT%H");
+    }
+    return std::string(accessField(record.route, sizeof(record.route)));
+}
+
+void printRecord(const AccessRecord& record, bool csv) {
+    const std::string time = formatTime(record.startUs, "%Y-%m-%dT%H:%M:%S.%iZ");
+    const std::string route(accessField(record.route, sizeof(record.route)));
+    const std::string fault(accessField(record.faultCode, sizeof(record.faultCode)));
+    if (csv) {
+        std::printf("%s,%s,%s,%s,%u,%.3f,%.3f,%u,%u,%s\n", time.c_str(), serviceName(record.service),
+                    methodName(record.method), route.c_str(), record.status, record.latencyUs / 1000.0,
+                    record.queueUs / 1000.0, record.requestBytes, record.responseBytes, fault.c_str());
+    } else {
+        std::printf("%s %-4s %-6s %-24s %3u %10.3fms queue %8.3fms req %8u resp %10u %s\n", time.c_str(),
+                    serviceName(record.service), methodName(record.method), route.c_str(), record.status,
+                    record.latencyUs / 1000.0, record.queueUs / 1000.0, record.requestBytes,
+                    record.responseBytes, fault.c_str());
+    }
+}
+
+// The value below which the given share of the samples fall.
+double percentileMs(std::vector<std::uint32_t>& samples, double share) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    const std::size_t rank = std::min(samples.size() - 1, static_cast<std::size_t>(share * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(rank), samples.end());
+    return samples[rank] / 1000.0;
+}
+
+void printStats(std::map<std::string, Group>& groups, const std::string& groupBy) {
+    std::printf("%-24s %10s %9s %7s %9s %9s %9s %9s %9s %9s %9s %9s\n", groupBy.c_str(), "count", "req/s",
+                "err%", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms", "q p99 ms", "req B", "resp B");
+    for (auto& entry : groups) {
+        Group& group = entry.second;
+        const double count = static_cast<double>(group.latencyUs.size());
+        const double seconds = (group.lastUs - group.firstUs) / 1e6;
+        const std::uint32_t maxUs = *std::max_element(group.latencyUs.begin(), group.latencyUs.end());
+        std::printf("%-24s %10zu %9.1f %7.2f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9.0f %9.0f\n",
+                    entry.first.c_str(), group.latencyUs.size(), seconds > 0 ? count / seconds : 0.0,
+                    100.0 * group.errors / count, percentileMs(group.latencyUs, 0.50),
+                    percentileMs(group.latencyUs, 0.90), percentileMs(group.latencyUs, 0.99),
+                    percentileMs(group.latencyUs, 0.999), maxUs / 1000.0, percentileMs(group.queueUs, 0.99),
+                    group.requestBytes / count, group.responseBytes / count);
+    }
+}
+
+// Segment files named in inputs, directories expanded, in log order.
+std::vector<std::string> segmentFiles(const std::vector<std::string>& inputs) {
+    std::vector<std::string> files;
+    for (const auto& input : inputs) {
+        Poco::File file(input);
+        if (!file.isDirectory()) {
+            files.push_back(input);
+            continue;
+        }
+        std::vector<std::string> names;
+        file.list(names);
+        std::sort(names.begin(), names.end());
+        for (const auto& name : names) {
+            if (name.compare(0, 7, "access-") == 0) {
+                files.push_back(Poco::Path(input, name).toString());
+            }
+        }
+    }
+    return files;
+}
+
+// Calls fn for every intact record in the segment. Returns false if the
+// file is not a segment this tool can read.
+template <typename Fn>
+bool readSegment(const std::string& path, Fn fn) {
+    std::ifstream in(path, std::ios::binary);
+    AccessLogSegmentHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, ACCESS_LOG_MAGIC, sizeof(ACCESS_LOG_MAGIC)) != 0
+        || header.formatVersion != ACCESS_LOG_FORMAT_VERSION || header.recordSize != sizeof(AccessRecord)) {
+        return false;
+    }
+
+    std::vector<AccessRecord> records(RECORDS_PER_READ);
+    for (std::uint64_t left = header.capacity; left > 0 && in;) {
+        const std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(left, RECORDS_PER_READ));
+        in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(want * sizeof(AccessRecord)));
+        const std::size_t got = static_cast<std::size_t>(in.gcount()) / sizeof(AccessRecord);
+        for (std::size_t i = 0; i < got; ++i) {
+            // Slots never written are all zero
+            if (records[i].startUs != 0 && records[i].crc == accessRecordChecksum(records[i])) {
+                fn(records[i]);
+            }
+        }
+        left -= got;
+    }
+    return true;
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string& out) {
+            if (i + 1 >= argc) {
+                return false;
+            }
+            out = argv[++i];
+            return true;
+        };
+        std::string text;
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--group-by") {
+            if (!value(options.groupBy)) return false;
+        } else if (arg == "--service") {
+            if (!value(text) || (text != "soap" && text != "rest")) return false;
+            options.service = text == "soap" ? SERVICE_SOAP : SERVICE_REST;
+        } else if (arg == "--route") {
+            if (!value(options.route)) return false;
+        } else if (arg == "--status") {
+            if (!value(options.status)) return false;
+        } else if (arg == "--fault") {
+            if (!value(options.fault)) return false;
+        } else if (arg == "--since") {
+            if (!value(text) || !parseTime(text, options.sinceUs)) return false;
+        } else if (arg == "--until") {
+            if (!value(text) || !parseTime(text, options.untilUs)) return false;
+        } else if (arg == "--min-latency-ms") {
+            double ms = 0;
+            if (!value(text) || !Poco::NumberParser::tryParseFloat(text, ms)) return false;
+            options.minLatencyUs = static_cast<std::uint64_t>(ms * 1000.0);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return !options.inputs.empty();
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << USAGE;
+        return 2;
+    }
+
+    std::map<std::string, Group> groups;
+    if (options.csv && !options.stats) {
+        std::printf("time,service,method,route,status,latency_ms,queue_ms,request_bytes,response_bytes,fault\n");
+    }
+    try {
+        for (const auto& path : segmentFiles(options.inputs)) {
+            const bool ok = readSegment(path, [&](const AccessRecord& record) {
+                if (!matches(record, options)) {
+                    return;
+                }
+                if (!options.stats) {
+                    printRecord(record, options.csv);
+                    return;
+                }
+                Group& group = groups[groupKey(record, options.groupBy)];
+                group.latencyUs.push_back(record.latencyUs);
+                group.queueUs.push_back(record.queueUs);
+                group.errors += record.status >= 400 ? 1 : 0;
+                group.requestBytes += record.requestBytes;
+                group.responseBytes += record.responseBytes;
+                group.firstUs = std::min(group.firstUs, record.startUs);
+                group.lastUs = std::max(group.lastUs, record.startUs);
+            });
+            if (!ok) {
+                std::cerr << "Skipping " << path << ": not an access log segment" << std::endl;
+            }
+        }
+    } catch (const Poco::Exception& ex) {
+        std::cerr << "Error: " << ex.displayText() << std::endl;
+        return 1;
+    }
+
+    if (options.stats) {
+        printStats(groups, options.groupBy);
+    }
+    return 0;
+}
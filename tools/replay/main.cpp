@@ -0,0 +1,373 @@
+// replay: sends the requests of a traffic capture (see
+// common/TrafficCaptureFormat.hpp) to a running service and reports the
+// latency it saw, per route, next to what the capture recorded.
+//
+//   replay [options] <capture file>
+//
+// By default requests go out at their captured times. A request is timed
+// from when it was due, not from when a connection was free to send it,
+// so a server that falls behind shows up as latency rather than as a
+// lower request rate. With --max every connection sends its next request
+// as soon as the previous one is answered, and requests are timed from
+// when they were sent.
+//
+// The capture keeps no client identity (no address, no X-API-Key), so the
+// whole replay comes from this one address and the target's rate limiter
+// sees it as a single client. Run the target with a rate limit above the
+// replayed rate (RATE_LIMIT_REQUESTS_PER_SECOND and RATE_LIMIT_BURST in
+// soap_service, ratelimit.requestsPerSecond and ratelimit.burst in
+// PocoApi); the report counts requests rate limited only in the replay.
+// A request shed with 429 or 503 during the capture has its body only if
+// the service read it; otherwise it is skipped like other truncated ones.
+#include "TrafficCaptureFormat.hpp"
+#include <Poco/Exception.h>
+#include <Poco/Net/HTTPClientSession.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/NullStream.h>
+#include <Poco/NumberParser.h>
+#include <Poco/StreamCopier.h>
+#include <Poco/Timespan.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* USAGE =
+    "usage: replay [options] <capture file>\n"
+    "\n"
+    "  --host HOST            service to send to (default 127.0.0.1)\n"
+    "  --port N               (default 8080)\n"
+    "  --speed X              X times the captured rate (default 1)\n"
+    "  --max                  as fast as the service answers\n"
+    "  --connections N        concurrent keep-alive connections (default 32)\n"
+    "  --limit N              replay only the first N requests\n"
+    "  --timeout-s N          per request (default 30)\n"
+    "\n"
+    "Every request comes from this host: run the target with a rate limit\n"
+    "above the replayed rate.\n";
+
+struct Options {
+    std::string host = "127.0.0.1";
+    unsigned short port = 8080;
+    double speed = 1.0;
+    bool max = false;
+    unsigned connections = 32;
+    std::size_t limit = SIZE_MAX;
+    int timeoutSeconds = 30;
+    std::string input;
+};
+
+struct Request {
+    std::uint64_t offsetUs;
+    std::uint32_t capturedLatencyUs;
+    std::uint16_t capturedStatus;
+    std::string method;
+    std::string uri;
+    std::string headers;
+    std::string body;
+    std::string route;
+};
+
+struct Result {
+    bool failed = false;            // no answer: connection refused, reset or timed out
+    int status = 0;
+    std::uint32_t latencyUs = 0;
+    std::uint32_t lagUs = 0;        // sent this late, paced replay only
+};
+
+struct Group {
+    std::vector<std::uint32_t> latencyUs;
+    std::vector<std::uint32_t> capturedLatencyUs;
+    std::uint64_t errors = 0;
+    std::uint64_t changed = 0;
+};
+
+std::uint32_t toMicros(std::chrono::steady_clock::duration duration) {
+    const long long us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    return static_cast<std::uint32_t>(std::min<long long>(std::max<long long>(us, 0), 0xFFFFFFFFLL));
+}
+
+// SOAP operation named by SOAPAction, else the URI path.
+std::string routeOf(const std::string& uri, const std::string& headers) {
+    const std::string key = "SOAPAction: ";
+    const std::size_t pos = headers.find(key);
+    if (pos != std::string::npos) {
+        std::string action = headers.substr(pos + key.size(), headers.find("\r\n", pos) - pos - key.size());
+        action.erase(std::remove(action.begin(), action.end(), '"'), action.end());
+        const std::size_t slash = action.find_last_of("/#");
+        if (slash != std::string::npos) {
+            action.erase(0, slash + 1);
+        }
+        if (!action.empty()) {
+            return action;
+        }
+    }
+    return uri.substr(0, uri.find('?'));
+}
+
+// Reads every intact record, up to the first damaged one. Returns false if
+// the file is not a capture this tool can read.
+bool readCapture(const std::string& path, std::vector<Request>& requests, std::size_t& truncated) {
+    std::ifstream in(path, std::ios::binary);
+    CaptureFileHeader fileHeader;
+    if (!in.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader))
+        || std::memcmp(fileHeader.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0
+        || fileHeader.formatVersion != CAPTURE_FORMAT_VERSION) {
+        return false;
+    }
+
+    CaptureRecordHeader header;
+    std::string payload;
+    while (in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        payload.resize(capturePayloadLength(header));
+        if (!in.read(&payload[0], static_cast<std::streamsize>(payload.size()))
+            || header.crc != captureRecordChecksum(header, payload.data())) {
+            std::cerr << "Damaged record at offset " << header.offsetUs << "us, ignoring the rest of " << path << std::endl;
+            break;
+        }
+        if (header.flags & CAPTURE_BODY_TRUNCATED) {
+            // Sending part of a body would only measure a parse error
+            ++truncated;
+            continue;
+        }
+        Request request;
+        request.offsetUs = header.offsetUs;
+        request.capturedLatencyUs = header.latencyUs;
+        request.capturedStatus = header.status;
+        std::size_t pos = 0;
+        request.method = payload.substr(pos, header.methodLength);
+        pos += header.methodLength;
+        request.uri = payload.substr(pos, header.uriLength);
+        pos += header.uriLength;
+        request.headers = payload.substr(pos, header.headersLength);
+        pos += header.headersLength;
+        request.body = payload.substr(pos, header.bodyLength);
+        request.route = routeOf(request.uri, request.headers);
+        requests.push_back(std::move(request));
+    }
+
+    // Records are written as requests finish; replay them as they started
+    std::stable_sort(requests.begin(), requests.end(),
+                     [](const Request& a, const Request& b) { return a.offsetUs < b.offsetUs; });
+    return true;
+}
+
+void send(Poco::Net::HTTPClientSession& session, const Request& request, Result& result) {
+    Poco::Net::HTTPRequest httpRequest(request.method, request.uri, Poco::Net::HTTPMessage::HTTP_1_1);
+    for (std::size_t pos = 0; pos < request.headers.size();) {
+        const std::size_t end = request.headers.find("\r\n", pos);
+        const std::string line = request.headers.substr(pos, end - pos);
+        const std::size_t colon = line.find(": ");
+        if (colon != std::string::npos) {
+            httpRequest.set(line.substr(0, colon), line.substr(colon + 2));
+        }
+        pos = end == std::string::npos ? request.headers.size() : end + 2;
+    }
+    if (!request.body.empty() || request.method == Poco::Net::HTTPRequest::HTTP_POST
+        || request.method == Poco::Net::HTTPRequest::HTTP_PUT) {
+        httpRequest.setContentLength64(static_cast<Poco::Int64>(request.body.size()));
+    }
+
+    std::ostream& out = session.sendRequest(httpRequest);
+    out.write(request.body.data(), static_cast<std::streamsize>(request.body.size()));
+    Poco::Net::HTTPResponse response;
+    std::istream& in = session.receiveResponse(response);
+    Poco::NullOutputStream discard;
+    Poco::StreamCopier::copyStream(in, discard);
+    result.status = response.getStatus();
+}
+
+// Returns the time from the first request being due to the last answer.
+std::chrono::steady_clock::duration replay(const std::vector<Request>& requests, const Options& options,
+                                           std::vector<Result>& results) {
+    typedef std::chrono::steady_clock Clock;
+    std::atomic<std::size_t> next(0);
+    // Paced, give every connection time to start before the first request
+    // is due
+    const Clock::time_point start = Clock::now()
+        + (options.max ? Clock::duration::zero() : Clock::duration(std::chrono::milliseconds(100)));
+    const std::uint64_t firstUs = requests.empty() ? 0 : requests.front().offsetUs;
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < options.connections; ++i) {
+        workers.emplace_back([&] {
+            Poco::Net::HTTPClientSession session(options.host, options.port);
+            session.setKeepAlive(true);
+            session.setTimeout(Poco::Timespan(options.timeoutSeconds, 0));
+            for (std::size_t index = next++; index < requests.size(); index = next++) {
+                const Request& request = requests[index];
+                Result& result = results[index];
+                Clock::time_point due = start;
+                if (!options.max) {
+                    due += std::chrono::microseconds(
+                        static_cast<long long>((request.offsetUs - firstUs) / options.speed));
+                    std::this_thread::sleep_until(due);
+                }
+                const Clock::time_point sent = Clock::now();
+                try {
+                    send(session, request, result);
+                } catch (const Poco::Exception&) {
+                    result.failed = true;
+                    session.reset();
+                }
+                const Clock::time_point done = Clock::now();
+                result.latencyUs = toMicros(done - (options.max ? sent : due));
+                result.lagUs = options.max ? 0 : toMicros(sent - due);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return Clock::now() - start;
+}
+
+// The value below which the given share of the samples fall.
+double percentileMs(std::vector<std::uint32_t>& samples, double share) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    const std::size_t rank = std::min(samples.size() - 1, static_cast<std::size_t>(share * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(rank), samples.end());
+    return samples[rank] / 1000.0;
+}
+
+void printGroups(std::map<std::string, Group>& groups) {
+    std::printf("%-24s %10s %7s %8s %9s %9s %9s %9s %9s   %9s %9s\n", "route", "count", "err%", "changed",
+                "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms", "was p50", "was p99");
+    for (auto& entry : groups) {
+        Group& group = entry.second;
+        const double count = static_cast<double>(group.latencyUs.size());
+        const std::uint32_t maxUs = *std::max_element(group.latencyUs.begin(), group.latencyUs.end());
+        std::printf("%-24s %10zu %7.2f %8llu %9.3f %9.3f %9.3f %9.3f %9.3f   %9.3f %9.3f\n", entry.first.c_str(),
+                    group.latencyUs.size(), 100.0 * group.errors / count,
+                    static_cast<unsigned long long>(group.changed), percentileMs(group.latencyUs, 0.50),
+                    percentileMs(group.latencyUs, 0.90), percentileMs(group.latencyUs, 0.99),
+                    percentileMs(group.latencyUs, 0.999), maxUs / 1000.0,
+                    percentileMs(group.capturedLatencyUs, 0.50), percentileMs(group.capturedLatencyUs, 0.99));
+    }
+}
+
+void report(const std::vector<Request>& requests, const std::vector<Result>& results, const Options& options,
+            std::chrono::steady_clock::duration elapsed) {
+    std::map<std::string, Group> groups;
+    std::vector<std::uint32_t> lagUs;
+    std::uint64_t failed = 0;
+    std::uint64_t rateLimited = 0;
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        const Request& request = requests[i];
+        const Result& result = results[i];
+        lagUs.push_back(result.lagUs);
+        failed += result.failed ? 1 : 0;
+        rateLimited += result.status == Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS
+            && request.capturedStatus != Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS ? 1 : 0;
+        for (Group* pGroup : { &groups["(all)"], &groups[request.route] }) {
+            pGroup->latencyUs.push_back(result.latencyUs);
+            pGroup->capturedLatencyUs.push_back(request.capturedLatencyUs);
+            pGroup->errors += result.failed || result.status >= 400 ? 1 : 0;
+            pGroup->changed += result.status != request.capturedStatus ? 1 : 0;
+        }
+    }
+
+    const double capturedSeconds = requests.size() > 1
+        ? (requests.back().offsetUs - requests.front().offsetUs) / 1e6 : 0.0;
+    const double seconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1e6;
+    std::printf("Replayed %zu requests to %s:%u over %u connections\n", requests.size(), options.host.c_str(),
+                options.port, options.connections);
+    std::printf("Captured rate %.1f req/s, replayed %.1f req/s in %.1f s\n",
+                capturedSeconds > 0 ? requests.size() / capturedSeconds : 0.0,
+                seconds > 0 ? requests.size() / seconds : 0.0, seconds);
+    std::printf("No answer: %llu", static_cast<unsigned long long>(failed));
+    if (!options.max) {
+        std::printf(", sent late p99 %.3f ms, max %.3f ms", percentileMs(lagUs, 0.99),
+                    *std::max_element(lagUs.begin(), lagUs.end()) / 1000.0);
+    }
+    std::printf("\n");
+    if (rateLimited > 0) {
+        std::printf("Rate limited only in the replay: %llu (raise the target's rate limit)\n",
+                    static_cast<unsigned long long>(rateLimited));
+    }
+    std::printf("\n");
+    printGroups(groups);
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string& out) {
+            if (i + 1 >= argc) {
+                return false;
+            }
+            out = argv[++i];
+            return true;
+        };
+        std::string text;
+        unsigned number = 0;
+        if (arg == "--host") {
+            if (!value(options.host)) return false;
+        } else if (arg == "--port") {
+            if (!value(text) || !Poco::NumberParser::tryParseUnsigned(text, number) || number == 0 || number > 65535) return false;
+            options.port = static_cast<unsigned short>(number);
+        } else if (arg == "--speed") {
+            if (!value(text) || !Poco::NumberParser::tryParseFloat(text, options.speed) || options.speed <= 0) return false;
+        } else if (arg == "--max") {
+            options.max = true;
+        } else if (arg == "--connections") {
+            if (!value(text) || !Poco::NumberParser::tryParseUnsigned(text, number) || number == 0) return false;
+            options.connections = number;
+        } else if (arg == "--limit") {
+            if (!value(text) || !Poco::NumberParser::tryParseUnsigned(text, number)) return false;
+            options.limit = number;
+        } else if (arg == "--timeout-s") {
+            if (!value(text) || !Poco::NumberParser::tryParseUnsigned(text, number) || number == 0) return false;
+            options.timeoutSeconds = static_cast<int>(number);
+        } else if (arg.compare(0, 2, "--") == 0 || !options.input.empty()) {
+            return false;
+        } else {
+            options.input = arg;
+        }
+    }
+    return !options.input.empty();
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << USAGE;
+        return 2;
+    }
+
+    std::vector<Request> requests;
+    std::size_t truncated = 0;
+    if (!readCapture(options.input, requests, truncated)) {
+        std::cerr << options.input << " is not a traffic capture" << std::endl;
+        return 1;
+    }
+    if (truncated > 0) {
+        std::cerr << "Skipping " << truncated << " requests whose body was cut short in the capture" << std::endl;
+    }
+    if (requests.size() > options.limit) {
+        requests.resize(options.limit);
+    }
+    if (requests.empty()) {
+        std::cerr << "Nothing to replay" << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results(requests.size());
+    const auto elapsed = replay(requests, options, results);
+    report(requests, results, options, elapsed);
+    return 0;
+}